@@ -2,6 +2,87 @@
 
 #include "ArkdeCM.h"
 #include "Modules/ModuleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "UObject/UObjectGlobals.h"
+#include "Startup/ACM_StartupProfiler.h"
+#include "Startup/ACM_PrewarmSubsystem.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "GameplayAbility/ACM_GameplayTags.h"
+#include "Tuning/ACM_TuningTable.h"
+#include "Misc/Paths.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, ArkdeCM, "ArkdeCM" );
- 
\ No newline at end of file
+DEFINE_LOG_CATEGORY(LogArkdeCM);
+
+class FArkdeCMModule : public FDefaultGameModuleImpl
+{
+
+public:
+
+	virtual void StartupModule() override
+	{
+
+		FACM_StartupProfiler::RecordMarker(TEXT("ModuleLoaded"));
+
+		FACM_GameplayTags::InitializeNativeTags();
+
+		PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddLambda([]()
+		{
+			FACM_StartupProfiler::RecordMarker(TEXT("EngineInitialized"));
+
+			// Before the default map loads, pre-warm servers already did this when their game instance started
+			UACM_PrewarmSubsystem::InitAbilitySystemGlobals();
+		});
+
+		PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddRaw(this, &FArkdeCMModule::HandlePreLoadMap);
+		PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FArkdeCMModule::HandlePostLoadMap);
+
+		UACM_AttributeSet::RegisterDeferredAggregation();
+
+		const FString TuningFilename = FACM_TuningTable::GetDefaultFilename();
+		if (FPaths::FileExists(TuningFilename))
+		{
+			FACM_TuningTable::Load(TuningFilename);
+		}
+
+	}
+
+	virtual void ShutdownModule() override
+	{
+
+		FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+		FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+		FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+
+		UACM_AttributeSet::UnregisterDeferredAggregation();
+
+		FACM_TuningTable::Unload();
+
+	}
+
+private:
+
+	void HandlePreLoadMap(const FString& MapName)
+	{
+		MapLoadStartSeconds = FPlatformTime::Seconds();
+	}
+
+	void HandlePostLoadMap(UWorld* LoadedWorld)
+	{
+
+		if (FACM_StartupProfiler::IsCollecting() && MapLoadStartSeconds > 0.0)
+		{
+			FACM_StartupProfiler::RecordPhase(TEXT("MapLoad"), MapLoadStartSeconds);
+		}
+
+		MapLoadStartSeconds = 0.0;
+
+	}
+
+	FDelegateHandle PostEngineInitHandle;
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+	double MapLoadStartSeconds = 0.0;
+
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FArkdeCMModule, ArkdeCM, "ArkdeCM" );
@@ -4,6 +4,10 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogArkdeCM, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("ArkdeCM"), STATGROUP_ArkdeCM, STATCAT_Advanced);
+
 UENUM(BlueprintType)
 enum class EACM_AbilityInputID : uint8
 {
@@ -1,18 +1,43 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "ArkdeCMCharacter.h"
+#include "ArkdeCMGameMode.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
 #include "GameFramework/SpringArmComponent.h"
-#include "AbilitySystemComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
 #include "GameplayAbility/ACM_AttributeSet.h"
+#include "GameplayAbility/ACM_AttributeInit.h"
 #include "GameplayAbility/ACM_GameplayAbility.h"
+#include "GameplayAbility/ACM_AuraSubsystem.h"
+#include "GameplayAbility/ACM_DamageHistoryComponent.h"
+#include "Profiling/ACM_GarbageCollection.h"
+#include "Startup/ACM_StartupProfiler.h"
 #include "ArkdeCM/ArkdeCM.h"
 
+DECLARE_CYCLE_STAT(TEXT("Character Attribute Init"), STAT_ACM_AttributeInit, STATGROUP_ArkdeCM);
+
+namespace ACM_CharacterReplay
+{
+
+	static TAutoConsoleVariable<int32> CVarMaxSendKB(
+		TEXT("ACM.Replay.MaxSendKB"),
+		48,
+		TEXT("Largest instant replay clip sent to a client, longer requests are shortened until they fit. Also the largest clip a client accepts."),
+		ECVF_Default);
+
+	/** Clips go out in reliable RPCs of at most this many bytes so none of them needs a huge bunch */
+	static const int32 ChunkBytes = 8 * 1024;
+
+}
+
 //=========================================================================================================================================================
 // AArkdeCMCharacter
 
@@ -50,12 +75,23 @@ AArkdeCMCharacter::AArkdeCMCharacter()
 	// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	// are set in the derived blueprint asset named MyCharacter (to avoid direct content references in C++)
 
-	AbilitySystemComponent = CreateDefaultSubobject<UAbilitySystemComponent>(TEXT("Ability System Component"));
+	AbilitySystemComponent = CreateDefaultSubobject<UACM_AbilitySystemComponent>(TEXT("Ability System Component"));
 	AbilitySystemComponent->SetIsReplicated(true);
-	AbilitySystemComponent->SetReplicationMode(EGameplayEffectReplicationMode::Full);
+	AbilitySystemComponent->SetReplicationMode(EGameplayEffectReplicationMode::Mixed);
 
 	AttributeSet = CreateDefaultSubobject<UACM_AttributeSet>(TEXT("Attribute Set"));
 
+	DamageHistoryComponent = CreateDefaultSubobject<UACM_DamageHistoryComponent>(TEXT("Damage History"));
+
+	AttributeInitTable = nullptr;
+	CharacterLevel = 1;
+
+	// Runs until the first character has finished BeginPlay, ability grants included
+	if (!IsTemplate() && FACM_StartupProfiler::IsCollecting())
+	{
+		FACM_StartupProfiler::BeginPhase(TEXT("FirstCharacterSetup"));
+	}
+
 }
 
 //=========================================================================================================================================================
@@ -67,15 +103,22 @@ void AArkdeCMCharacter::BeginPlay()
 	if (GetLocalRole() == ENetRole::ROLE_Authority && IsValid(AbilitySystemComponent))
 	{
 
+		InitializeAttributes();
+
+		const double GrantStartSeconds = FPlatformTime::Seconds();
+
 		for (TSubclassOf<UACM_GameplayAbility>& CurrentAbility : StartingAbilitties)
 		{
 
 			if (IsValid(CurrentAbility))
 			{
 
+				ACM_GarbageCollection::ClusterGameplayClass(CurrentAbility);
+
 				UACM_GameplayAbility* DefaultObj = CurrentAbility->GetDefaultObject<UACM_GameplayAbility>();
+				DefaultObj->WarmLevelCaches();
 
-				FGameplayAbilitySpec AbilitySpec(DefaultObj, 1, static_cast<int32>(DefaultObj->AbilityInputID), this);
+				FGameplayAbilitySpec AbilitySpec(DefaultObj, CharacterLevel, static_cast<int32>(DefaultObj->AbilityInputID), this);
 
 				AbilitySystemComponent->GiveAbility(AbilitySpec);
 
@@ -85,10 +128,58 @@ void AArkdeCMCharacter::BeginPlay()
 
 		AbilitySystemComponent->InitAbilityActorInfo(this, this);
 
+		static bool bFirstGrantRecorded = false;
+		if (!bFirstGrantRecorded && FACM_StartupProfiler::IsCollecting())
+		{
+			FACM_StartupProfiler::RecordPhase(TEXT("FirstCharacterGrantAbilities"), GrantStartSeconds);
+			bFirstGrantRecorded = true;
+		}
+
+		UACM_AuraSubsystem* AuraSubsystem = GetWorld()->GetSubsystem<UACM_AuraSubsystem>();
+		if (IsValid(AuraSubsystem))
+		{
+			AuraSubsystem->RegisterTarget(AbilitySystemComponent, this);
+		}
+
+	}
+
+	FACM_StartupProfiler::EndPhase(TEXT("FirstCharacterSetup"));
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMCharacter::InitializeAttributes()
+{
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_AttributeInit);
+
+	if (IsValid(AttributeSet))
+	{
+		AttributeSet->ApplyTuningDefaults();
+	}
+
+	const FACM_AttributeInitSpec* InitSpec = FACM_AttributeInitRegistry::FindSpec(AttributeInitTable, AttributeInitClass, CharacterLevel);
+	if (InitSpec != nullptr && IsValid(AttributeSet))
+	{
+		AttributeSet->InitFromSpec(*InitSpec);
 	}
 
 }
 
+//=========================================================================================================================================================
+void AArkdeCMCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	UACM_AuraSubsystem* AuraSubsystem = GetWorld()->GetSubsystem<UACM_AuraSubsystem>();
+	if (IsValid(AuraSubsystem))
+	{
+		AuraSubsystem->UnregisterTarget(AbilitySystemComponent);
+	}
+
+	Super::EndPlay(EndPlayReason);
+
+}
+
 //=========================================================================================================================================================
 void AArkdeCMCharacter::PossessedBy(AController* NewController)
 {
@@ -100,6 +191,30 @@ void AArkdeCMCharacter::PossessedBy(AController* NewController)
 		AbilitySystemComponent->RefreshAbilityActorInfo();
 	}
 
+	if (IsValid(NewController) && NewController->IsPlayerController())
+	{
+		FACM_StartupProfiler::Finish(TEXT("FirstPlayerPossession"));
+	}
+
+}
+
+//=========================================================================================================================================================
+bool AArkdeCMCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+
+	// Spectators watch through their AACM_SpectatorSnapshot, neither the character nor its ASC is sent to them
+	const APlayerController* ViewerController = Cast<APlayerController>(RealViewer);
+	if (ViewerController != nullptr && ViewerController->PlayerState != nullptr && ViewerController->PlayerState->IsSpectator() && !IsOwnedBy(RealViewer))
+	{
+		const AArkdeCMGameMode* GameMode = GetWorld()->GetAuthGameMode<AArkdeCMGameMode>();
+		if (GameMode != nullptr && GameMode->HasSpectatorSnapshots(ViewerController))
+		{
+			return false;
+		}
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+
 }
 
 //=========================================================================================================================================================
@@ -150,6 +265,88 @@ UAbilitySystemComponent * AArkdeCMCharacter::GetAbilitySystemComponent() const
 	return AbilitySystemComponent;
 }
 
+//=========================================================================================================================================================
+void AArkdeCMCharacter::SendReplayClip(float Seconds)
+{
+
+	UACM_InstantReplaySubsystem* ReplaySubsystem = GetWorld()->GetSubsystem<UACM_InstantReplaySubsystem>();
+	if (!IsValid(ReplaySubsystem))
+	{
+		return;
+	}
+
+	using namespace ACM_CharacterReplay;
+
+	const int32 MaxSendBytes = FMath::Max(CVarMaxSendKB.GetValueOnGameThread(), 1) * 1024;
+
+	// Everything queued on the reliable channel stays there until acked, shorten the clip rather than flood it
+	TArray<uint8> Clip;
+	Seconds = FMath::Clamp(Seconds, 0.0f, ReplaySubsystem->GetBufferedSeconds());
+	while (ReplaySubsystem->ExtractClip(Seconds, Clip) && Clip.Num() > MaxSendBytes && Seconds > 0.0f)
+	{
+		Seconds = Seconds >= 0.5f ? Seconds * 0.5f : 0.0f;
+	}
+
+	if (Clip.Num() == 0)
+	{
+		return;
+	}
+
+	if (Clip.Num() > MaxSendBytes)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Instant replay clip of %d bytes is over ACM.Replay.MaxSendKB even at one keyframe, not sent"), Clip.Num());
+		return;
+	}
+
+	TArray<uint8> Chunk;
+	for (int32 Offset = 0; Offset < Clip.Num(); Offset += ChunkBytes)
+	{
+		Chunk.Reset();
+		Chunk.Append(Clip.GetData() + Offset, FMath::Min(ChunkBytes, Clip.Num() - Offset));
+		ClientReceiveReplayClipChunk(Clip.Num(), Offset, Chunk);
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMCharacter::ClientReceiveReplayClipChunk_Implementation(int32 TotalSize, int32 Offset, const TArray<uint8>& Chunk)
+{
+
+	const int32 MaxReceiveBytes = FMath::Max(ACM_CharacterReplay::CVarMaxSendKB.GetValueOnGameThread(), 1) * 1024;
+
+	// A first chunk starts a new clip, anything that does not continue the current one is dropped
+	if (Offset == 0)
+	{
+		PendingReplayClip.Reset();
+	}
+
+	if (TotalSize <= 0 || TotalSize > MaxReceiveBytes || Offset != PendingReplayClip.Num() || Offset + Chunk.Num() > TotalSize)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Dropping instant replay chunk at %d of a %d byte clip"), Offset, TotalSize);
+		PendingReplayClip.Empty();
+		return;
+	}
+
+	PendingReplayClip.Append(Chunk);
+	if (PendingReplayClip.Num() < TotalSize)
+	{
+		return;
+	}
+
+	TArray<FACM_ReplayFrame> Frames;
+	const bool bDecoded = UACM_InstantReplaySubsystem::DecodeClip(PendingReplayClip, Frames);
+	PendingReplayClip.Empty();
+
+	if (!bDecoded)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Received an invalid instant replay clip of %d bytes"), TotalSize);
+		return;
+	}
+
+	OnReplayClipReceived.Broadcast(Frames);
+
+}
+
 //=========================================================================================================================================================
 void AArkdeCMCharacter::OnResetVR()
 {
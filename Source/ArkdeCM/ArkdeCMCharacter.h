@@ -5,11 +5,16 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "AbilitySystemInterface.h"
+#include "Replay/ACM_InstantReplaySubsystem.h"
 #include "ArkdeCMCharacter.generated.h"
 
 class UAbilitySystemComponent;
 class UACM_AttributeSet;
 class UACM_GameplayAbility;
+class UACM_DamageHistoryComponent;
+class UCurveTable;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FACM_OnReplayClipReceived, const TArray<FACM_ReplayFrame>&, Frames);
 
 UCLASS(config=Game)
 class AArkdeCMCharacter : public ACharacter, public IAbilitySystemInterface
@@ -28,8 +33,12 @@ public:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void PossessedBy(AController* NewController) override;
 
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
 	float BaseTurnRate;
@@ -92,7 +101,44 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Gameplay Ability System")
 	TArray<TSubclassOf<UACM_GameplayAbility>> StartingAbilitties;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Gameplay Ability System")
+	UACM_DamageHistoryComponent* DamageHistoryComponent;
+
+	/** Rows named "<AttributeInitClass>.<Attribute>", keyed by level. Without one the attribute set defaults apply */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Gameplay Ability System")
+	UCurveTable* AttributeInitTable;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gameplay Ability System")
+	FName AttributeInitClass;
+
+	/** Level of the attribute init spec and of the starting abilities */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Gameplay Ability System", meta = (ClampMin = "1"))
+	int32 CharacterLevel;
+
+	/** Writes the baked init spec of AttributeInitClass at CharacterLevel into the attribute set */
+	void InitializeAttributes();
+
 	/* ----- Gameplay Ability System END ----- */
 
+	/* ----- Instant Replay START ----- */
+
+	/** Sends the last Seconds of the server's instant replay buffer to this character's owning client */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Replay")
+	void SendReplayClip(float Seconds);
+
+	/** One piece of a clip of TotalSize bytes, pieces arrive in order and the clip is decoded once the last one is in */
+	UFUNCTION(Client, Reliable)
+	void ClientReceiveReplayClipChunk(int32 TotalSize, int32 Offset, const TArray<uint8>& Chunk);
+
+	UPROPERTY(BlueprintAssignable, Category = "Replay")
+	FACM_OnReplayClipReceived OnReplayClipReceived;
+
+protected:
+
+	/** Clip being assembled on the owning client */
+	TArray<uint8> PendingReplayClip;
+
+	/* ----- Instant Replay END ----- */
+
 };
 
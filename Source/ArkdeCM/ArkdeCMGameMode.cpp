@@ -3,6 +3,19 @@
 #include "ArkdeCMGameMode.h"
 #include "ArkdeCMCharacter.h"
 #include "UObject/ConstructorHelpers.h"
+#include "Engine/World.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Startup/ACM_PrewarmSubsystem.h"
+#include "Startup/ACM_StartupProfiler.h"
+#include "Spectator/ACM_SpectatorSnapshot.h"
+#include "Persistence/ACM_CheckpointSubsystem.h"
+#include "GameplayAbility/ACM_AttributeInit.h"
+#include "Network/ACM_TimeSyncComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "AbilitySystemGlobals.h"
+#include "ArkdeCM/ArkdeCM.h"
 
 AArkdeCMGameMode::AArkdeCMGameMode()
 {
@@ -12,4 +25,330 @@ AArkdeCMGameMode::AArkdeCMGameMode()
 	{
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
+
+	PrewarmPawnPoolSize = 16;
+	bAwaitingMatchAssignment = false;
+	PrewarmReadySeconds = 0.0;
+	PendingPlayerSnapshotLifetime = 300.0f;
+
+	SpectatorSnapshotClass = AACM_SpectatorSnapshot::StaticClass();
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	CurrentMatchId = UGameplayStatics::ParseOption(Options, TEXT("ACMMatchId"));
+
+	// A pre-warmed server boots straight into its map but stays closed until the match host assigns it
+	bAwaitingMatchAssignment = UACM_PrewarmSubsystem::IsPrewarmMode() && CurrentMatchId.IsEmpty();
+
+	UACM_CheckpointSubsystem* CheckpointSubsystem = GetWorld()->GetSubsystem<UACM_CheckpointSubsystem>();
+	if (IsValid(CheckpointSubsystem))
+	{
+		CheckpointSubsystem->ResumeFromCommandLine(this);
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::StartPlay()
+{
+
+	Super::StartPlay();
+
+	// Bake attribute init specs before the first spawn needs them
+	const UClass* PawnClass = GetDefaultPawnClassForController(nullptr);
+	const AArkdeCMCharacter* DefaultCharacter = PawnClass != nullptr ? Cast<AArkdeCMCharacter>(PawnClass->GetDefaultObject()) : nullptr;
+	if (DefaultCharacter != nullptr)
+	{
+		FACM_AttributeInitRegistry::Bake(DefaultCharacter->AttributeInitTable);
+	}
+
+	if (bAwaitingMatchAssignment)
+	{
+		FillPawnPool();
+		PrewarmReadySeconds = FPlatformTime::Seconds();
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage)
+{
+
+	Super::PreLogin(Options, Address, UniqueId, ErrorMessage);
+
+	if (ErrorMessage.IsEmpty() && bAwaitingMatchAssignment)
+	{
+		ErrorMessage = TEXT("Server is waiting for a match assignment");
+	}
+
+}
+
+//=========================================================================================================================================================
+APawn* AArkdeCMGameMode::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform)
+{
+
+	UClass* PawnClass = GetDefaultPawnClassForController(NewPlayer);
+
+	for (int32 PoolIndex = PawnPool.Num() - 1; PoolIndex >= 0; PoolIndex--)
+	{
+
+		APawn* PooledPawn = PawnPool[PoolIndex];
+		if (!IsValid(PooledPawn) || PooledPawn->GetClass() != PawnClass)
+		{
+			continue;
+		}
+
+		PawnPool.RemoveAtSwap(PoolIndex);
+
+		PooledPawn->SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+		SetPooledPawnActive(PooledPawn, true);
+		RestorePendingPlayerSnapshot(NewPlayer, PooledPawn);
+
+		return PooledPawn;
+
+	}
+
+	// Restored in the spawn frame, so the pawn replicates once with the restored state
+	APawn* SpawnedPawn = Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, SpawnTransform);
+	RestorePendingPlayerSnapshot(NewPlayer, SpawnedPawn);
+
+	return SpawnedPawn;
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::PostLogin(APlayerController* NewPlayer)
+{
+
+	Super::PostLogin(NewPlayer);
+
+	// Added here rather than by a controller class, so Blueprint controllers get it too
+	if (IsValid(NewPlayer) && NewPlayer->FindComponentByClass<UACM_TimeSyncComponent>() == nullptr)
+	{
+		UACM_TimeSyncComponent* TimeSync = NewObject<UACM_TimeSyncComponent>(NewPlayer, TEXT("TimeSync"));
+		TimeSync->RegisterComponent();
+	}
+
+	if (IsValid(NewPlayer) && IsValid(NewPlayer->PlayerState) && NewPlayer->PlayerState->IsOnlyASpectator())
+	{
+		StartSpectatorSnapshots(NewPlayer);
+	}
+
+	UACM_CheckpointSubsystem* CheckpointSubsystem = GetWorld()->GetSubsystem<UACM_CheckpointSubsystem>();
+	float ResumedScore = 0.0f;
+
+	if (IsValid(CheckpointSubsystem) && IsValid(NewPlayer) && IsValid(NewPlayer->PlayerState) && CheckpointSubsystem->ConsumeResumedScore(GetPlayerSnapshotKey(NewPlayer), ResumedScore))
+	{
+		NewPlayer->PlayerState->SetScore(ResumedScore);
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::Logout(AController* Exiting)
+{
+
+	StopSpectatorSnapshots(Cast<APlayerController>(Exiting));
+
+	// Kept for a reconnect of the same player
+	const FString PlayerKey = GetPlayerSnapshotKey(Exiting);
+	const UAbilitySystemComponent* AbilitySystemComponent = IsValid(Exiting) ? UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Exiting->GetPawn()) : nullptr;
+
+	if (IsValid(AbilitySystemComponent) && Exiting->IsPlayerController() && !PlayerKey.IsEmpty())
+	{
+
+		PrunePendingPlayerSnapshots();
+
+		FPendingPlayerSnapshot& PendingSnapshot = PendingPlayerSnapshots.FindOrAdd(PlayerKey);
+		PendingSnapshot.Snapshot.Save(AbilitySystemComponent);
+		PendingSnapshot.ExpireTime = GetWorld()->GetRealTimeSeconds() + PendingPlayerSnapshotLifetime;
+
+	}
+
+	Super::Logout(Exiting);
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::StartSpectatorSnapshots(APlayerController* Spectator)
+{
+
+	if (!IsValid(Spectator) || !IsValid(SpectatorSnapshotClass) || SpectatorSnapshots.Contains(Spectator))
+	{
+		return;
+	}
+
+	if (IsValid(Spectator->PlayerState))
+	{
+		Spectator->PlayerState->SetIsSpectator(true);
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Spectator;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AACM_SpectatorSnapshot* Snapshot = GetWorld()->SpawnActor<AACM_SpectatorSnapshot>(SpectatorSnapshotClass, FTransform::Identity, SpawnParameters);
+	if (IsValid(Snapshot))
+	{
+		SpectatorSnapshots.Add(Spectator, Snapshot);
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::StopSpectatorSnapshots(APlayerController* Spectator)
+{
+
+	AACM_SpectatorSnapshot* Snapshot = nullptr;
+	if (Spectator == nullptr || !SpectatorSnapshots.RemoveAndCopyValue(Spectator, Snapshot))
+	{
+		return;
+	}
+
+	if (IsValid(Snapshot))
+	{
+		Snapshot->Destroy();
+	}
+
+	if (IsValid(Spectator->PlayerState) && !Spectator->PlayerState->IsOnlyASpectator())
+	{
+		Spectator->PlayerState->SetIsSpectator(false);
+	}
+
+}
+
+//=========================================================================================================================================================
+FString AArkdeCMGameMode::GetPlayerSnapshotKey(const AController* Controller)
+{
+
+	const APlayerState* PlayerState = IsValid(Controller) ? Controller->PlayerState : nullptr;
+	if (!IsValid(PlayerState))
+	{
+		return FString();
+	}
+
+	return PlayerState->GetUniqueId().IsValid() ? PlayerState->GetUniqueId().ToString() : PlayerState->GetPlayerName();
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::AddPendingPlayerSnapshot(const FString& PlayerKey, const FACM_PlayerSnapshot& Snapshot)
+{
+
+	if (PlayerKey.IsEmpty() || Snapshot.IsEmpty())
+	{
+		return;
+	}
+
+	PrunePendingPlayerSnapshots();
+
+	FPendingPlayerSnapshot& PendingSnapshot = PendingPlayerSnapshots.Add(PlayerKey);
+	PendingSnapshot.Snapshot = Snapshot;
+	PendingSnapshot.ExpireTime = GetWorld()->GetRealTimeSeconds() + PendingPlayerSnapshotLifetime;
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::RestorePendingPlayerSnapshot(AController* Controller, APawn* Pawn)
+{
+
+	PrunePendingPlayerSnapshots();
+
+	FPendingPlayerSnapshot PendingSnapshot;
+	if (!IsValid(Pawn) || !PendingPlayerSnapshots.RemoveAndCopyValue(GetPlayerSnapshotKey(Controller), PendingSnapshot))
+	{
+		return;
+	}
+
+	if (!PendingSnapshot.Snapshot.Restore(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Pawn)))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Could not restore the snapshot of %s"), *GetPlayerSnapshotKey(Controller));
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::PrunePendingPlayerSnapshots()
+{
+
+	const float RealTime = GetWorld()->GetRealTimeSeconds();
+
+	for (auto SnapshotIterator = PendingPlayerSnapshots.CreateIterator(); SnapshotIterator; ++SnapshotIterator)
+	{
+		if (SnapshotIterator.Value().ExpireTime <= RealTime)
+		{
+			UE_LOG(LogArkdeCM, Log, TEXT("Dropping the pending snapshot of %s, the player did not come back"), *SnapshotIterator.Key());
+			SnapshotIterator.RemoveCurrent();
+		}
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::StartAssignedMatch(const FString& MatchId, double AssignedSeconds)
+{
+
+	CurrentMatchId = MatchId;
+	bAwaitingMatchAssignment = false;
+
+	// MatchStart runs from the moment the host placed the match, so the assignment pickup latency is part of it; the idle wait since pre-warming finished is its own phase
+	if (PrewarmReadySeconds > 0.0)
+	{
+		FACM_StartupProfiler::RecordPhase(TEXT("Prewarm.AwaitingAssignment"), PrewarmReadySeconds);
+	}
+
+	FACM_StartupProfiler::RecordPhase(TEXT("MatchStart"), FMath::Min(AssignedSeconds, FPlatformTime::Seconds()));
+	UE_LOG(LogArkdeCM, Log, TEXT("Pre-warmed server opened for match %s with %d pooled pawns"), *MatchId, PawnPool.Num());
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::FillPawnPool()
+{
+
+	FACM_ScopedStartupPhase PoolPhase(TEXT("Prewarm.PawnPool"));
+
+	UClass* PawnClass = GetDefaultPawnClassForController(nullptr);
+	if (!IsValid(PawnClass))
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	for (int32 PawnIndex = 0; PawnIndex < PrewarmPawnPoolSize; PawnIndex++)
+	{
+
+		APawn* PooledPawn = GetWorld()->SpawnActor<APawn>(PawnClass, FTransform::Identity, SpawnParameters);
+		if (IsValid(PooledPawn))
+		{
+			SetPooledPawnActive(PooledPawn, false);
+			PawnPool.Add(PooledPawn);
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void AArkdeCMGameMode::SetPooledPawnActive(APawn* Pawn, bool bActive)
+{
+
+	Pawn->SetActorHiddenInGame(!bActive);
+	Pawn->SetActorEnableCollision(bActive);
+	Pawn->SetActorTickEnabled(bActive);
+	Pawn->SetReplicates(bActive);
+
+	if (IsValid(Pawn->GetMovementComponent()))
+	{
+		Pawn->GetMovementComponent()->SetComponentTickEnabled(bActive);
+	}
+
 }
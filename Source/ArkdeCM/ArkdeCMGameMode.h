@@ -4,8 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Persistence/ACM_PlayerSnapshot.h"
 #include "ArkdeCMGameMode.generated.h"
 
+class AACM_SpectatorSnapshot;
+
 UCLASS(minimalapi)
 class AArkdeCMGameMode : public AGameModeBase
 {
@@ -13,6 +16,112 @@ class AArkdeCMGameMode : public AGameModeBase
 
 public:
 	AArkdeCMGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	virtual void StartPlay() override;
+
+	virtual void PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage) override;
+
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
+
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+
+	virtual void Logout(AController* Exiting) override;
+
+	/* ----- Pre-warm START ----- */
+
+	/** True while a pre-warmed server sits idle waiting for the match host to assign it a match */
+	bool IsAwaitingMatchAssignment() const { return bAwaitingMatchAssignment; }
+
+	const FString& GetCurrentMatchId() const { return CurrentMatchId; }
+
+	/** Opens a pre-warmed server to players for the given match without any travel, AssignedSeconds is when the host placed it */
+	void StartAssignedMatch(const FString& MatchId, double AssignedSeconds);
+
+	/** Pawns spawned, granted and hidden ahead of time on pre-warmed servers */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Pre-warm")
+	int32 PrewarmPawnPoolSize;
+
+protected:
+
+	void FillPawnPool();
+
+	void SetPooledPawnActive(APawn* Pawn, bool bActive);
+
+	UPROPERTY(Transient)
+	TArray<APawn*> PawnPool;
+
+	bool bAwaitingMatchAssignment;
+
+	/** FPlatformTime at which pre-warming finished and the server started waiting for an assignment */
+	double PrewarmReadySeconds;
+
+	FString CurrentMatchId;
+
+	/* ----- Pre-warm END ----- */
+
+	/* ----- Spectators START ----- */
+
+public:
+
+	/**
+	 * Moves a player, e.g. a dead one, to the low-rate spectator channel. Characters stop replicating to them and
+	 * an AACM_SpectatorSnapshot sends what they need to watch. Spectator-only players join it on login
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Spectator")
+	void StartSpectatorSnapshots(APlayerController* Spectator);
+
+	UFUNCTION(BlueprintCallable, Category = "Spectator")
+	void StopSpectatorSnapshots(APlayerController* Spectator);
+
+	bool HasSpectatorSnapshots(const APlayerController* Spectator) const { return SpectatorSnapshots.Contains(Spectator); }
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Spectator")
+	TSubclassOf<AACM_SpectatorSnapshot> SpectatorSnapshotClass;
+
+protected:
+
+	UPROPERTY(Transient)
+	TMap<APlayerController*, AACM_SpectatorSnapshot*> SpectatorSnapshots;
+
+	/* ----- Spectators END ----- */
+
+	/* ----- Player snapshots START ----- */
+
+public:
+
+	/** Players are matched by unique net id, or by name when there is none */
+	static FString GetPlayerSnapshotKey(const AController* Controller);
+
+	/**
+	 * Restored into the player's next pawn as it spawns. Filled on logout for reconnects, or by whatever moves a match
+	 * to this process. Dropped after PendingPlayerSnapshotLifetime if the player does not come back
+	 */
+	void AddPendingPlayerSnapshot(const FString& PlayerKey, const FACM_PlayerSnapshot& Snapshot);
+
+	/** Seconds a pending snapshot waits for its player */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Player snapshots", meta = (ClampMin = "0"))
+	float PendingPlayerSnapshotLifetime;
+
+protected:
+
+	struct FPendingPlayerSnapshot
+	{
+		FACM_PlayerSnapshot Snapshot;
+
+		/** Real time of the world after which the snapshot is dropped */
+		float ExpireTime = 0.0f;
+	};
+
+	void RestorePendingPlayerSnapshot(AController* Controller, APawn* Pawn);
+
+	/** Drops the snapshots of players that did not come back in time */
+	void PrunePendingPlayerSnapshots();
+
+	TMap<FString, FPendingPlayerSnapshot> PendingPlayerSnapshots;
+
+	/* ----- Player snapshots END ----- */
 };
 
 
@@ -0,0 +1,661 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_GameplayEffect.h"
+#include "GameplayAbility/ACM_GameplayAbility.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "GameplayAbility/ACM_GameplayTags.h"
+#include "GameplayAbility/Tasks/ACM_AbilityTask.h"
+#include "Replay/ACM_InstantReplaySubsystem.h"
+#include "Replay/ACM_GASReplaySubsystem.h"
+#include "GameplayCueManager.h"
+#include "GameplayEffectAggregator.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+#include "Engine/Canvas.h"
+#include "Engine/World.h"
+#include "UObject/UObjectIterator.h"
+#include "DisplayDebugHelpers.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effects Rejected By Tag Masks"), STAT_ACM_EffectMaskRejects, STATGROUP_ArkdeCM);
+DECLARE_CYCLE_STAT(TEXT("Batched Effect Removal"), STAT_ACM_RemoveActiveEffectsBatched, STATGROUP_ArkdeCM);
+
+namespace ACM_AbilitySystemComponent
+{
+
+	static TAutoConsoleVariable<int32> CVarAbilityTaskPoolSize(
+		TEXT("ACM.AbilityTasks.PoolSize"),
+		8,
+		TEXT("Finished ability tasks each ability system component keeps for reuse. 0 disables pooling."),
+		ECVF_Default);
+
+	static bool GrantsApplicationImmunity(const UGameplayEffect* Effect)
+	{
+		return !Effect->GrantedApplicationImmunityTags.IsEmpty() || !Effect->GrantedApplicationImmunityQuery.IsEmpty();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::InitializeComponent()
+{
+
+	Super::InitializeComponent();
+
+	OnActiveGameplayEffectAddedDelegateToSelf.AddUObject(this, &UACM_AbilitySystemComponent::HandleActiveEffectAdded);
+	OnAnyGameplayEffectRemovedDelegate().AddUObject(this, &UACM_AbilitySystemComponent::HandleActiveEffectRemoved);
+
+}
+
+//=========================================================================================================================================================
+FActiveGameplayEffectHandle UACM_AbilitySystemComponent::ApplyGameplayEffectSpecToSelf(const FGameplayEffectSpec& GameplayEffect, FPredictionKey PredictionKey)
+{
+
+	if (IsBlockedByTagMasks(GameplayEffect))
+	{
+		INC_DWORD_STAT(STAT_ACM_EffectMaskRejects);
+		return FActiveGameplayEffectHandle();
+	}
+
+	return Super::ApplyGameplayEffectSpecToSelf(GameplayEffect, PredictionKey);
+
+}
+
+//=========================================================================================================================================================
+FGameplayEffectSpecHandle UACM_AbilitySystemComponent::MakeOutgoingSpec(TSubclassOf<UGameplayEffect> GameplayEffectClass, float Level, FGameplayEffectContextHandle Context) const
+{
+
+	FGameplayEffectSpecHandle SpecHandle = Super::MakeOutgoingSpec(GameplayEffectClass, Level, Context);
+
+	FGameplayEffectSpec* Spec = SpecHandle.Data.Get();
+	const UACM_GameplayEffect* Effect = Spec != nullptr ? Cast<UACM_GameplayEffect>(Spec->Def) : nullptr;
+	if (Effect == nullptr)
+	{
+		return SpecHandle;
+	}
+
+	const FACM_EffectTuning Tuning = Effect->GetTuning();
+
+	// The spec evaluated its duration curve on creation and would evaluate it again on application. Locking it to the
+	// cached value skips the second key search. A locked duration ignores later sets, so a tuned one is resolved first
+	float Value = 0.0f;
+	if (Effect->DurationPolicy == EGameplayEffectDurationType::HasDuration && (Tuning.TryGetDuration(Value) || Effect->TryGetDurationAtLevel(Spec->GetLevel(), Value)))
+	{
+		Spec->SetDuration(Value, true);
+	}
+
+	if (Tuning.IsEmpty())
+	{
+		return SpecHandle;
+	}
+
+	// Only retunes effects that are periodic already, a period on anything else would start executing it
+	if (Spec->GetPeriod() > 0.0f && Tuning.TryGetPeriod(Value))
+	{
+		Spec->Period = Value;
+	}
+
+	if (Tuning.TryGetMagnitude(Value))
+	{
+		Spec->SetSetByCallerMagnitude(FACM_GameplayTags::Get().Data_Magnitude, Value);
+	}
+
+	return SpecHandle;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::OverrideDuration(FGameplayEffectSpec& Spec, float Duration)
+{
+
+	Spec.bDurationLocked = false;
+	Spec.SetDuration(Duration, true);
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_AbilitySystemComponent::RemoveActiveEffectsBatched(const FGameplayEffectQuery& Query, int32 StacksToRemove)
+{
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_RemoveActiveEffectsBatched);
+
+	TArray<UACM_AttributeSet*, TInlineAllocator<2>> AttributeSets;
+	TArray<TArray<float>, TInlineAllocator<2>> OldValues;
+
+	for (UAttributeSet* Set : GetSpawnedAttributes_Mutable())
+	{
+		if (UACM_AttributeSet* AttributeSet = Cast<UACM_AttributeSet>(Set))
+		{
+			AttributeSets.Add(AttributeSet);
+			AttributeSet->CaptureAttributeValues(OldValues.AddDefaulted_GetRef());
+		}
+	}
+
+	int32 NumRemoved = 0;
+	{
+
+		FScopedGameplayCueSendContext GameplayCueSendContext;
+
+		// On its own the batch is evaluated when it ends, with the Max ordering of the frame batch. Inside the frame
+		// batch it only nests
+		UACM_AttributeSet::BeginAggregationBatch();
+		NumRemoved = RemoveActiveEffects(Query, StacksToRemove);
+		UACM_AttributeSet::EndAggregationBatch(GetWorld());
+
+	}
+
+	// Inside the frame batch nothing was evaluated yet, the notifications need the final values now. Without one this does nothing
+	UACM_AttributeSet::FlushDeferredAggregation(this);
+
+	for (int32 SetIndex = 0; SetIndex < AttributeSets.Num(); SetIndex++)
+	{
+		AttributeSets[SetIndex]->BroadcastBatchChanges(OldValues[SetIndex]);
+	}
+
+	return NumRemoved;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilitySystemComponent::IsAttributeAggregationPending(const FGameplayAttribute& Attribute) const
+{
+
+	if (FScopedAggregatorOnDirtyBatch::DirtyAggregators.Num() == 0)
+	{
+		return false;
+	}
+
+	// Attributes no effect has touched have no aggregator, and nothing pending
+	const FAggregatorRef* AggregatorRef = ActiveGameplayEffects.AttributeAggregatorMap.Find(Attribute);
+	return AggregatorRef != nullptr && FScopedAggregatorOnDirtyBatch::DirtyAggregators.Contains(AggregatorRef->Get());
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::SetAggregatorBaseValue(const FGameplayAttribute& Attribute, float BaseValue, bool bEvaluate)
+{
+
+	// An aggregator outlives the effects that created it and keeps its own copy of the base
+	FAggregatorRef& AggregatorRef = ActiveGameplayEffects.FindOrCreateAttributeAggregator(Attribute);
+	if (AggregatorRef.Get() != nullptr)
+	{
+		AggregatorRef.Get()->SetBaseValue(BaseValue, bEvaluate);
+	}
+
+}
+
+//=========================================================================================================================================================
+const FACM_TagBits& UACM_AbilitySystemComponent::GetOwnedTagBits()
+{
+
+	if (OwnedTagBitsGeneration != FACM_TagIndex::GetGeneration())
+	{
+		RebuildOwnedTagBits();
+	}
+
+	return OwnedTagBits;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilitySystemComponent::HasPublicTag(FGameplayTag Tag) const
+{
+
+	const int32 TagIndex = FACM_GameplayTags::Get().GetPublicTagIndex(Tag);
+	if (TagIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	return PublicTagState.HasTag(TagIndex);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The owner needs it too, loose tags reach no client
+	DOREPLIFETIME(UACM_AbilitySystemComponent, PublicTagState);
+
+	// Replays get start and stop events from the compact GAS stream instead of container diffs
+	if (UACM_GASReplaySubsystem::IsCompactStreamEnabled())
+	{
+		RESET_REPLIFETIME_CONDITION(UAbilitySystemComponent, ActiveGameplayEffects, COND_SkipReplay);
+	}
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilitySystemComponent::IsActivationGroupBlocked(EACM_AbilityActivationGroup Group) const
+{
+
+	const bool bBlockingActive = (ActiveGroupMask & (1 << static_cast<uint8>(EACM_AbilityActivationGroup::Exclusive_Blocking))) != 0;
+	return bBlockingActive && Group != EACM_AbilityActivationGroup::Independent;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::NotifyAbilityActivated(const FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability)
+{
+
+	Super::NotifyAbilityActivated(Handle, Ability);
+
+	UACM_InstantReplaySubsystem* ReplaySubsystem = GetWorld()->GetSubsystem<UACM_InstantReplaySubsystem>();
+	if (IsValid(ReplaySubsystem))
+	{
+		ReplaySubsystem->RecordAbilityActivation(GetAvatarActor(), Ability);
+	}
+
+	const UACM_GameplayAbility* ArkdeAbility = Cast<UACM_GameplayAbility>(Ability);
+	if (ArkdeAbility == nullptr)
+	{
+		return;
+	}
+
+	const uint8 Group = static_cast<uint8>(ArkdeAbility->ActivationGroup);
+
+	// An exclusive activation replaces whatever replaceable ability is running
+	if ((ExclusiveGroupMask & (1 << Group)) != 0 && (ActiveGroupMask & (1 << static_cast<uint8>(EACM_AbilityActivationGroup::Exclusive_Replaceable))) != 0)
+	{
+		CancelReplaceableAbilities(Handle);
+	}
+
+	ActivationGroupCounts[Group]++;
+	ActiveGroupMask |= 1 << Group;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::NotifyAbilityEnded(FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability, bool bWasCancelled)
+{
+
+	Super::NotifyAbilityEnded(Handle, Ability, bWasCancelled);
+
+	const UACM_GameplayAbility* ArkdeAbility = Cast<UACM_GameplayAbility>(Ability);
+	if (ArkdeAbility == nullptr)
+	{
+		return;
+	}
+
+	const uint8 Group = static_cast<uint8>(ArkdeAbility->ActivationGroup);
+	if (!ensure(ActivationGroupCounts[Group] > 0))
+	{
+		return;
+	}
+
+	ActivationGroupCounts[Group]--;
+	if (ActivationGroupCounts[Group] == 0)
+	{
+		ActiveGroupMask &= ~(1 << Group);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::DisplayDebug(UCanvas* Canvas, const FDebugDisplayInfo& DebugDisplay, float& YL, float& YPos)
+{
+
+	Super::DisplayDebug(Canvas, DebugDisplay, YL, YPos);
+
+	FDisplayDebugManager& DisplayDebugManager = Canvas->DisplayDebugManager;
+	DisplayDebugManager.SetDrawColor(FColor::Cyan);
+	DisplayDebugManager.DrawString(FString::Printf(TEXT("Activation groups (mask 0x%02x)"), ActiveGroupMask));
+
+	const UEnum* GroupEnum = StaticEnum<EACM_AbilityActivationGroup>();
+	for (uint8 Group = 0; Group < static_cast<uint8>(EACM_AbilityActivationGroup::MAX); Group++)
+	{
+		DisplayDebugManager.SetDrawColor(ActivationGroupCounts[Group] > 0 ? FColor::Green : FColor::White);
+		DisplayDebugManager.DrawString(FString::Printf(TEXT("    %s: %d"), *GroupEnum->GetNameStringByValue(Group), ActivationGroupCounts[Group]));
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::OnTagUpdated(const FGameplayTag& Tag, bool TagExists)
+{
+
+	Super::OnTagUpdated(Tag, TagExists);
+
+	if (IsOwnerActorAuthoritative())
+	{
+		UpdatePublicTagState(Tag);
+	}
+
+	// A stale bitset is rebuilt in full on its next read
+	if (OwnedTagBitsGeneration != FACM_TagIndex::GetGeneration())
+	{
+		return;
+	}
+
+	// Parents may still be matched through other owned children, so the affected bits are read back from the counts
+	const FACM_TagBits AffectedBits = FACM_TagIndex::GetMatchingBits(Tag);
+	AffectedBits.ForEachSetBit([this](int32 BitIndex)
+	{
+		OwnedTagBits.SetBit(BitIndex, GameplayTagCountContainer.HasMatchingGameplayTag(FACM_TagIndex::GetTag(BitIndex)));
+	});
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilitySystemComponent::IsBlockedByTagMasks(const FGameplayEffectSpec& Spec)
+{
+
+	// Replicated tag counts on clients do not go through OnTagUpdated, only the authority keeps exact bits
+	const UACM_GameplayEffect* Effect = Cast<UACM_GameplayEffect>(Spec.Def);
+	if (Effect == nullptr || !IsOwnerActorAuthoritative() || InexactImmunityHandles.Num() > 0)
+	{
+		return false;
+	}
+
+	// The engine rolls the chance before checking requirements, rejecting first would change the random sequence
+	if (Spec.GetChanceToApplyToTarget() < 1.0f - SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const UACM_GameplayEffect::FTagMasks& TagMasks = Effect->GetTagMasks();
+	if (!TagMasks.bApplicationExact)
+	{
+		return false;
+	}
+
+	// Immunity runs first in the engine and has its own callback, so a possible immunity is left to the full check
+	if (ImmunityEffects.Num() > 0)
+	{
+
+		const FGameplayTagContainer* SourceTags = Spec.CapturedSourceTags.GetAggregatedTags();
+		if (SourceTags == nullptr)
+		{
+			return false;
+		}
+
+		const FACM_TagBits SourceBits = FACM_TagIndex::MakeOwnedBits(*SourceTags);
+		for (const FImmunityEntry& ImmunityEntry : ImmunityEffects)
+		{
+			const UACM_GameplayEffect::FTagMasks& ImmunityMasks = ImmunityEntry.Effect->GetTagMasks();
+			if (SourceBits.HasAll(ImmunityMasks.ImmunityRequireBits) && !SourceBits.HasAny(ImmunityMasks.ImmunityIgnoreBits))
+			{
+				return false;
+			}
+		}
+
+	}
+
+	const FACM_TagBits& TargetBits = GetOwnedTagBits();
+	return !TargetBits.HasAll(TagMasks.ApplicationRequireBits) || TargetBits.HasAny(TagMasks.ApplicationIgnoreBits);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::RebuildOwnedTagBits()
+{
+
+	FGameplayTagContainer OwnedTags;
+	GetOwnedGameplayTags(OwnedTags);
+
+	OwnedTagBits = FACM_TagIndex::MakeOwnedBits(OwnedTags);
+	OwnedTagBitsGeneration = FACM_TagIndex::GetGeneration();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::UpdatePublicTagState(const FGameplayTag& Tag)
+{
+
+	const TArray<FGameplayTag>& PublicTags = FACM_GameplayTags::Get().PublicTags;
+	for (int32 TagIndex = 0; TagIndex < PublicTags.Num(); TagIndex++)
+	{
+		if (Tag.MatchesTag(PublicTags[TagIndex]))
+		{
+			PublicTagState.SetTag(TagIndex, GameplayTagCountContainer.HasMatchingGameplayTag(PublicTags[TagIndex]));
+		}
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::CancelReplaceableAbilities(const FGameplayAbilitySpecHandle& IgnoreHandle)
+{
+
+	// Cancelling ends abilities and changes the counts, collect first
+	TArray<FGameplayAbilitySpecHandle, TInlineAllocator<4>> HandlesToCancel;
+
+	for (const FGameplayAbilitySpec& AbilitySpec : ActivatableAbilities.Items)
+	{
+
+		const UACM_GameplayAbility* ArkdeAbility = Cast<UACM_GameplayAbility>(AbilitySpec.Ability);
+		if (AbilitySpec.IsActive() && AbilitySpec.Handle != IgnoreHandle && ArkdeAbility != nullptr && ArkdeAbility->ActivationGroup == EACM_AbilityActivationGroup::Exclusive_Replaceable)
+		{
+			HandlesToCancel.Add(AbilitySpec.Handle);
+		}
+
+	}
+
+	for (const FGameplayAbilitySpecHandle& HandleToCancel : HandlesToCancel)
+	{
+		CancelAbilityHandle(HandleToCancel);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::HandleActiveEffectAdded(UAbilitySystemComponent* Target, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle)
+{
+
+	// Stacking onto an existing effect reports the same handle again, the stack change binding records that instead
+	FOnActiveGameplayEffectStackChange* StackChangeDelegate = OnGameplayEffectStackChangeDelegate(Handle);
+	if (StackChangeDelegate == nullptr || !StackChangeDelegate->IsBoundToObject(this))
+	{
+
+		if (StackChangeDelegate != nullptr)
+		{
+			StackChangeDelegate->AddUObject(this, &UACM_AbilitySystemComponent::HandleActiveEffectStackChanged);
+		}
+
+		UACM_GASReplaySubsystem* GASReplaySubsystem = GetWorld()->GetSubsystem<UACM_GASReplaySubsystem>();
+		if (IsValid(GASReplaySubsystem))
+		{
+			GASReplaySubsystem->RecordEffectStarted(this, Spec, Handle);
+		}
+
+	}
+
+	if (!Handle.IsValid() || !ACM_AbilitySystemComponent::GrantsApplicationImmunity(Spec.Def))
+	{
+		return;
+	}
+
+	// Stacking onto an existing effect reports the same handle again
+	const bool bAlreadyTracked = InexactImmunityHandles.Contains(Handle) || ImmunityEffects.ContainsByPredicate([&Handle](const FImmunityEntry& ImmunityEntry)
+	{
+		return ImmunityEntry.Handle == Handle;
+	});
+
+	if (bAlreadyTracked)
+	{
+		return;
+	}
+
+	const UACM_GameplayEffect* Effect = Cast<UACM_GameplayEffect>(Spec.Def);
+	if (Effect != nullptr && Effect->GetTagMasks().bImmunityExact)
+	{
+		ImmunityEffects.Add({ Handle, Effect });
+	}
+	else
+	{
+		InexactImmunityHandles.Add(Handle);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::HandleActiveEffectStackChanged(FActiveGameplayEffectHandle Handle, int32 NewStackCount, int32 PreviousStackCount)
+{
+
+	UACM_GASReplaySubsystem* GASReplaySubsystem = GetWorld()->GetSubsystem<UACM_GASReplaySubsystem>();
+	if (IsValid(GASReplaySubsystem))
+	{
+		GASReplaySubsystem->RecordEffectStackChanged(this, Handle, NewStackCount);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilitySystemComponent::HandleActiveEffectRemoved(const FActiveGameplayEffect& Effect)
+{
+
+	UACM_GASReplaySubsystem* GASReplaySubsystem = GetWorld()->GetSubsystem<UACM_GASReplaySubsystem>();
+	if (IsValid(GASReplaySubsystem))
+	{
+		GASReplaySubsystem->RecordEffectStopped(this, Effect);
+	}
+
+	if (!ACM_AbilitySystemComponent::GrantsApplicationImmunity(Effect.Spec.Def))
+	{
+		return;
+	}
+
+	ImmunityEffects.RemoveAllSwap([&Effect](const FImmunityEntry& ImmunityEntry)
+	{
+		return ImmunityEntry.Handle == Effect.Handle;
+	});
+
+	InexactImmunityHandles.RemoveSwap(Effect.Handle);
+
+}
+
+//=========================================================================================================================================================
+UACM_AbilityTask* UACM_AbilitySystemComponent::TakePooledAbilityTask(UClass* TaskClass)
+{
+
+	for (int32 TaskIndex = PooledAbilityTasks.Num() - 1; TaskIndex >= 0; TaskIndex--)
+	{
+
+		UACM_AbilityTask* Task = PooledAbilityTasks[TaskIndex];
+		if (Task->GetClass() == TaskClass && Task->GetReleasedFrame() < GFrameCounter)
+		{
+			PooledAbilityTasks.RemoveAtSwap(TaskIndex);
+			return Task;
+		}
+
+	}
+
+	return nullptr;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilitySystemComponent::ReturnPooledAbilityTask(UACM_AbilityTask* Task)
+{
+
+	if (PooledAbilityTasks.Num() >= ACM_AbilitySystemComponent::CVarAbilityTaskPoolSize.GetValueOnGameThread())
+	{
+		return false;
+	}
+
+	PooledAbilityTasks.Add(Task);
+	return true;
+
+}
+
+//=========================================================================================================================================================
+static void VerifyTunedDurations(const TArray<FString>& Args, UWorld* World)
+{
+
+	if (!IsValid(World))
+	{
+		return;
+	}
+
+	if (!FACM_TuningTable::IsLoaded())
+	{
+		UE_LOG(LogArkdeCM, Display, TEXT("No tuning table is loaded, there are no tuned durations to check"));
+		return;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+
+	UACM_AbilitySystemComponent* AbilityComponent = NewObject<UACM_AbilitySystemComponent>(Actor);
+	AbilityComponent->RegisterComponent();
+	AbilityComponent->InitAbilityActorInfo(Actor, Actor);
+
+	int32 NumCases = 0;
+	int32 NumMismatches = 0;
+
+	auto CheckDuration = [&NumCases, &NumMismatches](const UClass* OwnerClass, const FGameplayEffectSpecHandle& SpecHandle, float TunedDuration)
+	{
+
+		NumCases++;
+
+		const float Duration = SpecHandle.IsValid() ? SpecHandle.Data->GetDuration() : 0.0f;
+		if (!FMath::IsNearlyEqual(Duration, TunedDuration))
+		{
+			NumMismatches++;
+			UE_LOG(LogArkdeCM, Warning, TEXT("  %s: tuned %.3f s, spec %.3f s"), *OwnerClass->GetName(), TunedDuration, Duration);
+		}
+
+	};
+
+	// Same order as the live paths: MakeOutgoingSpec for effects, then OverrideDuration in UACM_GameplayAbility::ApplyCooldown
+	for (TObjectIterator<UClass> ClassIterator; ClassIterator; ++ClassIterator)
+	{
+
+		UClass* Class = *ClassIterator;
+		if (Class->HasAnyClassFlags(CLASS_Abstract))
+		{
+			continue;
+		}
+
+		float TunedDuration = 0.0f;
+
+		if (Class->IsChildOf(UACM_GameplayEffect::StaticClass()))
+		{
+
+			const UACM_GameplayEffect* Effect = Class->GetDefaultObject<UACM_GameplayEffect>();
+			if (Effect->DurationPolicy == EGameplayEffectDurationType::HasDuration && Effect->GetTuning().TryGetDuration(TunedDuration))
+			{
+				CheckDuration(Class, AbilityComponent->MakeOutgoingSpec(Class, 1.0f, AbilityComponent->MakeEffectContext()), TunedDuration);
+			}
+
+		}
+		else if (Class->IsChildOf(UACM_GameplayAbility::StaticClass()))
+		{
+
+			const UACM_GameplayAbility* Ability = Class->GetDefaultObject<UACM_GameplayAbility>();
+			const UGameplayEffect* CooldownEffect = Ability->GetCooldownGameplayEffect();
+
+			if (CooldownEffect != nullptr && Ability->GetTuning().TryGetCooldown(TunedDuration))
+			{
+
+				FGameplayEffectSpecHandle SpecHandle = AbilityComponent->MakeOutgoingSpec(CooldownEffect->GetClass(), 1.0f, AbilityComponent->MakeEffectContext());
+				if (SpecHandle.IsValid())
+				{
+					UACM_AbilitySystemComponent::OverrideDuration(*SpecHandle.Data, TunedDuration);
+				}
+
+				CheckDuration(Class, SpecHandle, TunedDuration);
+
+			}
+
+		}
+
+	}
+
+	Actor->Destroy();
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Tuned durations: %d cases, %d mismatches"), NumCases, NumMismatches);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarVerifyTunedDurations(
+	TEXT("ACM.Tuning.VerifyDurations"),
+	TEXT("Builds a spec for every loaded effect with a tuned duration and every ability with a tuned cooldown, and reports specs that do not carry the tuned value"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&VerifyTunedDurations));
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_AttributeInit.h"
+#include "Engine/CurveTable.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_CYCLE_STAT(TEXT("Attribute Init Bake"), STAT_ACM_AttributeInitBake, STATGROUP_ArkdeCM);
+
+namespace ACM_AttributeInit
+{
+
+	/** Specs of one class, index 0 is level 1 */
+	struct FClassSpecs
+	{
+		TArray<FACM_AttributeInitSpec> Levels;
+	};
+
+	struct FBakedTable
+	{
+		TMap<FName, FClassSpecs> Classes;
+		FDelegateHandle TableChangedHandle;
+	};
+
+	static TMap<TWeakObjectPtr<const UCurveTable>, FBakedTable> BakedTables;
+
+	/** Sanity limit on the level range read from a curve */
+	static const int32 MaxLevel = 1000;
+
+	static int32 FindAttributeIndex(const FString& AttributeName)
+	{
+		return UACM_AttributeSet::GetAllAttributes().IndexOfByPredicate([&AttributeName](const FGameplayAttribute& Attribute)
+		{
+			return Attribute.GetName() == AttributeName;
+		});
+	}
+
+}
+
+//=========================================================================================================================================================
+void FACM_AttributeInitRegistry::Bake(const UCurveTable* Table)
+{
+
+	using namespace ACM_AttributeInit;
+
+	if (Table == nullptr || BakedTables.Contains(Table))
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_AttributeInitBake);
+
+	const int32 NumAttributes = UACM_AttributeSet::GetAllAttributes().Num();
+	FBakedTable& BakedTable = BakedTables.Add(Table);
+	TMap<FName, FClassSpecs>& ClassSpecs = BakedTable.Classes;
+
+	for (const TPair<FName, FRealCurve*>& RowPair : Table->GetRowMap())
+	{
+
+		FString ClassName;
+		FString AttributeName;
+
+		if (RowPair.Value == nullptr || !RowPair.Key.ToString().Split(TEXT("."), &ClassName, &AttributeName, ESearchCase::IgnoreCase, ESearchDir::FromEnd))
+		{
+			continue;
+		}
+
+		const int32 AttributeIndex = FindAttributeIndex(AttributeName);
+		if (AttributeIndex == INDEX_NONE || AttributeIndex >= 32)
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("%s: row %s does not name an attribute of UACM_AttributeSet"), *Table->GetName(), *RowPair.Key.ToString());
+			continue;
+		}
+
+		float MinTime = 0.0f;
+		float MaxTime = 0.0f;
+		RowPair.Value->GetTimeRange(MinTime, MaxTime);
+
+		const int32 NumLevels = FMath::Clamp(FMath::CeilToInt(MaxTime), 1, MaxLevel);
+
+		FClassSpecs& Specs = ClassSpecs.FindOrAdd(FName(*ClassName));
+		while (Specs.Levels.Num() < NumLevels)
+		{
+			FACM_AttributeInitSpec& Spec = Specs.Levels.AddDefaulted_GetRef();
+			Spec.Values.SetNumZeroed(NumAttributes);
+		}
+
+		for (int32 LevelIndex = 0; LevelIndex < Specs.Levels.Num(); LevelIndex++)
+		{
+			Specs.Levels[LevelIndex].Values[AttributeIndex] = RowPair.Value->Eval(LevelIndex + 1);
+			Specs.Levels[LevelIndex].Mask |= 1u << AttributeIndex;
+		}
+
+	}
+
+	// Rows with fewer keys than the longest row of their class keep their last value
+	for (TPair<FName, FClassSpecs>& ClassPair : ClassSpecs)
+	{
+		TArray<FACM_AttributeInitSpec>& Levels = ClassPair.Value.Levels;
+		for (int32 LevelIndex = 1; LevelIndex < Levels.Num(); LevelIndex++)
+		{
+			const uint32 MissingMask = Levels[LevelIndex - 1].Mask & ~Levels[LevelIndex].Mask;
+			for (int32 AttributeIndex = 0; AttributeIndex < NumAttributes; AttributeIndex++)
+			{
+				if ((MissingMask & (1u << AttributeIndex)) != 0)
+				{
+					Levels[LevelIndex].Values[AttributeIndex] = Levels[LevelIndex - 1].Values[AttributeIndex];
+				}
+			}
+			Levels[LevelIndex].Mask |= MissingMask;
+		}
+	}
+
+#if WITH_EDITOR
+	BakedTable.TableChangedHandle = const_cast<UCurveTable*>(Table)->OnCurveTableChanged().AddStatic(&FACM_AttributeInitRegistry::Invalidate, Table);
+#endif
+
+}
+
+//=========================================================================================================================================================
+const FACM_AttributeInitSpec* FACM_AttributeInitRegistry::FindSpec(const UCurveTable* Table, FName InitClass, int32 Level)
+{
+
+	using namespace ACM_AttributeInit;
+
+	if (Table == nullptr || InitClass.IsNone())
+	{
+		return nullptr;
+	}
+
+	Bake(Table);
+
+	const FClassSpecs* Specs = BakedTables.FindChecked(Table).Classes.Find(InitClass);
+	if (Specs == nullptr || Specs->Levels.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	return &Specs->Levels[FMath::Clamp(Level, 1, Specs->Levels.Num()) - 1];
+
+}
+
+//=========================================================================================================================================================
+void FACM_AttributeInitRegistry::Invalidate(const UCurveTable* Table)
+{
+
+	ACM_AttributeInit::FBakedTable BakedTable;
+	if (!ACM_AttributeInit::BakedTables.RemoveAndCopyValue(Table, BakedTable))
+	{
+		return;
+	}
+
+#if WITH_EDITOR
+	const_cast<UCurveTable*>(Table)->OnCurveTableChanged().Remove(BakedTable.TableChangedHandle);
+#endif
+
+}
@@ -5,6 +5,357 @@
 #include "GameplayEffectExtension.h"
 #include <AttributeSet.h>
 #include <Net/UnrealNetwork.h>
+#include "GameplayEffectAggregator.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "GameplayAbility/ACM_FixedPoint.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_AttributeInit.h"
+#include "GameplayAbility/ACM_ContentId.h"
+#include "Tuning/ACM_TuningTable.h"
+#include "GameplayAbility/ACM_DamageHistoryComponent.h"
+#include "Replay/ACM_GASReplaySubsystem.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+namespace ACM_DeferredAggregation
+{
+
+	static TAutoConsoleVariable<int32> CVarDeferredAggregation(
+		TEXT("ACM.Attributes.DeferredAggregation"),
+		0,
+		TEXT("1 batches attribute aggregation on the server from world tick start until actors have ticked, so each attribute is evaluated once per frame."),
+		ECVF_Default);
+
+	static FDelegateHandle TickStartHandle;
+	static FDelegateHandle PostActorTickHandle;
+	static FDelegateHandle WorldCleanupHandle;
+
+	struct FWorldBatch
+	{
+		/** True while the frame lock taken in HandleWorldTickStart is held */
+		bool bFrameBatchOpen = false;
+
+		/** True while the batch is evaluated, Max changes are queued instead of rescaling right away */
+		bool bFlushing = false;
+
+		TArray<TWeakObjectPtr<UACM_AttributeSet>> SetsWithPendingMaxChanges;
+	};
+
+	/** Keyed by world, so several worlds in one process (PIE, multiple servers) never close or flush each other's batch */
+	static TMap<TWeakObjectPtr<const UWorld>, FWorldBatch> WorldBatches;
+
+	/**
+	 * Locks taken through BeginAggregationBatch. The aggregator lock itself is process wide, this tells our own locks
+	 * apart from the net receive lock, which must never be flushed early
+	 */
+	static int32 NumOwnedLocks = 0;
+
+	static void HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+	{
+
+		// Clients get final values through replication, and their net receive would break the frame lock
+		if (CVarDeferredAggregation.GetValueOnGameThread() == 0 || !World->IsGameWorld() || World->GetNetMode() == NM_Client)
+		{
+			return;
+		}
+
+		FWorldBatch& WorldBatch = WorldBatches.FindOrAdd(World);
+		if (!WorldBatch.bFrameBatchOpen)
+		{
+			UACM_AttributeSet::BeginAggregationBatch();
+			WorldBatch.bFrameBatchOpen = true;
+		}
+
+	}
+
+	static void HandleWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+	{
+
+		FWorldBatch* WorldBatch = WorldBatches.Find(World);
+		if (WorldBatch != nullptr && WorldBatch->bFrameBatchOpen)
+		{
+			WorldBatch->bFrameBatchOpen = false;
+			UACM_AttributeSet::EndAggregationBatch(World);
+		}
+
+	}
+
+	static void HandleWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+	{
+
+		HandleWorldPostActorTick(World, LEVELTICK_All, 0.0f);
+		WorldBatches.Remove(World);
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::RegisterDeferredAggregation()
+{
+
+	using namespace ACM_DeferredAggregation;
+
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddStatic(&HandleWorldTickStart);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddStatic(&HandleWorldPostActorTick);
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddStatic(&HandleWorldCleanup);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::UnregisterDeferredAggregation()
+{
+
+	using namespace ACM_DeferredAggregation;
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+
+	TArray<TWeakObjectPtr<const UWorld>> Worlds;
+	WorldBatches.GetKeys(Worlds);
+
+	for (const TWeakObjectPtr<const UWorld>& World : Worlds)
+	{
+		FWorldBatch* WorldBatch = WorldBatches.Find(World);
+		if (WorldBatch != nullptr && WorldBatch->bFrameBatchOpen)
+		{
+			WorldBatch->bFrameBatchOpen = false;
+			EndAggregationBatch(World.Get());
+		}
+	}
+
+	WorldBatches.Reset();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::BeginAggregationBatch()
+{
+
+	FScopedAggregatorOnDirtyBatch::BeginLock();
+	ACM_DeferredAggregation::NumOwnedLocks++;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::EndAggregationBatch(const UWorld* World)
+{
+
+	using namespace ACM_DeferredAggregation;
+
+	NumOwnedLocks = FMath::Max(NumOwnedLocks - 1, 0);
+
+	// Network receive ends every outstanding lock on its own, nothing left to flush in that case
+	if (FScopedAggregatorOnDirtyBatch::GlobalBatchCount <= 0)
+	{
+		return;
+	}
+
+	if (FScopedAggregatorOnDirtyBatch::GlobalBatchCount > 1 || World == nullptr)
+	{
+		FScopedAggregatorOnDirtyBatch::EndLock();
+		return;
+	}
+
+	WorldBatches.FindOrAdd(World).bFlushing = true;
+	FScopedAggregatorOnDirtyBatch::EndLock();
+
+	// Evaluation runs gameplay callbacks, the map may have grown in the meantime
+	FWorldBatch& WorldBatch = WorldBatches.FindOrAdd(World);
+	WorldBatch.bFlushing = false;
+
+	TArray<TWeakObjectPtr<UACM_AttributeSet>> PendingSets = MoveTemp(WorldBatch.SetsWithPendingMaxChanges);
+	for (const TWeakObjectPtr<UACM_AttributeSet>& PendingSet : PendingSets)
+	{
+		if (PendingSet.IsValid())
+		{
+			PendingSet->ApplyPendingMaxChanges();
+		}
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::FlushDeferredAggregation(const UObject* WorldContextObject)
+{
+
+	using namespace ACM_DeferredAggregation;
+
+	const UWorld* World = IsValid(WorldContextObject) ? WorldContextObject->GetWorld() : nullptr;
+	const FWorldBatch* WorldBatch = WorldBatches.Find(World);
+
+	// Only a lone lock of ours can be evaluated early, inside a nested or net receive lock the values stay pending
+	if (FScopedAggregatorOnDirtyBatch::GlobalBatchCount == 1 && NumOwnedLocks == 1 && (WorldBatch == nullptr || !WorldBatch->bFlushing))
+	{
+		EndAggregationBatch(World);
+		BeginAggregationBatch();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::FlushBeforeRead(const FGameplayAttribute& Attribute) const
+{
+
+	// Only our own locks leave values pending on purpose, and nothing is pending without dirty aggregators
+	if (ACM_DeferredAggregation::NumOwnedLocks == 0 || FScopedAggregatorOnDirtyBatch::DirtyAggregators.Num() == 0)
+	{
+		return;
+	}
+
+	const UACM_AbilitySystemComponent* AbilityComponent = Cast<UACM_AbilitySystemComponent>(GetOwningAbilitySystemComponent());
+	if (!IsValid(AbilityComponent))
+	{
+		return;
+	}
+
+	FGameplayAttribute MaxAttribute;
+	FGameplayAttribute RegenAttribute;
+	const bool bIsResource = GetResourceAttributes(Attribute, MaxAttribute, RegenAttribute);
+
+	if (AbilityComponent->IsAttributeAggregationPending(Attribute) || (bIsResource && AbilityComponent->IsAttributeAggregationPending(MaxAttribute)))
+	{
+		FlushDeferredAggregation(this);
+	}
+
+}
+
+namespace ACM_DeferredAggregation
+{
+
+	struct FOrderingResult
+	{
+		float Health = 0.0f;
+		float HealthBase = 0.0f;
+		float MaxHealth = 0.0f;
+	};
+
+	static UGameplayEffect* MakeCheckEffect(const TCHAR* Name, EGameplayEffectDurationType DurationPolicy, const FGameplayAttribute& Attribute, float Magnitude)
+	{
+
+		UGameplayEffect* Effect = NewObject<UGameplayEffect>(GetTransientPackage(), MakeUniqueObjectName(GetTransientPackage(), UGameplayEffect::StaticClass(), Name));
+		Effect->DurationPolicy = DurationPolicy;
+
+		FGameplayModifierInfo& Modifier = Effect->Modifiers.AddDefaulted_GetRef();
+		Modifier.Attribute = Attribute;
+		Modifier.ModifierOp = EGameplayModOp::Additive;
+		Modifier.ModifierMagnitude = FGameplayEffectModifierMagnitude(FScalableFloat(Magnitude));
+
+		return Effect;
+
+	}
+
+	/** Applies Effects in order to a fresh set at 60/100 Health, inside one aggregation batch when bDeferred */
+	static FOrderingResult RunOrderingCase(UWorld* World, const TArray<UGameplayEffect*>& Effects, bool bDeferred)
+	{
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+
+		AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+
+		UACM_AbilitySystemComponent* AbilityComponent = NewObject<UACM_AbilitySystemComponent>(Actor);
+		AbilityComponent->RegisterComponent();
+
+		UACM_AttributeSet* AttributeSet = NewObject<UACM_AttributeSet>(Actor);
+		AbilityComponent->AddAttributeSetSubobject(AttributeSet);
+		AbilityComponent->InitAbilityActorInfo(Actor, Actor);
+		AttributeSet->InitHealth(60.0f);
+
+		if (bDeferred)
+		{
+			UACM_AttributeSet::BeginAggregationBatch();
+		}
+
+		for (const UGameplayEffect* Effect : Effects)
+		{
+			AbilityComponent->ApplyGameplayEffectToSelf(Effect, 1.0f, AbilityComponent->MakeEffectContext());
+		}
+
+		if (bDeferred)
+		{
+			UACM_AttributeSet::EndAggregationBatch(World);
+		}
+
+		FOrderingResult Result;
+		Result.Health = AttributeSet->GetHealth();
+		Result.HealthBase = AttributeSet->Health.GetBaseValue();
+		Result.MaxHealth = AttributeSet->GetMaxHealth();
+
+		Actor->Destroy();
+		return Result;
+
+	}
+
+	static void VerifyDeferredOrdering(const TArray<FString>& Args, UWorld* World)
+	{
+
+		if (!IsValid(World) || World->GetNetMode() == NM_Client)
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Attributes.VerifyDeferredOrdering needs an authoritative world"));
+			return;
+		}
+
+		if (FScopedAggregatorOnDirtyBatch::GlobalBatchCount > 0)
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Attributes.VerifyDeferredOrdering cannot run inside an open aggregation batch"));
+			return;
+		}
+
+		UGameplayEffect* MaxBuff = MakeCheckEffect(TEXT("ACM_Check_MaxBuff"), EGameplayEffectDurationType::Infinite, UACM_AttributeSet::GetMaxHealthAttribute(), 100.0f);
+		UGameplayEffect* HealthBuff = MakeCheckEffect(TEXT("ACM_Check_HealthBuff"), EGameplayEffectDurationType::Infinite, UACM_AttributeSet::GetHealthAttribute(), 30.0f);
+		UGameplayEffect* Damage = MakeCheckEffect(TEXT("ACM_Check_Damage"), EGameplayEffectDurationType::Instant, UACM_AttributeSet::GetHealthAttribute(), -50.0f);
+		UGameplayEffect* Overheal = MakeCheckEffect(TEXT("ACM_Check_Overheal"), EGameplayEffectDurationType::Instant, UACM_AttributeSet::GetHealthAttribute(), 500.0f);
+		UGameplayEffect* Overkill = MakeCheckEffect(TEXT("ACM_Check_Overkill"), EGameplayEffectDurationType::Instant, UACM_AttributeSet::GetHealthAttribute(), -1000.0f);
+
+		struct FOrderingCase
+		{
+			const TCHAR* Name;
+			TArray<UGameplayEffect*> Effects;
+		};
+
+		const FOrderingCase Cases[] =
+		{
+			{ TEXT("Max then damage"), { MaxBuff, Damage } },
+			{ TEXT("Damage then Max"), { Damage, MaxBuff } },
+			{ TEXT("Max then overheal"), { MaxBuff, Overheal } },
+			{ TEXT("Buff then overkill"), { HealthBuff, Overkill } },
+			{ TEXT("Max, damage, buff, damage"), { MaxBuff, Damage, HealthBuff, Damage } }
+		};
+
+		int32 NumMismatches = 0;
+
+		// Without a batch every change is evaluated on the spot, which is the order the batch has to reproduce
+		for (const FOrderingCase& Case : Cases)
+		{
+
+			const FOrderingResult Immediate = RunOrderingCase(World, Case.Effects, false);
+			const FOrderingResult Deferred = RunOrderingCase(World, Case.Effects, true);
+
+			const bool bMatches = FMath::IsNearlyEqual(Immediate.Health, Deferred.Health)
+				&& FMath::IsNearlyEqual(Immediate.HealthBase, Deferred.HealthBase)
+				&& FMath::IsNearlyEqual(Immediate.MaxHealth, Deferred.MaxHealth);
+
+			if (!bMatches)
+			{
+				NumMismatches++;
+				UE_LOG(LogArkdeCM, Warning, TEXT("  %s: immediate %.2f (base %.2f) / %.2f, deferred %.2f (base %.2f) / %.2f"), Case.Name,
+					Immediate.Health, Immediate.HealthBase, Immediate.MaxHealth, Deferred.Health, Deferred.HealthBase, Deferred.MaxHealth);
+			}
+
+		}
+
+		UE_LOG(LogArkdeCM, Display, TEXT("Deferred aggregation ordering: %d cases, %d mismatches"), static_cast<int32>(UE_ARRAY_COUNT(Cases)), NumMismatches);
+
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs CVarVerifyDeferredOrdering(
+		TEXT("ACM.Attributes.VerifyDeferredOrdering"),
+		TEXT("Applies Max and resource effects in several orders to scratch actors, with and without an aggregation batch, and reports results that differ"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&VerifyDeferredOrdering));
+
+}
 
 //=========================================================================================================================================================
 UACM_AttributeSet::UACM_AttributeSet()
@@ -22,6 +373,103 @@ UACM_AttributeSet::UACM_AttributeSet()
 	Stamina = MaxStamina;
 	StaminaRegen = 1.0f;
 
+	bFixedPoint = false;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::PostInitProperties()
+{
+
+	Super::PostInitProperties();
+
+	// Clients start from their own setting and take the server's value with the first replication of the set
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		bFixedPoint = ACM_FixedPoint::IsEnabled();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::InitFromSpec(const FACM_AttributeInitSpec& Spec)
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = GetAllAttributes();
+
+	for (int32 AttributeIndex = 0; AttributeIndex < AllAttributes.Num() && AttributeIndex < Spec.Values.Num(); AttributeIndex++)
+	{
+
+		if ((Spec.Mask & (1u << AttributeIndex)) == 0)
+		{
+			continue;
+		}
+
+		const float Value = QuantizeValue(Spec.Values[AttributeIndex]);
+
+		FGameplayAttributeData* AttributeData = AllAttributes[AttributeIndex].GetGameplayAttributeData(this);
+		AttributeData->SetBaseValue(Value);
+		AttributeData->SetCurrentValue(Value);
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::ApplyTuningDefaults()
+{
+
+	const FACM_AttributeTuning Tuning = FACM_TuningTable::FindOwner<FACM_AttributeTuning>(ACM_ContentId::FromClass(GetClass()));
+	if (Tuning.IsEmpty())
+	{
+		return;
+	}
+
+	for (const FGameplayAttribute& Attribute : GetAllAttributes())
+	{
+
+		float DefaultValue = 0.0f;
+		if (Tuning.TryGetDefault(Attribute, DefaultValue))
+		{
+			DefaultValue = QuantizeValue(DefaultValue);
+
+			FGameplayAttributeData* AttributeData = Attribute.GetGameplayAttributeData(this);
+			AttributeData->SetBaseValue(DefaultValue);
+			AttributeData->SetCurrentValue(DefaultValue);
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::WriteAttributeValue(const FGameplayAttribute& Attribute, float BaseValue, float CurrentValue)
+{
+
+	FGameplayAttributeData* AttributeData = Attribute.GetGameplayAttributeData(this);
+	if (AttributeData == nullptr)
+	{
+		return;
+	}
+
+	const float OldValue = AttributeData->GetCurrentValue();
+
+	AttributeData->SetBaseValue(QuantizeValue(BaseValue));
+	AttributeData->SetCurrentValue(QuantizeValue(CurrentValue));
+
+	UAbilitySystemComponent* AbilityComponent = GetOwningAbilitySystemComponent();
+	if (AttributeData->GetCurrentValue() == OldValue || !IsValid(AbilityComponent))
+	{
+		return;
+	}
+
+	FOnAttributeChangeData ChangeData;
+	ChangeData.Attribute = Attribute;
+	ChangeData.NewValue = AttributeData->GetCurrentValue();
+	ChangeData.OldValue = OldValue;
+
+	AbilityComponent->GetGameplayAttributeValueChangeDelegate(Attribute).Broadcast(ChangeData);
+
 }
 
 //=========================================================================================================================================================
@@ -30,6 +478,8 @@ void UACM_AttributeSet::PreAttributeChange(const FGameplayAttribute & Attribute,
 
 	Super::PreAttributeChange(Attribute, NewValue);
 
+	NewValue = QuantizeValue(NewValue);
+
 	if (Attribute == GetMaxHealthAttribute())
 	{
 		AdjustAttributeForMaxChange(Health, MaxHealth, NewValue, GetHealthAttribute());
@@ -45,6 +495,75 @@ void UACM_AttributeSet::PreAttributeChange(const FGameplayAttribute & Attribute,
 
 }
 
+//=========================================================================================================================================================
+void UACM_AttributeSet::PreAttributeBaseChange(const FGameplayAttribute& Attribute, float& NewValue) const
+{
+
+	Super::PreAttributeBaseChange(Attribute, NewValue);
+
+	// Base values feed every later aggregation, off-grid bases would bring order dependence back in
+	NewValue = QuantizeValue(NewValue);
+
+}
+
+//=========================================================================================================================================================
+float UACM_AttributeSet::QuantizeValue(float Value) const
+{
+	return bFixedPoint ? ACM_FixedPoint::Quantize(Value) : Value;
+}
+
+//=========================================================================================================================================================
+float UACM_AttributeSet::ClampResource(float Value, float MaxValue) const
+{
+	return FMath::Clamp(QuantizeValue(Value), 0.0f, MaxValue);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::ClampResourceAttribute(const FGameplayAttribute& Attribute, FGameplayAttributeData& Resource, const FGameplayAttributeData& MaxAttribute)
+{
+
+	const float MaxValue = MaxAttribute.GetCurrentValue();
+	const float ClampedBase = ClampResource(Resource.GetBaseValue(), MaxValue);
+
+	// Through the ASC, so an aggregator evaluates from the clamped base too, right away or when a deferred batch ends
+	UAbilitySystemComponent* AbilityComponent = GetOwningAbilitySystemComponent();
+	if (ClampedBase != Resource.GetBaseValue() && IsValid(AbilityComponent))
+	{
+		AbilityComponent->SetNumericAttributeBase(Attribute, ClampedBase);
+	}
+
+	Resource.SetBaseValue(ClampedBase);
+	Resource.SetCurrentValue(ClampResource(Resource.GetCurrentValue(), MaxValue));
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AttributeSet::PreGameplayEffectExecute(FGameplayEffectModCallbackData& Data)
+{
+
+	if (!Super::PreGameplayEffectExecute(Data))
+	{
+		return false;
+	}
+
+	// A Max change still pending in a deferred batch happened before this execute. Evaluate it now, so it rescales the
+	// resource first and PostGameplayEffectExecute clamps against the new Max, the same order as without batching
+	FGameplayAttribute MaxAttribute;
+	FGameplayAttribute RegenAttribute;
+	if (FScopedAggregatorOnDirtyBatch::GlobalBatchCount > 0 && GetResourceAttributes(Data.EvaluatedData.Attribute, MaxAttribute, RegenAttribute))
+	{
+		UACM_AbilitySystemComponent* AbilityComponent = Cast<UACM_AbilitySystemComponent>(&Data.Target);
+		if (IsValid(AbilityComponent) && AbilityComponent->IsAttributeAggregationPending(MaxAttribute))
+		{
+			FlushDeferredAggregation(this);
+		}
+	}
+
+	return true;
+
+}
+
 //=========================================================================================================================================================
 void UACM_AttributeSet::PostGameplayEffectExecute(const FGameplayEffectModCallbackData & Data)
 {
@@ -52,24 +571,35 @@ void UACM_AttributeSet::PostGameplayEffectExecute(const FGameplayEffectModCallba
 	if(Data.EvaluatedData.Attribute.GetUProperty() == FindFieldChecked<FProperty>(UACM_AttributeSet::StaticClass(), GET_MEMBER_NAME_CHECKED(UACM_AttributeSet, Health)) )
 	{
 	
-		Health.SetCurrentValue(FMath::Clamp(Health.GetCurrentValue(), 0.0f, MaxHealth.GetCurrentValue()));
-		Health.SetBaseValue(FMath::Clamp(Health.GetBaseValue(), 0.0f, MaxHealth.GetCurrentValue()));
+		ClampResourceAttribute(GetHealthAttribute(), Health, MaxHealth);
 		UE_LOG(LogTemp, Warning, TEXT("Health Changed: %f"), Health.GetCurrentValue());
 
+		AActor* OwningActor = GetOwningActor();
+		UACM_DamageHistoryComponent* DamageHistory = IsValid(OwningActor) && OwningActor->HasAuthority() ? OwningActor->FindComponentByClass<UACM_DamageHistoryComponent>() : nullptr;
+		if (IsValid(DamageHistory))
+		{
+
+			DamageHistory->RecordHealthChange(Data, Health.GetCurrentValue());
+
+			if (Health.GetCurrentValue() <= 0.0f)
+			{
+				DamageHistory->HandleDeath();
+			}
+
+		}
+
 	}
 	else if (Data.EvaluatedData.Attribute.GetUProperty() == FindFieldChecked<FProperty>(UACM_AttributeSet::StaticClass(), GET_MEMBER_NAME_CHECKED(UACM_AttributeSet, Mana)))
 	{
 
-		Mana.SetCurrentValue(FMath::Clamp(Mana.GetCurrentValue(), 0.0f, MaxMana.GetCurrentValue()));
-		Mana.SetBaseValue(FMath::Clamp(Mana.GetBaseValue(), 0.0f, MaxMana.GetCurrentValue()));
+		ClampResourceAttribute(GetManaAttribute(), Mana, MaxMana);
 		UE_LOG(LogTemp, Warning, TEXT("Mana Changed: %f"), Mana.GetCurrentValue());
 
 	}
 	else if (Data.EvaluatedData.Attribute.GetUProperty() == FindFieldChecked<FProperty>(UACM_AttributeSet::StaticClass(), GET_MEMBER_NAME_CHECKED(UACM_AttributeSet, Stamina)))
 	{
 
-		Stamina.SetCurrentValue(FMath::Clamp(Stamina.GetCurrentValue(), 0.0f, MaxStamina.GetCurrentValue()));
-		Stamina.SetBaseValue(FMath::Clamp(Stamina.GetBaseValue(), 0.0f, MaxStamina.GetCurrentValue()));
+		ClampResourceAttribute(GetStaminaAttribute(), Stamina, MaxStamina);
 
 	}
 
@@ -79,14 +609,50 @@ void UACM_AttributeSet::PostGameplayEffectExecute(const FGameplayEffectModCallba
 void UACM_AttributeSet::AdjustAttributeForMaxChange(FGameplayAttributeData & AffectedAttribute, const FGameplayAttributeData & MaxAttribute, float NewMaxValue, const FGameplayAttribute & AffectedAttributeProperty)
 {
 
-	UAbilitySystemComponent* AbilityComponent = GetOwningAbilitySystemComponent();
 	const float CurrentMaxValue = MaxAttribute.GetCurrentValue();
+	if (bMaxAdjustSuppressed || FMath::IsNearlyEqual(CurrentMaxValue, NewMaxValue))
+	{
+		return;
+	}
+
+	// The affected attribute may still be waiting in the same batch, rescale once every value of the batch is final
+	ACM_DeferredAggregation::FWorldBatch* WorldBatch = ACM_DeferredAggregation::WorldBatches.Find(GetWorld());
+	if (WorldBatch != nullptr && WorldBatch->bFlushing)
+	{
+
+		FPendingMaxChange* PendingChange = PendingMaxChanges.Find(AffectedAttributeProperty);
+		if (PendingChange == nullptr)
+		{
+			PendingChange = &PendingMaxChanges.Add(AffectedAttributeProperty, FPendingMaxChange{ CurrentMaxValue, NewMaxValue });
+			WorldBatch->SetsWithPendingMaxChanges.AddUnique(this);
+		}
+
+		PendingChange->NewMaxValue = NewMaxValue;
+		return;
+
+	}
+
+	RescaleAttributeForMaxChange(AffectedAttributeProperty, CurrentMaxValue, NewMaxValue);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::RescaleAttributeForMaxChange(const FGameplayAttribute & AffectedAttributeProperty, float OldMaxValue, float NewMaxValue)
+{
 
-	if (!FMath::IsNearlyEqual(CurrentMaxValue, NewMaxValue) && IsValid(AbilityComponent))
+	UAbilitySystemComponent* AbilityComponent = GetOwningAbilitySystemComponent();
+
+	if (!FMath::IsNearlyEqual(OldMaxValue, NewMaxValue) && IsValid(AbilityComponent))
 	{
 		
-		const float CurrentValue = AffectedAttribute.GetCurrentValue();
-		float NewDelta = CurrentMaxValue > 0.0f ? (CurrentValue * NewMaxValue / CurrentMaxValue) - CurrentValue : NewMaxValue;
+		const float CurrentValue = AffectedAttributeProperty.GetNumericValue(this);
+		float NewDelta = OldMaxValue > 0.0f ? (CurrentValue * NewMaxValue / OldMaxValue) - CurrentValue : NewMaxValue;
+
+		// Both values are on the grid, so the delta and the resulting value are exact
+		if (bFixedPoint)
+		{
+			NewDelta = ACM_FixedPoint::Rescale(CurrentValue, OldMaxValue, NewMaxValue) - CurrentValue;
+		}
 
 		AbilityComponent->ApplyModToAttributeUnsafe(AffectedAttributeProperty, EGameplayModOp::Additive, NewDelta);
 
@@ -94,20 +660,321 @@ void UACM_AttributeSet::AdjustAttributeForMaxChange(FGameplayAttributeData & Aff
 
 }
 
+//=========================================================================================================================================================
+void UACM_AttributeSet::ApplyPendingMaxChanges()
+{
+
+	TMap<FGameplayAttribute, FPendingMaxChange> ChangesToApply = MoveTemp(PendingMaxChanges);
+	if (bMaxAdjustSuppressed)
+	{
+		return;
+	}
+
+	for (const TPair<FGameplayAttribute, FPendingMaxChange>& ChangePair : ChangesToApply)
+	{
+		RescaleAttributeForMaxChange(ChangePair.Key, ChangePair.Value.OldMaxValue, ChangePair.Value.NewMaxValue);
+	}
+
+}
+
+//=========================================================================================================================================================
+const TArray<FGameplayAttribute>& UACM_AttributeSet::GetAllAttributes()
+{
+
+	static TArray<FGameplayAttribute> AllAttributes;
+
+	if (AllAttributes.Num() == 0)
+	{
+		for (TFieldIterator<FProperty> PropertyIterator(UACM_AttributeSet::StaticClass()); PropertyIterator; ++PropertyIterator)
+		{
+			if (FGameplayAttribute::IsGameplayAttributeDataProperty(*PropertyIterator))
+			{
+				AllAttributes.Emplace(*PropertyIterator);
+			}
+		}
+	}
+
+	return AllAttributes;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::CaptureAttributeValues(TArray<float>& OutValues) const
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = GetAllAttributes();
+
+	OutValues.Reset(AllAttributes.Num());
+	for (const FGameplayAttribute& Attribute : AllAttributes)
+	{
+		OutValues.Add(Attribute.GetNumericValue(this));
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::BroadcastBatchChanges(const TArray<float>& OldValues)
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = GetAllAttributes();
+	if (!ensure(OldValues.Num() == AllAttributes.Num()))
+	{
+		return;
+	}
+
+	for (int32 AttributeIndex = 0; AttributeIndex < AllAttributes.Num(); AttributeIndex++)
+	{
+
+		const float NewValue = AllAttributes[AttributeIndex].GetNumericValue(this);
+		if (NewValue != OldValues[AttributeIndex])
+		{
+			OnBatchAttributeChanged.Broadcast(AllAttributes[AttributeIndex], OldValues[AttributeIndex], NewValue);
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_AttributeSet::AddRangeWatch(const FGameplayAttribute& Attribute, float MinValue, float MaxValue, FOnRangeEntered OnEntered, FSimpleDelegate OnRegenChanged)
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = GetAllAttributes();
+
+	const int32 AttributeIndex = AllAttributes.IndexOfByKey(Attribute);
+	if (AttributeIndex == INDEX_NONE)
+	{
+		return 0;
+	}
+
+	FGameplayAttribute MaxAttribute;
+	FGameplayAttribute RegenAttribute;
+	GetResourceAttributes(Attribute, MaxAttribute, RegenAttribute);
+
+	const float Value = Attribute.GetNumericValue(this);
+
+	FRangeWatch& Watch = RangeWatches.AddDefaulted_GetRef();
+	Watch.Id = NextRangeWatchId++;
+	Watch.AttributeIndex = AttributeIndex;
+	Watch.RegenIndex = RegenAttribute.IsValid() ? AllAttributes.IndexOfByKey(RegenAttribute) : INDEX_NONE;
+	Watch.MinValue = MinValue;
+	Watch.MaxValue = MaxValue;
+	Watch.bInside = Value >= MinValue && Value <= MaxValue;
+	Watch.OnEntered = MoveTemp(OnEntered);
+	Watch.OnRegenChanged = MoveTemp(OnRegenChanged);
+
+	const int32 WatchId = Watch.Id;
+	UpdateWatchBindings();
+
+	return WatchId;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::RemoveRangeWatch(int32 WatchId)
+{
+
+	const int32 WatchIndex = RangeWatches.IndexOfByPredicate([WatchId](const FRangeWatch& Watch) { return Watch.Id == WatchId; });
+	if (WatchIndex != INDEX_NONE)
+	{
+		RangeWatches.RemoveAtSwap(WatchIndex);
+		UpdateWatchBindings();
+	}
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AttributeSet::IsRangeWatchInside(int32 WatchId) const
+{
+
+	const FRangeWatch* Watch = RangeWatches.FindByPredicate([WatchId](const FRangeWatch& Candidate) { return Candidate.Id == WatchId; });
+	return Watch != nullptr && Watch->bInside;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AttributeSet::HasRangeWatchBoundTo(const UObject* Object) const
+{
+
+	return RangeWatches.ContainsByPredicate([Object](const FRangeWatch& Watch)
+	{
+		return Watch.OnEntered.IsBoundToObject(Object) || Watch.OnRegenChanged.IsBoundToObject(Object);
+	});
+
+}
+
+//=========================================================================================================================================================
+float UACM_AttributeSet::ForecastSecondsToReach(const FGameplayAttribute& Attribute, float TargetValue) const
+{
+
+	FGameplayAttribute MaxAttribute;
+	FGameplayAttribute RegenAttribute;
+	if (!GetResourceAttributes(Attribute, MaxAttribute, RegenAttribute))
+	{
+		return -1.0f;
+	}
+
+	const float Value = Attribute.GetNumericValue(this);
+	if (Value >= TargetValue)
+	{
+		return 0.0f;
+	}
+
+	const float RegenRate = RegenAttribute.GetNumericValue(this);
+	if (RegenRate <= 0.0f || TargetValue > MaxAttribute.GetNumericValue(this))
+	{
+		return -1.0f;
+	}
+
+	return (TargetValue - Value) / RegenRate;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AttributeSet::GetResourceAttributes(const FGameplayAttribute& Attribute, FGameplayAttribute& OutMaxAttribute, FGameplayAttribute& OutRegenAttribute)
+{
+
+	if (Attribute == GetHealthAttribute())
+	{
+		OutMaxAttribute = GetMaxHealthAttribute();
+		OutRegenAttribute = GetHealthRegenAttribute();
+	}
+	else if (Attribute == GetManaAttribute())
+	{
+		OutMaxAttribute = GetMaxManaAttribute();
+		OutRegenAttribute = GetManaRegenAttribute();
+	}
+	else if (Attribute == GetStaminaAttribute())
+	{
+		OutMaxAttribute = GetMaxStaminaAttribute();
+		OutRegenAttribute = GetStaminaRegenAttribute();
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::HandleWatchedAttributeChanged(const FOnAttributeChangeData& ChangeData)
+{
+
+	// REPNOTIFY_Always replays unchanged values on clients, those can not enter or leave a range
+	if (ChangeData.NewValue == ChangeData.OldValue)
+	{
+		return;
+	}
+
+	const int32 AttributeIndex = GetAllAttributes().IndexOfByKey(ChangeData.Attribute);
+
+	// Callbacks may add or remove watches, they run after the pass over the watches
+	TArray<FOnRangeEntered, TInlineAllocator<4>> EnteredCallbacks;
+	TArray<FSimpleDelegate, TInlineAllocator<4>> RegenCallbacks;
+
+	for (FRangeWatch& Watch : RangeWatches)
+	{
+
+		if (Watch.AttributeIndex == AttributeIndex)
+		{
+
+			const bool bInside = ChangeData.NewValue >= Watch.MinValue && ChangeData.NewValue <= Watch.MaxValue;
+			if (bInside && !Watch.bInside)
+			{
+				EnteredCallbacks.Add(Watch.OnEntered);
+			}
+
+			Watch.bInside = bInside;
+
+		}
+		else if (Watch.RegenIndex == AttributeIndex && Watch.OnRegenChanged.IsBound())
+		{
+			RegenCallbacks.Add(Watch.OnRegenChanged);
+		}
+
+	}
+
+	for (const FOnRangeEntered& OnEntered : EnteredCallbacks)
+	{
+		OnEntered.ExecuteIfBound(ChangeData.NewValue);
+	}
+
+	for (const FSimpleDelegate& OnRegenChanged : RegenCallbacks)
+	{
+		OnRegenChanged.ExecuteIfBound();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AttributeSet::UpdateWatchBindings()
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = GetAllAttributes();
+
+	uint32 NeededMask = 0;
+	for (const FRangeWatch& Watch : RangeWatches)
+	{
+
+		NeededMask |= 1u << Watch.AttributeIndex;
+
+		if (Watch.RegenIndex != INDEX_NONE && Watch.OnRegenChanged.IsBound())
+		{
+			NeededMask |= 1u << Watch.RegenIndex;
+		}
+
+	}
+
+	UAbilitySystemComponent* AbilitySystemComponent = GetOwningAbilitySystemComponent();
+	if (AbilitySystemComponent == nullptr)
+	{
+		return;
+	}
+
+	WatchDelegateHandles.SetNum(AllAttributes.Num());
+
+	for (int32 AttributeIndex = 0; AttributeIndex < AllAttributes.Num(); AttributeIndex++)
+	{
+
+		FDelegateHandle& DelegateHandle = WatchDelegateHandles[AttributeIndex];
+		const bool bNeeded = (NeededMask & (1u << AttributeIndex)) != 0;
+
+		if (bNeeded && !DelegateHandle.IsValid())
+		{
+			DelegateHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(AllAttributes[AttributeIndex]).AddUObject(this, &UACM_AttributeSet::HandleWatchedAttributeChanged);
+		}
+		else if (!bNeeded && DelegateHandle.IsValid())
+		{
+			AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(AllAttributes[AttributeIndex]).Remove(DelegateHandle);
+			DelegateHandle.Reset();
+		}
+
+	}
+
+}
+
 //=========================================================================================================================================================
 void UACM_AttributeSet::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, Health, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, MaxHealth, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, HealthRegen, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, Mana, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, MaxMana, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, ManaRegen, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, Stamina, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, MaxStamina, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, StaminaRegen, COND_None, REPNOTIFY_Always);
+	// Sent once, the set keeps the mode the server created it with
+	DOREPLIFETIME_CONDITION(UACM_AttributeSet, bFixedPoint, COND_InitialOnly);
+
+	// With the compact GAS stream on, replays record the attributes themselves at reduced precision
+	const ELifetimeCondition Condition = UACM_GASReplaySubsystem::IsCompactStreamEnabled() ? COND_SkipReplay : COND_None;
+
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, Health, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, MaxHealth, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, HealthRegen, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, Mana, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, MaxMana, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, ManaRegen, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, Stamina, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, MaxStamina, Condition, REPNOTIFY_Always);
+	DOREPLIFETIME_CONDITION_NOTIFY(UACM_AttributeSet, StaminaRegen, Condition, REPNOTIFY_Always);
 
 }
 
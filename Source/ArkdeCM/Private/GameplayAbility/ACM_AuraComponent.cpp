@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_AuraComponent.h"
+#include "Engine/World.h"
+#include "GameplayAbility/ACM_AuraSubsystem.h"
+
+//=========================================================================================================================================================
+UACM_AuraComponent::UACM_AuraComponent()
+{
+
+	PrimaryComponentTick.bCanEverTick = false;
+
+	Radius = 400.0f;
+	EffectLevel = 1.0f;
+	bAffectsOwner = false;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraComponent::BeginPlay()
+{
+
+	Super::BeginPlay();
+
+	UACM_AuraSubsystem* AuraSubsystem = GetWorld()->GetSubsystem<UACM_AuraSubsystem>();
+	if (GetOwnerRole() == ENetRole::ROLE_Authority && IsValid(AuraSubsystem))
+	{
+		AuraSubsystem->RegisterAura(this);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	UACM_AuraSubsystem* AuraSubsystem = GetWorld()->GetSubsystem<UACM_AuraSubsystem>();
+	if (IsValid(AuraSubsystem))
+	{
+		AuraSubsystem->UnregisterAura(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+
+}
@@ -0,0 +1,589 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_AuraSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/SoftObjectPath.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_CYCLE_STAT(TEXT("Aura Processing"), STAT_ACM_ProcessAuras, STATGROUP_ArkdeCM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aura Enters"), STAT_ACM_AuraEnters, STATGROUP_ArkdeCM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aura Exits"), STAT_ACM_AuraExits, STATGROUP_ArkdeCM);
+
+//=========================================================================================================================================================
+UACM_AuraSubsystem::UACM_AuraSubsystem()
+{
+	CellSize = 1000.0f;
+	EffectChangeDepth = 0;
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::Deinitialize()
+{
+
+	Auras.Reset();
+	PendingAuraRemovals.Reset();
+	PendingTargetRemovals.Reset();
+	Targets.Reset();
+	FreeTargetIndices.Reset();
+	Cells.Reset();
+
+	Super::Deinitialize();
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_AuraSubsystem::RegisterTarget(UAbilitySystemComponent* AbilitySystemComponent, AActor* Avatar)
+{
+
+	if (!IsValid(AbilitySystemComponent) || !IsValid(Avatar))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 TargetIndex = FreeTargetIndices.Num() > 0 ? FreeTargetIndices.Pop(false) : Targets.AddDefaulted();
+
+	FTarget& Target = Targets[TargetIndex];
+	Target.AbilitySystemComponent = AbilitySystemComponent;
+	Target.Avatar = Avatar;
+	Target.Location = Avatar->GetActorLocation();
+	Target.Cell = GetCell(Target.Location);
+	Target.bActive = true;
+
+	AddToCell(TargetIndex, Target.Cell);
+
+	return TargetIndex;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::UnregisterTarget(UAbilitySystemComponent* AbilitySystemComponent)
+{
+
+	if (EffectChangeDepth > 0)
+	{
+		PendingTargetRemovals.AddUnique(AbilitySystemComponent);
+		return;
+	}
+
+	for (int32 TargetIndex = 0; TargetIndex < Targets.Num(); TargetIndex++)
+	{
+		if (Targets[TargetIndex].bActive && Targets[TargetIndex].AbilitySystemComponent == AbilitySystemComponent)
+		{
+			RemoveTarget(TargetIndex);
+			return;
+		}
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::RegisterAura(UACM_AuraComponent* Aura)
+{
+
+	if (!IsValid(Aura) || Auras.Contains(Aura))
+	{
+		return;
+	}
+
+	AActor* AuraOwner = Aura->GetOwner();
+
+	if (IsValid(Aura->EffectClass))
+	{
+
+		UAbilitySystemComponent* SourceComponent = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(AuraOwner);
+
+		if (IsValid(SourceComponent))
+		{
+			Aura->EffectSpec = SourceComponent->MakeOutgoingSpec(Aura->EffectClass, Aura->EffectLevel, SourceComponent->MakeEffectContext());
+		}
+		else
+		{
+			// Environmental auras have no ASC of their own, the actor is still recorded as the instigator
+			FGameplayEffectContextHandle EffectContext(UAbilitySystemGlobals::Get().AllocGameplayEffectContext());
+			EffectContext.AddInstigator(AuraOwner, AuraOwner);
+			Aura->EffectSpec = FGameplayEffectSpecHandle(new FGameplayEffectSpec(Aura->EffectClass->GetDefaultObject<UGameplayEffect>(), EffectContext, Aura->EffectLevel));
+		}
+
+	}
+
+	Aura->Inside.Reset();
+	Auras.Add(Aura);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::UnregisterAura(UACM_AuraComponent* Aura)
+{
+
+	if (!IsValid(Aura))
+	{
+		return;
+	}
+
+	if (EffectChangeDepth > 0)
+	{
+		PendingAuraRemovals.AddUnique(Aura);
+		return;
+	}
+
+	if (Auras.RemoveSwap(Aura) == 0)
+	{
+		return;
+	}
+
+	const TArray<UACM_AuraComponent::FInsideTarget> Inside = MoveTemp(Aura->Inside);
+	Aura->Inside.Reset();
+	Aura->EffectSpec.Clear();
+
+	BeginEffectChanges();
+
+	for (const UACM_AuraComponent::FInsideTarget& InsideTarget : Inside)
+	{
+		RemoveAuraEffect(InsideTarget.TargetIndex, InsideTarget.EffectHandle);
+	}
+
+	EndEffectChanges();
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AuraSubsystem::OwnsEffect(const UAbilitySystemComponent* AbilitySystemComponent, FActiveGameplayEffectHandle Handle) const
+{
+
+	for (const UACM_AuraComponent* Aura : Auras)
+	{
+
+		if (!IsValid(Aura))
+		{
+			continue;
+		}
+
+		for (const UACM_AuraComponent::FInsideTarget& InsideTarget : Aura->Inside)
+		{
+			if (InsideTarget.EffectHandle == Handle && Targets.IsValidIndex(InsideTarget.TargetIndex) && Targets[InsideTarget.TargetIndex].AbilitySystemComponent == AbilitySystemComponent)
+			{
+				return true;
+			}
+		}
+
+	}
+
+	return false;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::ProcessAuras()
+{
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_ProcessAuras);
+
+	BeginEffectChanges();
+
+	UpdateTargetCells();
+
+	// By index, auras registered by effect callbacks are appended to the array while it is walked
+	for (int32 AuraIndex = 0; AuraIndex < Auras.Num(); AuraIndex++)
+	{
+
+		UACM_AuraComponent* Aura = Auras[AuraIndex];
+		if (IsValid(Aura) && !PendingAuraRemovals.Contains(Aura))
+		{
+			ProcessAura(Aura);
+		}
+
+	}
+
+	EndEffectChanges();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::BeginEffectChanges()
+{
+	EffectChangeDepth++;
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::EndEffectChanges()
+{
+
+	if (--EffectChangeDepth > 0)
+	{
+		return;
+	}
+
+	// Each removal can queue more of them
+	while (PendingAuraRemovals.Num() > 0 || PendingTargetRemovals.Num() > 0)
+	{
+
+		if (PendingAuraRemovals.Num() > 0)
+		{
+			UnregisterAura(PendingAuraRemovals.Pop(false));
+		}
+		else
+		{
+			UnregisterTarget(const_cast<UAbilitySystemComponent*>(PendingTargetRemovals.Pop(false)));
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::Tick(float DeltaTime)
+{
+	ProcessAuras();
+}
+
+//=========================================================================================================================================================
+bool UACM_AuraSubsystem::IsTickable() const
+{
+
+	const UWorld* World = GetWorld();
+	return Auras.Num() > 0 && IsValid(World) && World->GetNetMode() != NM_Client;
+
+}
+
+//=========================================================================================================================================================
+TStatId UACM_AuraSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UACM_AuraSubsystem, STATGROUP_Tickables);
+}
+
+//=========================================================================================================================================================
+FIntPoint UACM_AuraSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::AddToCell(int32 TargetIndex, const FIntPoint& Cell)
+{
+	Cells.FindOrAdd(Cell).Add(TargetIndex);
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::RemoveFromCell(int32 TargetIndex, const FIntPoint& Cell)
+{
+
+	TArray<int32>* CellTargets = Cells.Find(Cell);
+	if (CellTargets == nullptr)
+	{
+		return;
+	}
+
+	CellTargets->RemoveSingleSwap(TargetIndex, false);
+
+	if (CellTargets->Num() == 0)
+	{
+		Cells.Remove(Cell);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::RemoveTarget(int32 TargetIndex)
+{
+
+	BeginEffectChanges();
+
+	for (int32 AuraIndex = 0; AuraIndex < Auras.Num(); AuraIndex++)
+	{
+
+		UACM_AuraComponent* Aura = Auras[AuraIndex];
+		if (!IsValid(Aura))
+		{
+			continue;
+		}
+
+		const int32 InsideIndex = Aura->Inside.IndexOfByPredicate([TargetIndex](const UACM_AuraComponent::FInsideTarget& InsideTarget)
+		{
+			return InsideTarget.TargetIndex == TargetIndex;
+		});
+
+		if (InsideIndex != INDEX_NONE)
+		{
+			const FActiveGameplayEffectHandle EffectHandle = Aura->Inside[InsideIndex].EffectHandle;
+			Aura->Inside.RemoveAt(InsideIndex, 1, false);
+			RemoveAuraEffect(TargetIndex, EffectHandle);
+		}
+
+	}
+
+	FTarget& Target = Targets[TargetIndex];
+	RemoveFromCell(TargetIndex, Target.Cell);
+
+	Target = FTarget();
+	FreeTargetIndices.Add(TargetIndex);
+
+	EndEffectChanges();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::UpdateTargetCells()
+{
+
+	for (int32 TargetIndex = 0; TargetIndex < Targets.Num(); TargetIndex++)
+	{
+
+		FTarget& Target = Targets[TargetIndex];
+		if (!Target.bActive)
+		{
+			continue;
+		}
+
+		const AActor* Avatar = Target.Avatar.Get();
+		if (!IsValid(Avatar) || !Target.AbilitySystemComponent.IsValid())
+		{
+			RemoveTarget(TargetIndex);
+			continue;
+		}
+
+		Target.Location = Avatar->GetActorLocation();
+
+		// Only crossing a cell boundary touches the grid
+		const FIntPoint NewCell = GetCell(Target.Location);
+		if (NewCell != Target.Cell)
+		{
+			RemoveFromCell(TargetIndex, Target.Cell);
+			AddToCell(TargetIndex, NewCell);
+			Target.Cell = NewCell;
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::ProcessAura(UACM_AuraComponent* Aura)
+{
+
+	const AActor* AuraOwner = Aura->GetOwner();
+	if (!IsValid(AuraOwner))
+	{
+		return;
+	}
+
+	const FVector Center = AuraOwner->GetActorLocation();
+	const float RadiusSquared = FMath::Square(Aura->Radius);
+	const FIntPoint MinCell = GetCell(Center - FVector(Aura->Radius));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Aura->Radius));
+
+	QueryResults.Reset();
+
+	for (int32 CellX = MinCell.X; CellX <= MaxCell.X; CellX++)
+	{
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; CellY++)
+		{
+
+			const TArray<int32>* CellTargets = Cells.Find(FIntPoint(CellX, CellY));
+			if (CellTargets == nullptr)
+			{
+				continue;
+			}
+
+			for (const int32 TargetIndex : *CellTargets)
+			{
+
+				const FTarget& Target = Targets[TargetIndex];
+				if (!Aura->bAffectsOwner && Target.Avatar.Get() == AuraOwner)
+				{
+					continue;
+				}
+
+				if (FVector::DistSquared(Target.Location, Center) <= RadiusSquared)
+				{
+					QueryResults.Add(TargetIndex);
+				}
+
+			}
+
+		}
+	}
+
+	QueryResults.Sort();
+
+	// Both lists are sorted by target index: anything only in the old list left, anything only in the new one entered
+	MergedInside.Reset();
+
+	int32 OldIndex = 0;
+	int32 NewIndex = 0;
+
+	while (OldIndex < Aura->Inside.Num() || NewIndex < QueryResults.Num())
+	{
+
+		const int32 OldTarget = OldIndex < Aura->Inside.Num() ? Aura->Inside[OldIndex].TargetIndex : MAX_int32;
+		const int32 NewTarget = NewIndex < QueryResults.Num() ? QueryResults[NewIndex] : MAX_int32;
+
+		if (OldTarget == NewTarget)
+		{
+			MergedInside.Add(Aura->Inside[OldIndex]);
+			OldIndex++;
+			NewIndex++;
+		}
+		else if (OldTarget < NewTarget)
+		{
+			RemoveAuraEffect(OldTarget, Aura->Inside[OldIndex].EffectHandle);
+			OldIndex++;
+		}
+		else
+		{
+			UACM_AuraComponent::FInsideTarget& EnteredTarget = MergedInside.AddDefaulted_GetRef();
+			EnteredTarget.TargetIndex = NewTarget;
+			ApplyAuraEffect(Aura, NewTarget, EnteredTarget.EffectHandle);
+			NewIndex++;
+		}
+
+	}
+
+	Swap(Aura->Inside, MergedInside);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::ApplyAuraEffect(UACM_AuraComponent* Aura, int32 TargetIndex, FActiveGameplayEffectHandle& OutHandle)
+{
+
+	INC_DWORD_STAT(STAT_ACM_AuraEnters);
+
+	UAbilitySystemComponent* TargetComponent = Targets[TargetIndex].AbilitySystemComponent.Get();
+	if (IsValid(TargetComponent) && Aura->EffectSpec.IsValid())
+	{
+		OutHandle = TargetComponent->ApplyGameplayEffectSpecToSelf(*Aura->EffectSpec.Data.Get());
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AuraSubsystem::RemoveAuraEffect(int32 TargetIndex, const FActiveGameplayEffectHandle& Handle)
+{
+
+	INC_DWORD_STAT(STAT_ACM_AuraExits);
+
+	UAbilitySystemComponent* TargetComponent = Targets[TargetIndex].AbilitySystemComponent.Get();
+	if (IsValid(TargetComponent) && Handle.IsValid())
+	{
+		TargetComponent->RemoveActiveGameplayEffect(Handle);
+	}
+
+}
+
+//=========================================================================================================================================================
+static void BenchmarkAuras(const TArray<FString>& Args, UWorld* World)
+{
+
+	AGameModeBase* GameMode = IsValid(World) ? World->GetAuthGameMode() : nullptr;
+	UACM_AuraSubsystem* AuraSubsystem = IsValid(World) ? World->GetSubsystem<UACM_AuraSubsystem>() : nullptr;
+
+	if (!IsValid(GameMode) || !IsValid(AuraSubsystem))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Aura.Bench needs an authoritative world"));
+		return;
+	}
+
+	const int32 NumAuras = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 50;
+	const int32 NumCharacters = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 200;
+	const int32 NumFrames = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 300;
+	const float AreaSize = 10000.0f;
+
+	// Without an effect only the spatial pass is timed, the enter/exit apply and remove costs are left out
+	TSubclassOf<UGameplayEffect> EffectClass;
+	if (Args.Num() > 3)
+	{
+		EffectClass = FSoftClassPath(Args[3]).TryLoadClass<UGameplayEffect>();
+		if (EffectClass == nullptr)
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Aura.Bench could not load effect class %s"), *Args[3]);
+			return;
+		}
+	}
+	else
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Aura.Bench running without an effect class, only target tracking is timed"));
+	}
+
+	FRandomStream RandomStream(1337);
+	auto RandomLocation = [&RandomStream, AreaSize]()
+	{
+		return FVector(RandomStream.FRandRange(0.0f, AreaSize), RandomStream.FRandRange(0.0f, AreaSize), 200.0f);
+	};
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<AActor*> SpawnedActors;
+
+	// Characters register themselves as aura targets on BeginPlay
+	for (int32 CharacterIndex = 0; CharacterIndex < NumCharacters; CharacterIndex++)
+	{
+		SpawnedActors.Add(World->SpawnActor<APawn>(GameMode->DefaultPawnClass, FTransform(RandomLocation()), SpawnParameters));
+	}
+
+	for (int32 AuraIndex = 0; AuraIndex < NumAuras; AuraIndex++)
+	{
+
+		AActor* AuraActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform(RandomLocation()), SpawnParameters);
+
+		USceneComponent* AuraRoot = NewObject<USceneComponent>(AuraActor);
+		AuraActor->SetRootComponent(AuraRoot);
+		AuraRoot->RegisterComponent();
+		AuraActor->SetActorLocation(RandomLocation());
+
+		UACM_AuraComponent* Aura = NewObject<UACM_AuraComponent>(AuraActor);
+		Aura->EffectClass = EffectClass;
+		Aura->RegisterComponent();
+
+		SpawnedActors.Add(AuraActor);
+
+	}
+
+	double TotalMs = 0.0;
+	double WorstMs = 0.0;
+
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; FrameIndex++)
+	{
+
+		// Small steps, like real movement: most frames nobody changes cell
+		for (AActor* SpawnedActor : SpawnedActors)
+		{
+			if (IsValid(SpawnedActor) && SpawnedActor->IsA<APawn>())
+			{
+				SpawnedActor->SetActorLocation(SpawnedActor->GetActorLocation() + FVector(RandomStream.FRandRange(-10.0f, 10.0f), RandomStream.FRandRange(-10.0f, 10.0f), 0.0f));
+			}
+		}
+
+		const double FrameStartSeconds = FPlatformTime::Seconds();
+		AuraSubsystem->ProcessAuras();
+		const double FrameMs = (FPlatformTime::Seconds() - FrameStartSeconds) * 1000.0;
+
+		TotalMs += FrameMs;
+		WorstMs = FMath::Max(WorstMs, FrameMs);
+
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Aura bench: %d auras, %d characters, %d frames, effect %s: %.4fms average, %.4fms worst"),
+		NumAuras, NumCharacters, NumFrames, *GetNameSafe(EffectClass), TotalMs / FMath::Max(NumFrames, 1), WorstMs);
+
+	for (AActor* SpawnedActor : SpawnedActors)
+	{
+		if (IsValid(SpawnedActor))
+		{
+			SpawnedActor->Destroy();
+		}
+	}
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarBenchmarkAuras(
+	TEXT("ACM.Aura.Bench"),
+	TEXT("Times aura processing with moving characters. Args: [NumAuras=50] [NumCharacters=200] [NumFrames=300] [EffectClassPath, e.g. /Game/Effects/GE_Aura.GE_Aura_C]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkAuras));
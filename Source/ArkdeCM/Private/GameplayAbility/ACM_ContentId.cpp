@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameplayAbility/ACM_ContentId.h"
+#include "UObject/UObjectIterator.h"
+
+//=========================================================================================================================================================
+uint32 ACM_ContentId::FromClass(const UClass* Class)
+{
+	return Class != nullptr ? FCrc::StrCrc32(*Class->GetPathName()) : 0;
+}
+
+//=========================================================================================================================================================
+UClass* ACM_ContentId::FindClass(uint32 ContentId, const UClass* BaseClass)
+{
+
+	if (ContentId == 0)
+	{
+		return nullptr;
+	}
+
+	for (TObjectIterator<UClass> ClassIterator; ClassIterator; ++ClassIterator)
+	{
+		if (ClassIterator->IsChildOf(BaseClass) && FromClass(*ClassIterator) == ContentId)
+		{
+			return *ClassIterator;
+		}
+	}
+
+	return nullptr;
+
+}
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_DamageHistoryComponent.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemInterface.h"
+#include "Abilities/GameplayAbility.h"
+#include "GameplayEffect.h"
+#include "GameplayEffectExtension.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/World.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "GameplayAbility/ACM_ContentId.h"
+#include "GameplayAbility/ACM_GameplayTags.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_MEMORY_STAT(TEXT("Damage History"), STAT_ACM_DamageHistoryMemory, STATGROUP_ArkdeCM);
+
+namespace ACM_DamageHistory
+{
+
+	/** Upper bound accepted from the server, Capacity is clamped to 256 records */
+	static const int32 MaxRecapBytes = 64 * 1024;
+
+	static FString GetSourceName(const AActor* Source)
+	{
+
+		const APawn* SourcePawn = Cast<APawn>(Source);
+		if (SourcePawn != nullptr && SourcePawn->GetPlayerState() != nullptr)
+		{
+			return SourcePawn->GetPlayerState()->GetPlayerName();
+		}
+
+		return Source != nullptr ? Source->GetName() : FString();
+
+	}
+
+	static UAbilitySystemComponent* GetAbilitySystemComponent(AActor* Owner)
+	{
+
+		IAbilitySystemInterface* AbilitySystemInterface = Cast<IAbilitySystemInterface>(Owner);
+		return AbilitySystemInterface != nullptr ? AbilitySystemInterface->GetAbilitySystemComponent() : nullptr;
+
+	}
+
+}
+
+//=========================================================================================================================================================
+UACM_DamageHistoryComponent::UACM_DamageHistoryComponent()
+{
+
+	PrimaryComponentTick.bCanEverTick = false;
+	SetIsReplicatedByDefault(true);
+
+	Capacity = 32;
+	NextRecord = 0;
+	NumRecords = 0;
+	bDead = false;
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::BeginPlay()
+{
+
+	Super::BeginPlay();
+
+	if (GetOwnerRole() == ENetRole::ROLE_Authority)
+	{
+
+		Records.SetNumZeroed(FMath::Clamp(Capacity, 1, 256));
+		INC_MEMORY_STAT_BY(STAT_ACM_DamageHistoryMemory, Records.GetAllocatedSize());
+
+		// Respawns, snapshot restores and heals all raise Health through the attribute, so that is where a new life starts
+		UAbilitySystemComponent* AbilitySystemComponent = ACM_DamageHistory::GetAbilitySystemComponent(GetOwner());
+		if (IsValid(AbilitySystemComponent))
+		{
+			HealthChangedHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(UACM_AttributeSet::GetHealthAttribute()).AddUObject(this, &UACM_DamageHistoryComponent::HandleHealthChanged);
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	UAbilitySystemComponent* AbilitySystemComponent = ACM_DamageHistory::GetAbilitySystemComponent(GetOwner());
+	if (IsValid(AbilitySystemComponent) && HealthChangedHandle.IsValid())
+	{
+		AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(UACM_AttributeSet::GetHealthAttribute()).Remove(HealthChangedHandle);
+	}
+
+	HealthChangedHandle.Reset();
+
+	DEC_MEMORY_STAT_BY(STAT_ACM_DamageHistoryMemory, Records.GetAllocatedSize());
+	Records.Empty();
+
+	Super::EndPlay(EndPlayReason);
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Records.GetAllocatedSize());
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::RecordHealthChange(const FGameplayEffectModCallbackData& Data, float ResultingHealth)
+{
+
+	if (Records.Num() == 0 || bDead)
+	{
+		return;
+	}
+
+	const FGameplayEffectContextHandle& EffectContext = Data.EffectSpec.GetContext();
+	const UGameplayAbility* Ability = EffectContext.GetAbility();
+
+	FRecord& Record = Records[NextRecord];
+	Record.ServerTime = GetWorld()->GetTimeSeconds();
+	Record.Amount = Data.EvaluatedData.Magnitude;
+	Record.ResultingHealth = ResultingHealth;
+	Record.AbilityId = Ability != nullptr ? ACM_ContentId::FromClass(Ability->GetClass()) : 0;
+	Record.EffectId = Data.EffectSpec.Def != nullptr ? ACM_ContentId::FromClass(Data.EffectSpec.Def->GetClass()) : 0;
+	Record.Source = EffectContext.GetOriginalInstigator();
+
+	NextRecord = (NextRecord + 1) % Records.Num();
+	NumRecords = FMath::Min(NumRecords + 1, Records.Num());
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::HandleDeath()
+{
+
+	if (bDead || GetOwnerRole() != ENetRole::ROLE_Authority)
+	{
+		return;
+	}
+
+	bDead = true;
+
+	// The loose tag is tracked in the replicated PublicTagState, that is how clients see State.Dead through HasPublicTag
+	UAbilitySystemComponent* AbilitySystemComponent = ACM_DamageHistory::GetAbilitySystemComponent(GetOwner());
+	if (IsValid(AbilitySystemComponent))
+	{
+		AbilitySystemComponent->SetLooseGameplayTagCount(FACM_GameplayTags::Get().State_Dead, 1);
+	}
+
+	TArray<uint8> UncompressedRecap;
+	WriteRecap(UncompressedRecap);
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedRecap.Num());
+	TArray<uint8> CompressedRecap;
+	CompressedRecap.SetNumUninitialized(CompressedSize);
+
+	if (!FCompression::CompressMemory(NAME_Zlib, CompressedRecap.GetData(), CompressedSize, UncompressedRecap.GetData(), UncompressedRecap.Num()))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Could not compress the death recap of %s"), *GetNameSafe(GetOwner()));
+		return;
+	}
+
+	CompressedRecap.SetNum(CompressedSize);
+	ClientReceiveDeathRecap(CompressedRecap, UncompressedRecap.Num());
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::ResetHistory()
+{
+
+	NextRecord = 0;
+	NumRecords = 0;
+	bDead = false;
+
+	UAbilitySystemComponent* AbilitySystemComponent = ACM_DamageHistory::GetAbilitySystemComponent(GetOwner());
+	if (IsValid(AbilitySystemComponent))
+	{
+		AbilitySystemComponent->SetLooseGameplayTagCount(FACM_GameplayTags::Get().State_Dead, 0);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::HandleHealthChanged(const FOnAttributeChangeData& Data)
+{
+
+	if (bDead && Data.NewValue > 0.0f)
+	{
+		ResetHistory();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::WriteRecap(TArray<uint8>& OutBytes) const
+{
+
+	FMemoryWriter Writer(OutBytes);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	int32 NumEntries = NumRecords;
+	Writer << NumEntries;
+
+	const int32 FirstRecord = (NextRecord - NumRecords + Records.Num()) % FMath::Max(Records.Num(), 1);
+	for (int32 EntryIndex = 0; EntryIndex < NumRecords; EntryIndex++)
+	{
+
+		const FRecord& Record = Records[(FirstRecord + EntryIndex) % Records.Num()];
+
+		float TimeBeforeDeath = Now - Record.ServerTime;
+		FString SourceName = ACM_DamageHistory::GetSourceName(Record.Source.Get());
+		uint32 AbilityId = Record.AbilityId;
+		uint32 EffectId = Record.EffectId;
+		float Amount = Record.Amount;
+		float ResultingHealth = Record.ResultingHealth;
+
+		Writer << TimeBeforeDeath << SourceName << AbilityId << EffectId << Amount << ResultingHealth;
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_DamageHistoryComponent::ClientReceiveDeathRecap_Implementation(const TArray<uint8>& CompressedRecap, int32 UncompressedSize)
+{
+
+	if (UncompressedSize <= 0 || UncompressedSize > ACM_DamageHistory::MaxRecapBytes)
+	{
+		return;
+	}
+
+	TArray<uint8> UncompressedRecap;
+	UncompressedRecap.SetNumUninitialized(UncompressedSize);
+
+	if (!FCompression::UncompressMemory(NAME_Zlib, UncompressedRecap.GetData(), UncompressedSize, CompressedRecap.GetData(), CompressedRecap.Num()))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Could not decompress the death recap"));
+		return;
+	}
+
+	FMemoryReader Reader(UncompressedRecap);
+
+	int32 NumEntries = 0;
+	Reader << NumEntries;
+
+	TArray<FACM_DeathRecapEntry> Entries;
+	for (int32 EntryIndex = 0; EntryIndex < NumEntries && !Reader.IsError() && !Reader.AtEnd(); EntryIndex++)
+	{
+
+		FACM_DeathRecapEntry& Entry = Entries.AddDefaulted_GetRef();
+
+		uint32 AbilityId = 0;
+		uint32 EffectId = 0;
+		Reader << Entry.TimeBeforeDeath << Entry.SourceName << AbilityId << EffectId << Entry.Amount << Entry.ResultingHealth;
+
+		Entry.AbilityClass = ACM_ContentId::FindClass(AbilityId, UGameplayAbility::StaticClass());
+		Entry.EffectClass = ACM_ContentId::FindClass(EffectId, UGameplayEffect::StaticClass());
+
+	}
+
+	OnDeathRecapReceived.Broadcast(Entries);
+
+}
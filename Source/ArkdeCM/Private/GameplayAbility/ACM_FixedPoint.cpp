@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameplayAbility/ACM_FixedPoint.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+static TAutoConsoleVariable<int32> CVarFixedPointAttributes(
+	TEXT("ACM.Attributes.FixedPoint"),
+	0,
+	TEXT("1 keeps UACM_AttributeSet values on a 1/256 grid with integer rescale and regen math. Server authoritative: sets created afterwards replicate the mode to clients."),
+	ECVF_Default);
+
+//=========================================================================================================================================================
+bool ACM_FixedPoint::IsEnabled()
+{
+	return CVarFixedPointAttributes.GetValueOnGameThread() != 0;
+}
+
+//=========================================================================================================================================================
+namespace ACM_FixedPointCheck
+{
+
+	static const int32 DefaultNumCases = 100000;
+	static const int32 Seed = 0xAC3D;
+
+	// Checksum of the default run, computed once on a reference build. Every platform and compiler must reproduce it
+	static const uint32 ExpectedChecksum = 0xf1e94663;
+
+	static bool IsOnGrid(float Value)
+	{
+		return ACM_FixedPoint::Quantize(Value) == Value;
+	}
+
+}
+
+//=========================================================================================================================================================
+static void VerifyFixedPoint(const TArray<FString>& Args)
+{
+
+	const int32 NumCases = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : ACM_FixedPointCheck::DefaultNumCases;
+
+	FRandomStream RandomStream(ACM_FixedPointCheck::Seed);
+	uint32 Checksum = 0;
+	int32 NumClampedCases = 0;
+	int32 NumMismatches = 0;
+
+	for (int32 CaseIndex = 0; CaseIndex < NumCases; CaseIndex++)
+	{
+
+		// Raw inputs are off the grid on purpose, the set snaps them on the way in and so does every step below.
+		// Ranges start at zero so no build can fuse the random scale and offset into a differently rounded multiply-add.
+		const float Value = RandomStream.FRandRange(0.0f, 1000.0f);
+		const float MaxValue = RandomStream.FRandRange(0.0f, 1000.0f);
+		const float NewMaxValue = RandomStream.FRandRange(0.0f, 1000.0f);
+		const float Damage = RandomStream.FRandRange(0.0f, 100.0f);
+		const float Rate = RandomStream.FRandRange(0.0f, 100.0f);
+		const float DeltaSeconds = RandomStream.FRandRange(0.0f, 0.1f);
+
+		const float SnappedValue = ACM_FixedPoint::Quantize(Value);
+		const float SnappedMax = ACM_FixedPoint::Quantize(MaxValue);
+
+		// Regen past Max must stop exactly on Max, about half of the cases start above Max or regen into it
+		const float Regenerated = ACM_FixedPoint::Regen(Value, Rate, DeltaSeconds, MaxValue);
+		if (Regenerated == SnappedMax)
+		{
+			NumClampedCases++;
+		}
+
+		// Damage the way the set applies it: snapped after the subtraction, then clamped to the resource range
+		const float Damaged = FMath::Clamp(ACM_FixedPoint::Quantize(Regenerated - Damage), 0.0f, SnappedMax);
+		const float Rescaled = ACM_FixedPoint::Rescale(Damaged, MaxValue, NewMaxValue);
+		const float RescaledFull = ACM_FixedPoint::Rescale(SnappedMax, MaxValue, NewMaxValue);
+
+		TArray<const TCHAR*, TInlineAllocator<4>> Failures;
+		if (!ACM_FixedPointCheck::IsOnGrid(Regenerated) || !ACM_FixedPointCheck::IsOnGrid(Damaged) || !ACM_FixedPointCheck::IsOnGrid(Rescaled))
+		{
+			Failures.Add(TEXT("result off the grid"));
+		}
+
+		if (Regenerated > SnappedMax || Regenerated < FMath::Min(SnappedValue, SnappedMax))
+		{
+			Failures.Add(TEXT("regen outside [Value, Max]"));
+		}
+
+		if (SnappedMax > 0.0f && RescaledFull != ACM_FixedPoint::Quantize(NewMaxValue))
+		{
+			Failures.Add(TEXT("full resource not full after rescale"));
+		}
+
+		for (const TCHAR* Failure : Failures)
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("Fixed point case %d: %s (Value %.9g, Max %.9g, NewMax %.9g, Damage %.9g, Rate %.9g, Delta %.9g)"), CaseIndex, Failure, Value, MaxValue, NewMaxValue, Damage, Rate, DeltaSeconds);
+		}
+
+		NumMismatches += Failures.Num();
+
+		Checksum = FCrc::MemCrc32(&Regenerated, sizeof(Regenerated), Checksum);
+		Checksum = FCrc::MemCrc32(&Damaged, sizeof(Damaged), Checksum);
+		Checksum = FCrc::MemCrc32(&Rescaled, sizeof(Rescaled), Checksum);
+
+	}
+
+	// FRandomStream and the fixed-point math are platform independent, a different checksum is a determinism break
+	if (NumCases == ACM_FixedPointCheck::DefaultNumCases)
+	{
+
+		if (Checksum != ACM_FixedPointCheck::ExpectedChecksum)
+		{
+			UE_LOG(LogArkdeCM, Error, TEXT("Fixed point checksum 0x%08x, expected 0x%08x: this build does not reproduce the reference results"), Checksum, ACM_FixedPointCheck::ExpectedChecksum);
+			NumMismatches++;
+		}
+
+	}
+	else
+	{
+		UE_LOG(LogArkdeCM, Display, TEXT("Fixed point checksum 0x%08x, only the default %d cases have a reference value"), Checksum, ACM_FixedPointCheck::DefaultNumCases);
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Fixed point: %d cases (%d clamped to Max), %d mismatches"), NumCases, NumClampedCases, NumMismatches);
+
+}
+
+static FAutoConsoleCommandWithArgs CVarVerifyFixedPoint(
+	TEXT("ACM.Attributes.VerifyFixedPoint"),
+	TEXT("Runs N random off-grid fixed-point cases (default 100000) with regen clamped to Max, checks grid and clamp invariants and, for the default run, the reference checksum"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&VerifyFixedPoint));
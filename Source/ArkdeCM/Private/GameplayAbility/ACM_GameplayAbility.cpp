@@ -2,6 +2,11 @@
 
 
 #include "GameplayAbility/ACM_GameplayAbility.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_ContentId.h"
+#include "GameplayAbility/ACM_GameplayEffect.h"
+#include "GameplayAbility/ACM_GameplayTags.h"
+#include "AbilitySystemGlobals.h"
 
 //=========================================================================================================================================================
 UACM_GameplayAbility::UACM_GameplayAbility()
@@ -9,5 +14,244 @@ UACM_GameplayAbility::UACM_GameplayAbility()
 
 	AbilityInputID = EACM_AbilityInputID::None;
 	AbilityInputID = EACM_AbilityInputID::None;
+	ActivationGroup = EACM_AbilityActivationGroup::Independent;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_GameplayAbility::CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags, OUT FGameplayTagContainer* OptionalRelevantTags) const
+{
+
+	const UACM_AbilitySystemComponent* AbilitySystemComponent = ActorInfo != nullptr ? Cast<UACM_AbilitySystemComponent>(ActorInfo->AbilitySystemComponent.Get()) : nullptr;
+	if (AbilitySystemComponent != nullptr && AbilitySystemComponent->IsActivationGroupBlocked(ActivationGroup))
+	{
+		return false;
+	}
+
+	return Super::CanActivateAbility(Handle, ActorInfo, SourceTags, TargetTags, OptionalRelevantTags);
+
+}
+
+//=========================================================================================================================================================
+float UACM_GameplayAbility::GetLevelMagnitude(FGameplayTag MagnitudeTag, float Level) const
+{
+
+	const FACM_LevelValues* Values = GetLevelCache().Magnitudes.Find(MagnitudeTag);
+	if (Values == nullptr)
+	{
+		return 0.0f;
+	}
+
+	float Magnitude = 0.0f;
+	if (!Values->TryGet(Level, Magnitude))
+	{
+		const UACM_GameplayAbility* Defaults = GetClass()->GetDefaultObject<UACM_GameplayAbility>();
+		Magnitude = Defaults->LevelMagnitudes.FindChecked(MagnitudeTag).GetValueAtLevel(Level);
+	}
+
+	return Magnitude;
+
+}
+
+//=========================================================================================================================================================
+void UACM_GameplayAbility::WarmLevelCaches() const
+{
+
+	GetLevelCache();
+
+	const UACM_GameplayEffect* CostEffect = Cast<UACM_GameplayEffect>(GetCostGameplayEffect());
+	if (CostEffect != nullptr)
+	{
+		CostEffect->WarmLevelCache();
+	}
+
+	const UACM_GameplayEffect* CooldownEffect = Cast<UACM_GameplayEffect>(GetCooldownGameplayEffect());
+	if (CooldownEffect != nullptr)
+	{
+		CooldownEffect->WarmLevelCache();
+	}
+
+}
+
+//=========================================================================================================================================================
+const UACM_GameplayAbility::FLevelCache& UACM_GameplayAbility::GetLevelCache() const
+{
+
+	const UACM_GameplayAbility* Defaults = GetClass()->GetDefaultObject<UACM_GameplayAbility>();
+	FLevelCache& Cache = Defaults->LevelCache;
+
+	const int32 CurveGeneration = FACM_LevelValues::GetCurveGeneration();
+	if (Cache.CurveGeneration != CurveGeneration)
+	{
+
+		Cache.Magnitudes.Reset();
+		for (const TPair<FGameplayTag, FScalableFloat>& MagnitudePair : Defaults->LevelMagnitudes)
+		{
+			Cache.Magnitudes.Add(MagnitudePair.Key).Build(MagnitudePair.Value);
+		}
+
+		Cache.CurveGeneration = CurveGeneration;
+
+	}
+
+	return Cache;
+
+}
+
+//=========================================================================================================================================================
+FGameplayEffectSpecHandle UACM_GameplayAbility::MakeOutgoingGameplayEffectSpec(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, TSubclassOf<UGameplayEffect> GameplayEffectClass, float Level) const
+{
+
+	FGameplayEffectSpecHandle SpecHandle = Super::MakeOutgoingGameplayEffectSpec(Handle, ActorInfo, ActivationInfo, GameplayEffectClass, Level);
+
+	FGameplayEffectSpec* Spec = SpecHandle.Data.Get();
+	if (Spec == nullptr || LevelMagnitudes.Num() == 0)
+	{
+		return SpecHandle;
+	}
+
+	for (const TPair<FGameplayTag, FACM_LevelValues>& MagnitudePair : GetLevelCache().Magnitudes)
+	{
+		Spec->SetSetByCallerMagnitude(MagnitudePair.Key, GetLevelMagnitude(MagnitudePair.Key, Level));
+	}
+
+	return SpecHandle;
+
+}
+
+#if WITH_EDITOR
+//=========================================================================================================================================================
+void UACM_GameplayAbility::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	LevelCache.CurveGeneration = INDEX_NONE;
+
+}
+#endif
+
+//=========================================================================================================================================================
+FACM_AbilityTuning UACM_GameplayAbility::GetTuning() const
+{
+
+	if (TuningOwnerId == 0)
+	{
+		TuningOwnerId = ACM_ContentId::FromClass(GetClass());
+	}
+
+	return FACM_TuningTable::FindOwner<FACM_AbilityTuning>(TuningOwnerId);
+
+}
+
+//=========================================================================================================================================================
+bool UACM_GameplayAbility::CheckCost(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, OUT FGameplayTagContainer* OptionalRelevantTags) const
+{
+
+	const UGameplayEffect* CostEffect = GetCostGameplayEffect();
+	const UAbilitySystemComponent* AbilitySystemComponent = ActorInfo != nullptr ? ActorInfo->AbilitySystemComponent.Get() : nullptr;
+	if (CostEffect == nullptr || AbilitySystemComponent == nullptr)
+	{
+		return Super::CheckCost(Handle, ActorInfo, OptionalRelevantTags);
+	}
+
+	const float Level = GetAbilityLevel(Handle, ActorInfo);
+
+	// UAbilitySystemComponent::CanApplyAttributeModifiers builds and evaluates a whole spec without SetByCaller values.
+	// A tuned cost is checked against a spec that carries it, a plain one against the cost effect's level cache
+	float Cost = 0.0f;
+	TOptional<FGameplayEffectSpec> TunedCostSpec;
+	if (GetTuning().TryGetCost(Cost))
+	{
+		TunedCostSpec.Emplace(CostEffect, MakeEffectContext(Handle, ActorInfo), Level);
+		TunedCostSpec->SetSetByCallerMagnitude(FACM_GameplayTags::Get().Data_Cost, -Cost);
+		TunedCostSpec->CalculateModifierMagnitudes();
+	}
+
+	const UACM_GameplayEffect* CachedCostEffect = Cast<UACM_GameplayEffect>(CostEffect);
+	if (!TunedCostSpec.IsSet() && CachedCostEffect == nullptr)
+	{
+		return Super::CheckCost(Handle, ActorInfo, OptionalRelevantTags);
+	}
+
+	for (int32 ModifierIndex = 0; ModifierIndex < CostEffect->Modifiers.Num(); ModifierIndex++)
+	{
+
+		const FGameplayModifierInfo& ModifierInfo = CostEffect->Modifiers[ModifierIndex];
+		if (ModifierInfo.ModifierOp != EGameplayModOp::Additive || !ModifierInfo.Attribute.IsValid())
+		{
+			continue;
+		}
+
+		float Magnitude = 0.0f;
+		if (TunedCostSpec.IsSet())
+		{
+			Magnitude = TunedCostSpec->Modifiers[ModifierIndex].GetEvaluatedMagnitude();
+		}
+		else if (!CachedCostEffect->TryGetModifierMagnitudeAtLevel(ModifierIndex, Level, Magnitude))
+		{
+			return Super::CheckCost(Handle, ActorInfo, OptionalRelevantTags);
+		}
+
+		const UAttributeSet* AttributeSet = AbilitySystemComponent->GetAttributeSubobject(ModifierInfo.Attribute.GetAttributeSetClass());
+		if (AttributeSet != nullptr && ModifierInfo.Attribute.GetNumericValueChecked(AttributeSet) + Magnitude < 0.0f)
+		{
+
+			const FGameplayTag& CostTag = UAbilitySystemGlobals::Get().ActivateFailCostTag;
+			if (OptionalRelevantTags != nullptr && CostTag.IsValid())
+			{
+				OptionalRelevantTags->AddTag(CostTag);
+			}
+
+			return false;
+
+		}
+
+	}
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+void UACM_GameplayAbility::ApplyCost(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo) const
+{
+
+	float Cost = 0.0f;
+	const UGameplayEffect* CostEffect = GetCostGameplayEffect();
+	if (CostEffect == nullptr || !GetTuning().TryGetCost(Cost))
+	{
+		Super::ApplyCost(Handle, ActorInfo, ActivationInfo);
+		return;
+	}
+
+	FGameplayEffectSpecHandle CostSpecHandle = MakeOutgoingGameplayEffectSpec(Handle, ActorInfo, ActivationInfo, CostEffect->GetClass(), GetAbilityLevel(Handle, ActorInfo));
+	if (CostSpecHandle.IsValid())
+	{
+		CostSpecHandle.Data->SetSetByCallerMagnitude(FACM_GameplayTags::Get().Data_Cost, -Cost);
+		ApplyGameplayEffectSpecToOwner(Handle, ActorInfo, ActivationInfo, CostSpecHandle);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_GameplayAbility::ApplyCooldown(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo) const
+{
+
+	float CooldownSeconds = 0.0f;
+	const UGameplayEffect* CooldownEffect = GetCooldownGameplayEffect();
+	if (CooldownEffect == nullptr || !GetTuning().TryGetCooldown(CooldownSeconds))
+	{
+		Super::ApplyCooldown(Handle, ActorInfo, ActivationInfo);
+		return;
+	}
+
+	FGameplayEffectSpecHandle CooldownSpecHandle = MakeOutgoingGameplayEffectSpec(Handle, ActorInfo, ActivationInfo, CooldownEffect->GetClass(), GetAbilityLevel(Handle, ActorInfo));
+	if (CooldownSpecHandle.IsValid())
+	{
+		// MakeOutgoingSpec already locked the duration of the cooldown effect itself
+		UACM_AbilitySystemComponent::OverrideDuration(*CooldownSpecHandle.Data, CooldownSeconds);
+		ApplyGameplayEffectSpecToOwner(Handle, ActorInfo, ActivationInfo, CooldownSpecHandle);
+	}
 
 }
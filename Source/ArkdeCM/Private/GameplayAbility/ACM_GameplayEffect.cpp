@@ -2,4 +2,93 @@
 
 
 #include "GameplayAbility/ACM_GameplayEffect.h"
+#include "GameplayAbility/ACM_ContentId.h"
 
+//=========================================================================================================================================================
+const UACM_GameplayEffect::FTagMasks& UACM_GameplayEffect::GetTagMasks() const
+{
+
+	if (!bTagMasksBuilt)
+	{
+
+		TagMasks.bApplicationExact = FACM_TagIndex::MakeRequirementBits(ApplicationTagRequirements.RequireTags, TagMasks.ApplicationRequireBits)
+			&& FACM_TagIndex::MakeRequirementBits(ApplicationTagRequirements.IgnoreTags, TagMasks.ApplicationIgnoreBits);
+
+		// Immunity queries match the whole spec, only the tag form reduces to masks
+		TagMasks.bImmunityExact = GrantedApplicationImmunityQuery.IsEmpty()
+			&& FACM_TagIndex::MakeRequirementBits(GrantedApplicationImmunityTags.RequireTags, TagMasks.ImmunityRequireBits)
+			&& FACM_TagIndex::MakeRequirementBits(GrantedApplicationImmunityTags.IgnoreTags, TagMasks.ImmunityIgnoreBits);
+
+		bTagMasksBuilt = true;
+
+	}
+
+	return TagMasks;
+
+}
+
+//=========================================================================================================================================================
+FACM_EffectTuning UACM_GameplayEffect::GetTuning() const
+{
+
+	if (TuningOwnerId == 0)
+	{
+		TuningOwnerId = ACM_ContentId::FromClass(GetClass());
+	}
+
+	return FACM_TuningTable::FindOwner<FACM_EffectTuning>(TuningOwnerId);
+
+}
+
+//=========================================================================================================================================================
+bool UACM_GameplayEffect::TryGetDurationAtLevel(float Level, float& OutDuration) const
+{
+
+	WarmLevelCache();
+	return LevelCache.Duration.TryGet(Level, OutDuration);
+
+}
+
+//=========================================================================================================================================================
+bool UACM_GameplayEffect::TryGetModifierMagnitudeAtLevel(int32 ModifierIndex, float Level, float& OutMagnitude) const
+{
+
+	WarmLevelCache();
+	return LevelCache.ModifierMagnitudes.IsValidIndex(ModifierIndex) && LevelCache.ModifierMagnitudes[ModifierIndex].TryGet(Level, OutMagnitude);
+
+}
+
+//=========================================================================================================================================================
+void UACM_GameplayEffect::WarmLevelCache() const
+{
+
+	const int32 CurveGeneration = FACM_LevelValues::GetCurveGeneration();
+	if (LevelCache.CurveGeneration == CurveGeneration)
+	{
+		return;
+	}
+
+	LevelCache.Duration.Build(DurationMagnitude);
+
+	LevelCache.ModifierMagnitudes.SetNum(Modifiers.Num());
+	for (int32 ModifierIndex = 0; ModifierIndex < Modifiers.Num(); ModifierIndex++)
+	{
+		LevelCache.ModifierMagnitudes[ModifierIndex].Build(Modifiers[ModifierIndex].ModifierMagnitude);
+	}
+
+	LevelCache.CurveGeneration = CurveGeneration;
+
+}
+
+#if WITH_EDITOR
+//=========================================================================================================================================================
+void UACM_GameplayEffect::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	bTagMasksBuilt = false;
+	LevelCache.CurveGeneration = INDEX_NONE;
+
+}
+#endif
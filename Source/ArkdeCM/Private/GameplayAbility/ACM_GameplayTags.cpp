@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_GameplayTags.h"
+#include "GameplayTagsManager.h"
+#include "GameplayAbility/ACM_PublicTagState.h"
+
+FACM_GameplayTags FACM_GameplayTags::GameplayTags;
+
+//=========================================================================================================================================================
+void FACM_GameplayTags::InitializeNativeTags()
+{
+
+	if (GameplayTags.PublicTags.Num() > 0)
+	{
+		return;
+	}
+
+	GameplayTags.AddPublicTag(GameplayTags.State_Stunned, "State.Stunned", "Character can not move or act");
+	GameplayTags.AddPublicTag(GameplayTags.State_Sprinting, "State.Sprinting", "Character is sprinting");
+	GameplayTags.AddPublicTag(GameplayTags.State_Dead, "State.Dead", "Character is dead");
+	GameplayTags.AddPublicTag(GameplayTags.State_Casting, "State.Casting", "Character is casting an ability");
+
+	check(GameplayTags.PublicTags.Num() <= FACM_PublicTagState::MaxTags);
+
+	GameplayTags.AddTag(GameplayTags.Data_Cost, "Data.Cost", "Tuned ability cost, negated, for the cost effect");
+	GameplayTags.AddTag(GameplayTags.Data_Magnitude, "Data.Magnitude", "Tuned effect magnitude");
+
+}
+
+//=========================================================================================================================================================
+int32 FACM_GameplayTags::GetPublicTagIndex(const FGameplayTag& Tag) const
+{
+	return PublicTags.IndexOfByKey(Tag);
+}
+
+//=========================================================================================================================================================
+void FACM_GameplayTags::AddTag(FGameplayTag& OutTag, const ANSICHAR* TagName, const ANSICHAR* TagComment)
+{
+	OutTag = UGameplayTagsManager::Get().AddNativeGameplayTag(FName(TagName), FString(TEXT("(Native) ")) + FString(TagComment));
+}
+
+//=========================================================================================================================================================
+void FACM_GameplayTags::AddPublicTag(FGameplayTag& OutTag, const ANSICHAR* TagName, const ANSICHAR* TagComment)
+{
+
+	AddTag(OutTag, TagName, TagComment);
+	PublicTags.Add(OutTag);
+
+}
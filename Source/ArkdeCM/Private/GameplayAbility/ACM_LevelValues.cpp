@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_LevelValues.h"
+#include "AttributeSet.h"
+#include "GameplayEffect.h"
+#include "Engine/CurveTable.h"
+
+//=========================================================================================================================================================
+void FACM_LevelValues::Build(const FScalableFloat& Source)
+{
+
+	Values.SetNumUninitialized(MaxLevel);
+
+	for (int32 Level = 1; Level <= MaxLevel; Level++)
+	{
+		Values[Level - 1] = Source.GetValueAtLevel(Level);
+	}
+
+}
+
+//=========================================================================================================================================================
+void FACM_LevelValues::Build(const FGameplayEffectModifierMagnitude& Source)
+{
+
+	Values.Reset();
+
+	if (Source.GetMagnitudeCalculationType() != EGameplayEffectMagnitudeCalculation::ScalableFloat)
+	{
+		return;
+	}
+
+	Values.SetNumUninitialized(MaxLevel);
+
+	for (int32 Level = 1; Level <= MaxLevel; Level++)
+	{
+		Source.GetStaticMagnitudeIfPossible(Level, Values[Level - 1]);
+	}
+
+}
+
+//=========================================================================================================================================================
+bool FACM_LevelValues::TryGet(float Level, float& OutValue) const
+{
+
+	const int32 LevelIndex = FMath::TruncToInt(Level) - 1;
+	if (LevelIndex + 1 != Level || !Values.IsValidIndex(LevelIndex))
+	{
+		return false;
+	}
+
+	OutValue = Values[LevelIndex];
+	return true;
+
+}
+
+//=========================================================================================================================================================
+int32 FACM_LevelValues::GetCurveGeneration()
+{
+	return UCurveTable::GetGlobalCachedCurveID();
+}
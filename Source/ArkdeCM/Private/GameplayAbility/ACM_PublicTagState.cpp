@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_PublicTagState.h"
+#include "GameplayAbility/ACM_GameplayTags.h"
+
+namespace ACM_PublicTagState
+{
+
+	/** Bits a connection acknowledged, kept by the replication system per connection */
+	struct FDeltaState : public INetDeltaBaseState
+	{
+
+		uint32 Bits = 0;
+
+		virtual bool IsStateEqual(INetDeltaBaseState* OtherState) override
+		{
+			return Bits == static_cast<FDeltaState*>(OtherState)->Bits;
+		}
+
+	};
+
+}
+
+//=========================================================================================================================================================
+bool FACM_PublicTagState::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+
+	using namespace ACM_PublicTagState;
+
+	const uint32 NumTags = static_cast<uint32>(FMath::Max(FACM_GameplayTags::Get().PublicTags.Num(), 1));
+
+	if (DeltaParms.Writer != nullptr)
+	{
+
+		const FDeltaState* OldState = static_cast<FDeltaState*>(DeltaParms.OldState);
+		if (OldState != nullptr && OldState->Bits == Bits)
+		{
+			return false;
+		}
+
+		TSharedPtr<FDeltaState> NewState = MakeShared<FDeltaState>();
+		NewState->Bits = Bits;
+		*DeltaParms.NewState = NewState;
+
+		FBitWriter& Writer = *DeltaParms.Writer;
+
+		uint8 bFullState = OldState == nullptr ? 1 : 0;
+		Writer.WriteBit(bFullState);
+
+		if (bFullState)
+		{
+			uint32 FullBits = Bits;
+			Writer.SerializeBits(&FullBits, NumTags);
+			return true;
+		}
+
+		const uint32 ChangedBits = OldState->Bits ^ Bits;
+
+		uint32 NumChanged = FMath::CountBits(ChangedBits);
+		Writer.SerializeInt(NumChanged, NumTags + 1);
+
+		for (uint32 TagIndex = 0; TagIndex < NumTags; TagIndex++)
+		{
+			if ((ChangedBits & (1u << TagIndex)) != 0)
+			{
+				Writer.SerializeInt(TagIndex, NumTags);
+				Writer.WriteBit(HasTag(TagIndex) ? 1 : 0);
+			}
+		}
+
+		return true;
+
+	}
+
+	if (DeltaParms.Reader != nullptr)
+	{
+
+		FBitReader& Reader = *DeltaParms.Reader;
+
+		if (Reader.ReadBit() != 0)
+		{
+			uint32 FullBits = 0;
+			Reader.SerializeBits(&FullBits, NumTags);
+			Bits = FullBits;
+			return !Reader.IsError();
+		}
+
+		uint32 NumChanged = 0;
+		Reader.SerializeInt(NumChanged, NumTags + 1);
+
+		for (uint32 ChangeIndex = 0; ChangeIndex < NumChanged && !Reader.IsError(); ChangeIndex++)
+		{
+			uint32 TagIndex = 0;
+			Reader.SerializeInt(TagIndex, NumTags);
+			SetTag(TagIndex, Reader.ReadBit() != 0);
+		}
+
+		return !Reader.IsError();
+
+	}
+
+	return true;
+
+}
@@ -0,0 +1,306 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_SharedEffectSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "GameplayEffect.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+//=========================================================================================================================================================
+FACM_SharedEffectHandle UACM_SharedEffectSubsystem::CreateSharedEffect(TSubclassOf<UGameplayEffect> EffectClass, UAbilitySystemComponent* SourceComponent, float Level, float Duration, const TMap<FGameplayTag, float>& MagnitudesPerStack)
+{
+
+	FACM_SharedEffectHandle Handle;
+
+	if (!IsValid(EffectClass) || GetWorld()->GetNetMode() == NM_Client)
+	{
+		return Handle;
+	}
+
+	const UGameplayEffect* EffectDefinition = EffectClass->GetDefaultObject<UGameplayEffect>();
+	if (EffectDefinition->DurationPolicy != EGameplayEffectDurationType::Infinite)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Shared effect %s must use the Infinite duration policy, the group owns the duration"), *EffectClass->GetName());
+		return Handle;
+	}
+
+	Handle.Id = NextId++;
+
+	FSharedEffect& SharedEffect = SharedEffects.Add(Handle.Id);
+	SharedEffect.MagnitudesPerStack = MagnitudesPerStack;
+
+	FGameplayEffectContextHandle EffectContext = IsValid(SourceComponent) ? SourceComponent->MakeEffectContext() : FGameplayEffectContextHandle(UAbilitySystemGlobals::Get().AllocGameplayEffectContext());
+	SharedEffect.EffectSpec = FGameplayEffectSpecHandle(new FGameplayEffectSpec(EffectDefinition, EffectContext, Level));
+
+	RefreshMagnitudes(SharedEffect);
+	SetDuration(Handle, Duration);
+
+	return Handle;
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::RemoveSharedEffect(FACM_SharedEffectHandle Handle)
+{
+
+	FSharedEffect SharedEffect;
+	if (!SharedEffects.RemoveAndCopyValue(Handle.Id, SharedEffect))
+	{
+		return;
+	}
+
+	GetWorld()->GetTimerManager().ClearTimer(SharedEffect.ExpiryTimer);
+
+	for (const FMember& Member : SharedEffect.Members)
+	{
+		RemoveFromMember(Member);
+	}
+
+}
+
+//=========================================================================================================================================================
+bool UACM_SharedEffectSubsystem::AddMember(FACM_SharedEffectHandle Handle, UAbilitySystemComponent* MemberComponent)
+{
+
+	FSharedEffect* SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr || !IsValid(MemberComponent))
+	{
+		return false;
+	}
+
+	const int32 MemberIndex = SharedEffect->Members.IndexOfByPredicate([MemberComponent](const FMember& Member)
+	{
+		return Member.AbilitySystemComponent.Get() == MemberComponent;
+	});
+
+	if (MemberIndex != INDEX_NONE)
+	{
+
+		if (IsMemberActive(SharedEffect->Members[MemberIndex]))
+		{
+			return true;
+		}
+
+		// The entry was removed without the group, e.g. by a cleanse, the member gets it back below
+		SharedEffect->Members.RemoveAtSwap(MemberIndex);
+
+	}
+
+	// Immunity or application requirements can refuse the effect, only members that actually carry it join the group
+	const FActiveGameplayEffectHandle EffectHandle = MemberComponent->ApplyGameplayEffectSpecToSelf(*SharedEffect->EffectSpec.Data.Get());
+	if (!EffectHandle.IsValid())
+	{
+		return false;
+	}
+
+	// Applying runs gameplay callbacks that may have created or removed groups, so look the group up again
+	SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr)
+	{
+		MemberComponent->RemoveActiveGameplayEffect(EffectHandle);
+		return false;
+	}
+
+	FMember& NewMember = SharedEffect->Members.AddDefaulted_GetRef();
+	NewMember.AbilitySystemComponent = MemberComponent;
+	NewMember.EffectHandle = EffectHandle;
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::RemoveMember(FACM_SharedEffectHandle Handle, UAbilitySystemComponent* MemberComponent)
+{
+
+	FSharedEffect* SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr)
+	{
+		return;
+	}
+
+	for (int32 MemberIndex = SharedEffect->Members.Num() - 1; MemberIndex >= 0; MemberIndex--)
+	{
+		if (SharedEffect->Members[MemberIndex].AbilitySystemComponent.Get() == MemberComponent)
+		{
+			RemoveFromMember(SharedEffect->Members[MemberIndex]);
+			SharedEffect->Members.RemoveAtSwap(MemberIndex);
+		}
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::SetStackCount(FACM_SharedEffectHandle Handle, int32 StackCount)
+{
+
+	FSharedEffect* SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr)
+	{
+		return;
+	}
+
+	if (StackCount <= 0)
+	{
+		RemoveSharedEffect(Handle);
+		return;
+	}
+
+	SharedEffect->StackCount = StackCount;
+	RefreshMagnitudes(*SharedEffect);
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::SetMagnitude(FACM_SharedEffectHandle Handle, FGameplayTag MagnitudeTag, float MagnitudePerStack)
+{
+
+	FSharedEffect* SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr)
+	{
+		return;
+	}
+
+	SharedEffect->MagnitudesPerStack.Add(MagnitudeTag, MagnitudePerStack);
+	RefreshMagnitudes(*SharedEffect);
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::SetDuration(FACM_SharedEffectHandle Handle, float Duration)
+{
+
+	FSharedEffect* SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr)
+	{
+		return;
+	}
+
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	TimerManager.ClearTimer(SharedEffect->ExpiryTimer);
+
+	if (Duration > 0.0f)
+	{
+		TimerManager.SetTimer(SharedEffect->ExpiryTimer, FTimerDelegate::CreateUObject(this, &UACM_SharedEffectSubsystem::RemoveSharedEffect, Handle), Duration, false);
+	}
+
+}
+
+//=========================================================================================================================================================
+float UACM_SharedEffectSubsystem::GetRemainingDuration(FACM_SharedEffectHandle Handle) const
+{
+
+	const FSharedEffect* SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr)
+	{
+		return 0.0f;
+	}
+
+	return SharedEffect->ExpiryTimer.IsValid() ? GetWorld()->GetTimerManager().GetTimerRemaining(SharedEffect->ExpiryTimer) : -1.0f;
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_SharedEffectSubsystem::GetNumMembers(FACM_SharedEffectHandle Handle) const
+{
+
+	const FSharedEffect* SharedEffect = SharedEffects.Find(Handle.Id);
+	if (SharedEffect == nullptr)
+	{
+		return 0;
+	}
+
+	int32 NumMembers = 0;
+	for (const FMember& Member : SharedEffect->Members)
+	{
+		NumMembers += IsMemberActive(Member) ? 1 : 0;
+	}
+
+	return NumMembers;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_SharedEffectSubsystem::OwnsEffect(const UAbilitySystemComponent* AbilitySystemComponent, FActiveGameplayEffectHandle Handle) const
+{
+
+	for (const TPair<int32, FSharedEffect>& SharedEffectPair : SharedEffects)
+	{
+		for (const FMember& Member : SharedEffectPair.Value.Members)
+		{
+			if (Member.EffectHandle == Handle && Member.AbilitySystemComponent == AbilitySystemComponent)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::Deinitialize()
+{
+
+	// Member ASCs are being torn down with the world, nothing to remove from them
+	SharedEffects.Reset();
+
+	Super::Deinitialize();
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::RefreshMagnitudes(FSharedEffect& SharedEffect)
+{
+
+	SharedEffect.Magnitudes.Reset();
+	for (const TPair<FGameplayTag, float>& MagnitudePair : SharedEffect.MagnitudesPerStack)
+	{
+		SharedEffect.Magnitudes.Add(MagnitudePair.Key, MagnitudePair.Value * SharedEffect.StackCount);
+	}
+
+	for (const TPair<FGameplayTag, float>& MagnitudePair : SharedEffect.Magnitudes)
+	{
+		SharedEffect.EffectSpec.Data->SetSetByCallerMagnitude(MagnitudePair.Key, MagnitudePair.Value);
+	}
+
+	for (int32 MemberIndex = SharedEffect.Members.Num() - 1; MemberIndex >= 0; MemberIndex--)
+	{
+
+		const FMember& Member = SharedEffect.Members[MemberIndex];
+		if (!IsMemberActive(Member))
+		{
+			SharedEffect.Members.RemoveAtSwap(MemberIndex);
+			continue;
+		}
+
+		Member.AbilitySystemComponent->UpdateActiveGameplayEffectSetByCallerMagnitudes(Member.EffectHandle, SharedEffect.Magnitudes);
+
+	}
+
+}
+
+//=========================================================================================================================================================
+bool UACM_SharedEffectSubsystem::IsMemberActive(const FMember& Member)
+{
+
+	const UAbilitySystemComponent* MemberComponent = Member.AbilitySystemComponent.Get();
+	return IsValid(MemberComponent) && MemberComponent->GetActiveGameplayEffect(Member.EffectHandle) != nullptr;
+
+}
+
+//=========================================================================================================================================================
+void UACM_SharedEffectSubsystem::RemoveFromMember(const FMember& Member)
+{
+
+	UAbilitySystemComponent* MemberComponent = Member.AbilitySystemComponent.Get();
+	if (IsValid(MemberComponent) && Member.EffectHandle.IsValid())
+	{
+		MemberComponent->RemoveActiveGameplayEffect(Member.EffectHandle);
+	}
+
+}
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/ACM_TagBits.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+namespace ACM_TagIndex
+{
+
+	static TArray<FGameplayTag> IndexedTags;
+
+	static TMap<FGameplayTag, int32> TagToIndex;
+
+	/** GetMatchingBits results, cleared whenever a tag is indexed */
+	static TMap<FGameplayTag, FACM_TagBits> MatchingBitsCache;
+
+	static uint32 Generation = 1;
+
+}
+
+//=========================================================================================================================================================
+int32 FACM_TagIndex::FindOrAddTag(const FGameplayTag& Tag)
+{
+
+	using namespace ACM_TagIndex;
+
+	if (const int32* ExistingIndex = TagToIndex.Find(Tag))
+	{
+		return *ExistingIndex;
+	}
+
+	if (IndexedTags.Num() >= FACM_TagBits::MaxBits)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Tag index is full, %s falls back to container queries"), *Tag.ToString());
+		return INDEX_NONE;
+	}
+
+	const int32 NewIndex = IndexedTags.Add(Tag);
+	TagToIndex.Add(Tag, NewIndex);
+
+	MatchingBitsCache.Reset();
+	Generation++;
+
+	return NewIndex;
+
+}
+
+//=========================================================================================================================================================
+const FGameplayTag& FACM_TagIndex::GetTag(int32 BitIndex)
+{
+	return ACM_TagIndex::IndexedTags[BitIndex];
+}
+
+//=========================================================================================================================================================
+bool FACM_TagIndex::MakeRequirementBits(const FGameplayTagContainer& Tags, FACM_TagBits& OutBits)
+{
+
+	OutBits.Reset();
+
+	for (const FGameplayTag& Tag : Tags)
+	{
+
+		const int32 BitIndex = FindOrAddTag(Tag);
+		if (BitIndex == INDEX_NONE)
+		{
+			return false;
+		}
+
+		OutBits.SetBit(BitIndex, true);
+
+	}
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+const FACM_TagBits& FACM_TagIndex::GetMatchingBits(const FGameplayTag& Tag)
+{
+
+	using namespace ACM_TagIndex;
+
+	if (const FACM_TagBits* CachedBits = MatchingBitsCache.Find(Tag))
+	{
+		return *CachedBits;
+	}
+
+	FACM_TagBits& MatchingBits = MatchingBitsCache.Add(Tag);
+	for (int32 BitIndex = 0; BitIndex < IndexedTags.Num(); BitIndex++)
+	{
+		if (Tag.MatchesTag(IndexedTags[BitIndex]))
+		{
+			MatchingBits.SetBit(BitIndex, true);
+		}
+	}
+
+	return MatchingBits;
+
+}
+
+//=========================================================================================================================================================
+FACM_TagBits FACM_TagIndex::MakeOwnedBits(const FGameplayTagContainer& OwnedTags)
+{
+
+	FACM_TagBits OwnedBits;
+	for (const FGameplayTag& Tag : OwnedTags)
+	{
+		OwnedBits |= GetMatchingBits(Tag);
+	}
+
+	return OwnedBits;
+
+}
+
+//=========================================================================================================================================================
+uint32 FACM_TagIndex::GetGeneration()
+{
+	return ACM_TagIndex::Generation;
+}
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/Tasks/ACM_AbilityTask.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+#include "UObject/UnrealType.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ability Tasks Created"), STAT_ACM_AbilityTasksCreated, STATGROUP_ArkdeCM);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ability Tasks Reused"), STAT_ACM_AbilityTasksReused, STATGROUP_ArkdeCM);
+
+namespace ACM_AbilityTask
+{
+
+	static uint64 NumCreated = 0;
+	static uint64 NumReused = 0;
+	static double CountStartSeconds = FPlatformTime::Seconds();
+
+	/** Pooled tasks in use. Time with at least one counts as combat, the rates below are per minute of it */
+	static int32 NumLiveTasks = 0;
+	static double CombatStartSeconds = 0.0;
+	static double CombatSeconds = 0.0;
+
+	static double GetCombatSeconds()
+	{
+		return CombatSeconds + (NumLiveTasks > 0 ? FPlatformTime::Seconds() - CombatStartSeconds : 0.0);
+	}
+
+}
+
+//=========================================================================================================================================================
+UACM_AbilityTask* UACM_AbilityTask::AcquireTask(UClass* TaskClass, UGameplayAbility* ThisAbility, FName InstanceName)
+{
+
+	check(ThisAbility);
+
+	UACM_AbilitySystemComponent* AbilitySystemComponent = Cast<UACM_AbilitySystemComponent>(ThisAbility->GetAbilitySystemComponentFromActorInfo());
+
+	UACM_AbilityTask* Task = IsValid(AbilitySystemComponent) ? AbilitySystemComponent->TakePooledAbilityTask(TaskClass) : nullptr;
+	if (Task != nullptr)
+	{
+		ACM_AbilityTask::NumReused++;
+		INC_DWORD_STAT(STAT_ACM_AbilityTasksReused);
+	}
+	else
+	{
+		Task = NewObject<UACM_AbilityTask>(GetTransientPackage(), TaskClass);
+		ACM_AbilityTask::NumCreated++;
+		INC_DWORD_STAT(STAT_ACM_AbilityTasksCreated);
+	}
+
+	if (ACM_AbilityTask::NumLiveTasks++ == 0)
+	{
+		ACM_AbilityTask::CombatStartSeconds = FPlatformTime::Seconds();
+	}
+
+	Task->InitTask(*ThisAbility, ThisAbility->GetGameplayTaskDefaultPriority());
+	Task->InstanceName = InstanceName;
+	Task->PoolOwner = AbilitySystemComponent;
+
+	return Task;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask::OnDestroy(bool bInOwnerFinished)
+{
+
+	UACM_AbilitySystemComponent* Pool = PoolOwner.Get();
+	PoolOwner.Reset();
+
+	// Callbacks and TACM_PooledTaskPtr of this use see from here on that it ended
+	PoolGeneration++;
+
+	if (--ACM_AbilityTask::NumLiveTasks == 0)
+	{
+		ACM_AbilityTask::CombatSeconds += FPlatformTime::Seconds() - ACM_AbilityTask::CombatStartSeconds;
+	}
+
+#if DO_CHECK
+	// Overrides have unbound by now, and the targets of their bindings are still known
+	if (IsValid(Pool) && !ensureMsgf(!HasTargetBindings(), TEXT("%s is still bound to another object when it ends, it is not pooled"), *GetClass()->GetName()))
+	{
+		Pool = nullptr;
+	}
+#endif
+
+	Super::OnDestroy(bInOwnerFinished);
+
+	if (!IsValid(Pool))
+	{
+		return;
+	}
+
+	ResetForReuse();
+
+#if DO_CHECK
+	if (!ensureMsgf(!HasBoundDelegates(), TEXT("%s still has delegate bindings after ResetForReuse, it is not pooled"), *GetClass()->GetName()))
+	{
+		return;
+	}
+#endif
+
+	// UGameplayTask::OnDestroy marks the task for destruction, the pool takes it back instead
+	ReleasedFrame = GFrameCounter;
+	if (Pool->ReturnPooledAbilityTask(this))
+	{
+		ClearPendingKill();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask::ResetForReuse()
+{
+
+	UWorld* World = GetWorld();
+	if (World != nullptr)
+	{
+		World->GetTimerManager().ClearAllTimersForObject(this);
+	}
+
+	// UAbilityTask and UGameplayTask state that InitTask does not set again, e.g. the wait state of SetWaitingOnRemotePlayerData
+	const UACM_AbilityTask* Defaults = GetClass()->GetDefaultObject<UACM_AbilityTask>();
+	WaitStateBitMask = Defaults->WaitStateBitMask;
+	bOwnerFinished = Defaults->bOwnerFinished;
+	bTickingTask = Defaults->bTickingTask;
+	bIsPausable = Defaults->bIsPausable;
+	ChildTask = nullptr;
+
+	InstanceName = NAME_None;
+	Ability = nullptr;
+	AbilitySystemComponent = nullptr;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilityTask::HasTargetBindings() const
+{
+	return false;
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilityTask::HasBoundDelegates() const
+{
+
+	for (TFieldIterator<FMulticastDelegateProperty> PropertyIterator(GetClass()); PropertyIterator; ++PropertyIterator)
+	{
+		const FMulticastScriptDelegate* Delegate = PropertyIterator->GetMulticastDelegate(PropertyIterator->ContainerPtrToValuePtr<void>(this));
+		if (Delegate != nullptr && Delegate->IsBound())
+		{
+			return true;
+		}
+	}
+
+	return false;
+
+}
+
+//=========================================================================================================================================================
+static void LogAbilityTaskStats(const TArray<FString>& Args, UWorld* World)
+{
+
+	using namespace ACM_AbilityTask;
+
+	const double Minutes = FMath::Max((FPlatformTime::Seconds() - CountStartSeconds) / 60.0, 1.0 / 60.0);
+	const double CombatMinutes = FMath::Max(GetCombatSeconds() / 60.0, 1.0 / 60.0);
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Ability tasks: %llu created, %llu reused over %.1f min, %.1f created per minute"),
+		NumCreated, NumReused, Minutes, NumCreated / Minutes);
+
+	// Without the pool every acquired task would have been a new object
+	UE_LOG(LogArkdeCM, Display, TEXT("Per minute of combat (%.1f min with tasks running): %.1f objects created, %.1f without pooling"),
+		CombatMinutes, NumCreated / CombatMinutes, (NumCreated + NumReused) / CombatMinutes);
+
+	if (Args.Contains(TEXT("reset")))
+	{
+		NumCreated = 0;
+		NumReused = 0;
+		CountStartSeconds = FPlatformTime::Seconds();
+		CombatSeconds = 0.0;
+		CombatStartSeconds = FPlatformTime::Seconds();
+	}
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarLogAbilityTaskStats(
+	TEXT("ACM.AbilityTasks.Stats"),
+	TEXT("Logs pooled ability tasks created and reused since the last reset, and objects created per minute of combat with and without pooling. Args: [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LogAbilityTaskStats));
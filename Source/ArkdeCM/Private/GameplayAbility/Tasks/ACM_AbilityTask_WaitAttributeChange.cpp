@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/Tasks/ACM_AbilityTask_WaitAttributeChange.h"
+#include "AbilitySystemComponent.h"
+
+//=========================================================================================================================================================
+UACM_AbilityTask_WaitAttributeChange* UACM_AbilityTask_WaitAttributeChange::WaitAttributeChange(UGameplayAbility* OwningAbility, FGameplayAttribute Attribute, bool bTriggerOnce)
+{
+
+	UACM_AbilityTask_WaitAttributeChange* Task = NewPooledAbilityTask<UACM_AbilityTask_WaitAttributeChange>(OwningAbility);
+	Task->Attribute = Attribute;
+	Task->bTriggerOnce = bTriggerOnce;
+
+	return Task;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeChange::Activate()
+{
+
+	if (AbilitySystemComponent != nullptr && Attribute.IsValid())
+	{
+		OnAttributeChangeDelegateHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(Attribute).AddUObject(this, &UACM_AbilityTask_WaitAttributeChange::OnAttributeChange, PoolGeneration);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeChange::OnDestroy(bool bInOwnerFinished)
+{
+
+	if (AbilitySystemComponent != nullptr && OnAttributeChangeDelegateHandle.IsValid())
+	{
+		AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(Attribute).Remove(OnAttributeChangeDelegateHandle);
+	}
+
+	OnAttributeChangeDelegateHandle.Reset();
+
+	Super::OnDestroy(bInOwnerFinished);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeChange::ResetForReuse()
+{
+
+	OnChange.Clear();
+	Attribute = FGameplayAttribute();
+	bTriggerOnce = true;
+	OnAttributeChangeDelegateHandle.Reset();
+
+	Super::ResetForReuse();
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilityTask_WaitAttributeChange::HasTargetBindings() const
+{
+
+	if (AbilitySystemComponent != nullptr && Attribute.IsValid() && AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(Attribute).IsBoundToObject(this))
+	{
+		return true;
+	}
+
+	return Super::HasTargetBindings();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeChange::OnAttributeChange(const FOnAttributeChangeData& CallbackData, uint32 Generation)
+{
+
+	if (!IsCurrentUse(Generation))
+	{
+		return;
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		OnChange.Broadcast(CallbackData.NewValue, CallbackData.OldValue);
+	}
+
+	if (bTriggerOnce)
+	{
+		EndTask();
+	}
+
+}
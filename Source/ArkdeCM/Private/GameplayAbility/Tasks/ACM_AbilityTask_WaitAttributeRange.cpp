@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/Tasks/ACM_AbilityTask_WaitAttributeRange.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "AbilitySystemComponent.h"
+
+//=========================================================================================================================================================
+UACM_AbilityTask_WaitAttributeRange* UACM_AbilityTask_WaitAttributeRange::WaitAttributeRange(UGameplayAbility* OwningAbility, FGameplayAttribute Attribute, float MinValue, float MaxValue, bool bTriggerOnce, bool bOnlyTriggerOnEnter, bool bUseRegenForecast)
+{
+
+	UACM_AbilityTask_WaitAttributeRange* Task = NewPooledAbilityTask<UACM_AbilityTask_WaitAttributeRange>(OwningAbility);
+	Task->Attribute = Attribute;
+	Task->MinValue = MinValue;
+	Task->MaxValue = MaxValue;
+	Task->bTriggerOnce = bTriggerOnce;
+	Task->bOnlyTriggerOnEnter = bOnlyTriggerOnEnter;
+	Task->bUseRegenForecast = bUseRegenForecast;
+
+	return Task;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeRange::Activate()
+{
+
+	UACM_AttributeSet* AttributeSet = FindAttributeSet();
+	if (AttributeSet == nullptr)
+	{
+		EndTask();
+		return;
+	}
+
+	FSimpleDelegate OnRegenChanged = bUseRegenForecast ? FSimpleDelegate::CreateUObject(this, &UACM_AbilityTask_WaitAttributeRange::BroadcastForecast, PoolGeneration) : FSimpleDelegate();
+
+	WatchedSet = AttributeSet;
+	WatchId = AttributeSet->AddRangeWatch(Attribute, MinValue, MaxValue, UACM_AttributeSet::FOnRangeEntered::CreateUObject(this, &UACM_AbilityTask_WaitAttributeRange::HandleRangeEntered, PoolGeneration), OnRegenChanged);
+
+	if (AttributeSet->IsRangeWatchInside(WatchId))
+	{
+
+		if (!bOnlyTriggerOnEnter)
+		{
+			HandleRangeEntered(Attribute.GetNumericValue(AttributeSet), PoolGeneration);
+		}
+
+		return;
+
+	}
+
+	if (bUseRegenForecast)
+	{
+		BroadcastForecast(PoolGeneration);
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeRange::OnDestroy(bool bInOwnerFinished)
+{
+
+	UACM_AttributeSet* AttributeSet = WatchedSet.Get();
+	if (AttributeSet != nullptr && WatchId != 0)
+	{
+		AttributeSet->RemoveRangeWatch(WatchId);
+	}
+
+	WatchId = 0;
+
+	Super::OnDestroy(bInOwnerFinished);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeRange::ResetForReuse()
+{
+
+	OnEntered.Clear();
+	OnForecast.Clear();
+	Attribute = FGameplayAttribute();
+	MinValue = 0.0f;
+	MaxValue = 0.0f;
+	bTriggerOnce = true;
+	bOnlyTriggerOnEnter = false;
+	bUseRegenForecast = true;
+	WatchedSet.Reset();
+
+	Super::ResetForReuse();
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilityTask_WaitAttributeRange::HasTargetBindings() const
+{
+
+	const UACM_AttributeSet* AttributeSet = WatchedSet.Get();
+	if (AttributeSet != nullptr && AttributeSet->HasRangeWatchBoundTo(this))
+	{
+		return true;
+	}
+
+	return Super::HasTargetBindings();
+
+}
+
+//=========================================================================================================================================================
+UACM_AttributeSet* UACM_AbilityTask_WaitAttributeRange::FindAttributeSet() const
+{
+
+	if (AbilitySystemComponent == nullptr || !Attribute.IsValid())
+	{
+		return nullptr;
+	}
+
+	for (UAttributeSet* Set : AbilitySystemComponent->GetSpawnedAttributes_Mutable())
+	{
+		UACM_AttributeSet* AttributeSet = Cast<UACM_AttributeSet>(Set);
+		if (AttributeSet != nullptr && AttributeSet->IsA(Attribute.GetAttributeSetClass()))
+		{
+			return AttributeSet;
+		}
+	}
+
+	return nullptr;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeRange::HandleRangeEntered(float Value, uint32 Generation)
+{
+
+	if (!IsCurrentUse(Generation))
+	{
+		return;
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		OnEntered.Broadcast(Value);
+	}
+
+	if (bTriggerOnce)
+	{
+		EndTask();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitAttributeRange::BroadcastForecast(uint32 Generation)
+{
+
+	// Regen only moves values up, a value above the range has nothing to forecast
+	const UACM_AttributeSet* AttributeSet = WatchedSet.Get();
+	if (!IsCurrentUse(Generation) || AttributeSet == nullptr || AttributeSet->IsRangeWatchInside(WatchId) || Attribute.GetNumericValue(AttributeSet) > MaxValue)
+	{
+		return;
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		OnForecast.Broadcast(AttributeSet->ForecastSecondsToReach(Attribute, MinValue));
+	}
+
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/Tasks/ACM_AbilityTask_WaitDelay.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+//=========================================================================================================================================================
+UACM_AbilityTask_WaitDelay* UACM_AbilityTask_WaitDelay::WaitDelay(UGameplayAbility* OwningAbility, float Time)
+{
+
+	UACM_AbilityTask_WaitDelay* Task = NewPooledAbilityTask<UACM_AbilityTask_WaitDelay>(OwningAbility);
+	Task->Time = Time;
+
+	return Task;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitDelay::Activate()
+{
+
+	UWorld* World = GetWorld();
+	TimeStarted = World->GetTimeSeconds();
+
+	// Bound to the task object so the pool reset clears it with the other timers of the task
+	FTimerHandle TimerHandle;
+	World->GetTimerManager().SetTimer(TimerHandle, FTimerDelegate::CreateUObject(this, &UACM_AbilityTask_WaitDelay::OnTimeFinish, PoolGeneration), Time, false);
+
+}
+
+//=========================================================================================================================================================
+FString UACM_AbilityTask_WaitDelay::GetDebugString() const
+{
+
+	const float TimeLeft = Time - (GetWorld()->GetTimeSeconds() - TimeStarted);
+	return FString::Printf(TEXT("WaitDelay (Pooled). Time: %.2f. TimeLeft: %.2f"), Time, TimeLeft);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitDelay::ResetForReuse()
+{
+
+	OnFinish.Clear();
+	Time = 0.0f;
+	TimeStarted = 0.0f;
+
+	Super::ResetForReuse();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitDelay::OnTimeFinish(uint32 Generation)
+{
+
+	if (!IsCurrentUse(Generation))
+	{
+		return;
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		OnFinish.Broadcast();
+	}
+
+	EndTask();
+
+}
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayAbility/Tasks/ACM_AbilityTask_WaitInputRelease.h"
+#include "AbilitySystemComponent.h"
+#include "Engine/World.h"
+
+//=========================================================================================================================================================
+UACM_AbilityTask_WaitInputRelease* UACM_AbilityTask_WaitInputRelease::WaitInputRelease(UGameplayAbility* OwningAbility, bool bTestAlreadyReleased)
+{
+
+	UACM_AbilityTask_WaitInputRelease* Task = NewPooledAbilityTask<UACM_AbilityTask_WaitInputRelease>(OwningAbility);
+	Task->bTestInitialState = bTestAlreadyReleased;
+
+	return Task;
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitInputRelease::Activate()
+{
+
+	StartTime = GetWorld()->GetTimeSeconds();
+
+	if (Ability == nullptr || AbilitySystemComponent == nullptr)
+	{
+		return;
+	}
+
+	if (bTestInitialState && IsLocallyControlled())
+	{
+		const FGameplayAbilitySpec* Spec = Ability->GetCurrentAbilitySpec();
+		if (Spec != nullptr && !Spec->InputPressed)
+		{
+			OnReleaseCallback(PoolGeneration);
+			return;
+		}
+	}
+
+	DelegateHandle = AbilitySystemComponent->AbilityReplicatedEventDelegate(EAbilityGenericReplicatedEvent::InputReleased, GetAbilitySpecHandle(), GetActivationPredictionKey()).AddUObject(this, &UACM_AbilityTask_WaitInputRelease::OnReleaseCallback, PoolGeneration);
+
+	if (IsForRemoteClient() && !AbilitySystemComponent->CallReplicatedEventDelegateIfSet(EAbilityGenericReplicatedEvent::InputReleased, GetAbilitySpecHandle(), GetActivationPredictionKey()))
+	{
+		SetWaitingOnRemotePlayerData();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitInputRelease::OnDestroy(bool bInOwnerFinished)
+{
+
+	RemoveReleaseBinding();
+
+	Super::OnDestroy(bInOwnerFinished);
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitInputRelease::ResetForReuse()
+{
+
+	OnRelease.Clear();
+	StartTime = 0.0f;
+	bTestInitialState = false;
+	DelegateHandle.Reset();
+
+	Super::ResetForReuse();
+
+}
+
+//=========================================================================================================================================================
+bool UACM_AbilityTask_WaitInputRelease::HasTargetBindings() const
+{
+
+	if (Ability != nullptr && AbilitySystemComponent != nullptr && AbilitySystemComponent->AbilityReplicatedEventDelegate(EAbilityGenericReplicatedEvent::InputReleased, GetAbilitySpecHandle(), GetActivationPredictionKey()).IsBoundToObject(this))
+	{
+		return true;
+	}
+
+	return Super::HasTargetBindings();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitInputRelease::OnReleaseCallback(uint32 Generation)
+{
+
+	if (!IsCurrentUse(Generation) || Ability == nullptr || AbilitySystemComponent == nullptr)
+	{
+		return;
+	}
+
+	const float ElapsedTime = GetWorld()->GetTimeSeconds() - StartTime;
+
+	RemoveReleaseBinding();
+
+	FScopedPredictionWindow ScopedPrediction(AbilitySystemComponent, IsPredictingClient());
+
+	if (IsPredictingClient())
+	{
+		AbilitySystemComponent->ServerSetReplicatedEvent(EAbilityGenericReplicatedEvent::InputReleased, GetAbilitySpecHandle(), GetActivationPredictionKey(), AbilitySystemComponent->ScopedPredictionKey);
+	}
+	else
+	{
+		AbilitySystemComponent->ConsumeGenericReplicatedEvent(EAbilityGenericReplicatedEvent::InputReleased, GetAbilitySpecHandle(), GetActivationPredictionKey());
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		OnRelease.Broadcast(ElapsedTime);
+	}
+
+	EndTask();
+
+}
+
+//=========================================================================================================================================================
+void UACM_AbilityTask_WaitInputRelease::RemoveReleaseBinding()
+{
+
+	if (DelegateHandle.IsValid() && AbilitySystemComponent != nullptr)
+	{
+		AbilitySystemComponent->AbilityReplicatedEventDelegate(EAbilityGenericReplicatedEvent::InputReleased, GetAbilitySpecHandle(), GetActivationPredictionKey()).Remove(DelegateHandle);
+	}
+
+	DelegateHandle.Reset();
+
+}
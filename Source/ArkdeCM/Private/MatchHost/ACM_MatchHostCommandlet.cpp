@@ -0,0 +1,391 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MatchHost/ACM_MatchHostCommandlet.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/Paths.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+//=========================================================================================================================================================
+UACM_MatchHostCommandlet::UACM_MatchHostCommandlet()
+{
+
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+	bLaunchThroughEditor = false;
+	DefaultMap = TEXT("/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap");
+	CoresPerServer = 1;
+	MaxFrameMs = 40.0f;
+	HeartbeatTimeout = 15.0f;
+	StartupTimeout = 120.0f;
+	AssignmentTimeout = 30.0f;
+	MaxLaunchBackoff = 60.0f;
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_MatchHostCommandlet::Main(const FString& Params)
+{
+
+	int32 NumServers = 4;
+	int32 BasePort = 7777;
+	int32 FirstCore = 0;
+	float Duration = 0.0f;
+
+	FParse::Value(*Params, TEXT("Servers="), NumServers);
+	FParse::Value(*Params, TEXT("BasePort="), BasePort);
+	FParse::Value(*Params, TEXT("FirstCore="), FirstCore);
+	FParse::Value(*Params, TEXT("CoresPerServer="), CoresPerServer);
+	FParse::Value(*Params, TEXT("MaxFrameMs="), MaxFrameMs);
+	FParse::Value(*Params, TEXT("Duration="), Duration);
+	FParse::Value(*Params, TEXT("Map="), DefaultMap);
+
+	bLaunchThroughEditor = !FParse::Value(*Params, TEXT("ServerExe="), ServerExecutable);
+	if (bLaunchThroughEditor)
+	{
+		ServerExecutable = FPlatformProcess::ExecutablePath();
+	}
+
+	CoresPerServer = FMath::Max(CoresPerServer, 1);
+
+	IFileManager::Get().MakeDirectory(*ACM_MatchHost::GetInboxDirectory(), true);
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(ACM_MatchHost::GetStatusFilename(BasePort)), true);
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Match host: %d servers from port %d, control directory %s"), NumServers, BasePort, *ACM_MatchHost::GetControlDirectory());
+
+	Servers.SetNum(FMath::Max(NumServers, 1));
+	for (int32 ServerIndex = 0; ServerIndex < Servers.Num(); ServerIndex++)
+	{
+		Servers[ServerIndex].Port = BasePort + ServerIndex;
+		Servers[ServerIndex].FirstCore = FirstCore + ServerIndex * CoresPerServer;
+		LaunchServer(Servers[ServerIndex]);
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	while (!IsEngineExitRequested() && (Duration <= 0.0f || FPlatformTime::Seconds() - StartTime < Duration))
+	{
+
+		for (FManagedServer& Server : Servers)
+		{
+
+			if (Server.bAwaitingLaunch)
+			{
+				if (FPlatformTime::Seconds() >= Server.NextLaunchTime)
+				{
+					Server.bAwaitingLaunch = false;
+					LaunchServer(Server);
+				}
+
+				continue;
+			}
+
+			RefreshServer(Server);
+			CheckPendingMatch(Server);
+
+			if (NeedsRecycle(Server))
+			{
+				RecycleServer(Server);
+			}
+
+		}
+
+		DispatchMatches();
+
+		FPlatformProcess::Sleep(0.25f);
+
+	}
+
+	for (FManagedServer& Server : Servers)
+	{
+		StopServer(Server);
+	}
+
+	return 0;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_MatchHostCommandlet::LaunchServer(FManagedServer& Server)
+{
+
+	IFileManager::Get().Delete(*ACM_MatchHost::GetStatusFilename(Server.Port), false, true, true);
+	IFileManager::Get().Delete(*ACM_MatchHost::GetAssignmentFilename(Server.Port), false, true, true);
+
+	FString Arguments = FString::Printf(TEXT("%s -server -log -unattended -ACMPrewarm -Port=%d -ACMHostDir=\"%s\""), *DefaultMap, Server.Port, *ACM_MatchHost::GetControlDirectory());
+	if (bLaunchThroughEditor)
+	{
+		Arguments = FString::Printf(TEXT("\"%s\" %s"), *FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()), *Arguments);
+	}
+
+	FString Executable = ServerExecutable;
+
+#if PLATFORM_LINUX
+	// taskset execs the server in place, so the pid we get back is the server's own
+	const FString TasksetPath = TEXT("/usr/bin/taskset");
+	if (FPaths::FileExists(TasksetPath))
+	{
+		const int32 NumCores = FMath::Max(FPlatformMisc::NumberOfCoresIncludingHyperthreads(), 1);
+		const int32 FirstCore = Server.FirstCore % NumCores;
+		const int32 LastCore = FMath::Min(FirstCore + CoresPerServer - 1, NumCores - 1);
+
+		Arguments = FString::Printf(TEXT("-c %d-%d \"%s\" %s"), FirstCore, LastCore, *Executable, *Arguments);
+		Executable = TasksetPath;
+	}
+	else
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("taskset not found, server on port %d will not be pinned"), Server.Port);
+	}
+#endif
+
+	Server.ProcessHandle = FPlatformProcess::CreateProc(*Executable, *Arguments, true, true, true, &Server.ProcessId, 0, nullptr, nullptr);
+	Server.LaunchTime = FPlatformTime::Seconds();
+	Server.bHasStatus = false;
+	Server.Status = FACM_ServerStatus();
+	Server.PendingMatchId.Empty();
+	Server.PendingSince = 0.0;
+	Server.bAssignmentTimedOut = false;
+
+	if (!Server.ProcessHandle.IsValid())
+	{
+		UE_LOG(LogArkdeCM, Error, TEXT("Failed to launch server on port %d: %s %s"), Server.Port, *Executable, *Arguments);
+		return false;
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Launched server on port %d (pid %u)"), Server.Port, Server.ProcessId);
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostCommandlet::StopServer(FManagedServer& Server)
+{
+
+	if (!Server.ProcessHandle.IsValid())
+	{
+		return;
+	}
+
+	if (FPlatformProcess::IsProcRunning(Server.ProcessHandle))
+	{
+		FPlatformProcess::TerminateProc(Server.ProcessHandle, true);
+	}
+
+	FPlatformProcess::CloseProc(Server.ProcessHandle);
+	Server.ProcessHandle.Reset();
+	Server.ProcessId = 0;
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostCommandlet::RefreshServer(FManagedServer& Server)
+{
+
+	FACM_ServerStatus Status;
+
+	// Reports left behind by a previous process on the same port are ignored
+	if (!Status.FromJson(ACM_MatchHost::ReadJsonFile(ACM_MatchHost::GetStatusFilename(Server.Port))) || Status.ProcessId != Server.ProcessId)
+	{
+		return;
+	}
+
+	Server.bHasStatus = true;
+	Server.Status = Status;
+	Server.FailedLaunches = 0;
+
+	if (!Server.PendingMatchId.IsEmpty() && Status.MatchId == Server.PendingMatchId)
+	{
+		Server.PendingMatchId.Empty();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostCommandlet::CheckPendingMatch(FManagedServer& Server)
+{
+
+	if (Server.PendingMatchId.IsEmpty() || FPlatformTime::Seconds() - Server.PendingSince <= AssignmentTimeout)
+	{
+		return;
+	}
+
+	UE_LOG(LogArkdeCM, Warning, TEXT("Server on port %d did not start match %s within %.0fs, recycling it"), Server.Port, *Server.PendingMatchId, AssignmentTimeout);
+	Server.bAssignmentTimedOut = true;
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostCommandlet::RequeuePendingMatch(FManagedServer& Server)
+{
+
+	if (Server.PendingMatchId.IsEmpty())
+	{
+		return;
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Requeueing match %s from port %d"), *Server.PendingMatchId, Server.Port);
+
+	// The relaunched server must not pick up the stale assignment, and the request goes back under its original name so it keeps its place in arrival order
+	IFileManager::Get().Delete(*ACM_MatchHost::GetAssignmentFilename(Server.Port));
+	ACM_MatchHost::WriteJsonFile(ACM_MatchHost::GetInboxDirectory() / Server.PendingRequestFile, Server.PendingRequest.ToJson());
+
+	Server.PendingMatchId.Empty();
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostCommandlet::RecycleServer(FManagedServer& Server)
+{
+
+	// A launch that never got to its first report counts as failed, whether CreateProc failed or the process died early
+	if (!Server.bHasStatus)
+	{
+		Server.FailedLaunches++;
+	}
+
+	StopServer(Server);
+	RequeuePendingMatch(Server);
+
+	if (Server.FailedLaunches > 0)
+	{
+		const float Backoff = FMath::Min(FMath::Pow(2.0f, static_cast<float>(Server.FailedLaunches - 1)), MaxLaunchBackoff);
+		Server.NextLaunchTime = FPlatformTime::Seconds() + Backoff;
+		Server.bAwaitingLaunch = true;
+		UE_LOG(LogArkdeCM, Warning, TEXT("Server on port %d failed %d launches in a row, next launch in %.0fs"), Server.Port, Server.FailedLaunches, Backoff);
+		return;
+	}
+
+	LaunchServer(Server);
+
+}
+
+//=========================================================================================================================================================
+bool UACM_MatchHostCommandlet::NeedsRecycle(FManagedServer& Server) const
+{
+
+	if (!Server.ProcessHandle.IsValid() || !FPlatformProcess::IsProcRunning(Server.ProcessHandle))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Server on port %d exited, relaunching"), Server.Port);
+		return true;
+	}
+
+	if (Server.bAssignmentTimedOut)
+	{
+		return true;
+	}
+
+	if (!Server.bHasStatus)
+	{
+		return FPlatformTime::Seconds() - Server.LaunchTime > StartupTimeout;
+	}
+
+	if (Server.Status.State == EACM_ServerState::Finished)
+	{
+		UE_LOG(LogArkdeCM, Display, TEXT("Server on port %d finished match %s, recycling"), Server.Port, *Server.Status.MatchId);
+		return true;
+	}
+
+	if ((FDateTime::UtcNow() - Server.Status.Timestamp).GetTotalSeconds() > HeartbeatTimeout)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Server on port %d stopped reporting, recycling"), Server.Port);
+		return true;
+	}
+
+	return false;
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostCommandlet::DispatchMatches()
+{
+
+	const FString InboxDirectory = ACM_MatchHost::GetInboxDirectory();
+
+	TArray<FString> RequestFiles;
+	IFileManager::Get().FindFiles(RequestFiles, *(InboxDirectory / TEXT("*.json")), true, false);
+
+	// The matchmaker names requests so that name order is arrival order
+	RequestFiles.Sort();
+
+	for (const FString& RequestFile : RequestFiles)
+	{
+
+		const FString RequestPath = InboxDirectory / RequestFile;
+
+		FACM_MatchRequest Request;
+		if (!Request.FromJson(ACM_MatchHost::ReadJsonFile(RequestPath)))
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("Dropping malformed match request %s"), *RequestPath);
+			IFileManager::Get().Delete(*RequestPath);
+			continue;
+		}
+
+		FManagedServer* Server = FindServerForMatch();
+		if (Server == nullptr)
+		{
+			return;
+		}
+
+		if (!ACM_MatchHost::WriteJsonFile(ACM_MatchHost::GetAssignmentFilename(Server->Port), Request.ToJson()))
+		{
+			return;
+		}
+
+		UE_LOG(LogArkdeCM, Display, TEXT("Placed match %s on port %d (%.1fms frame, %d players)"), *Request.MatchId, Server->Port, Server->Status.AverageFrameMs, Server->Status.NumPlayers);
+
+		Server->PendingMatchId = Request.MatchId;
+		Server->PendingRequest = Request;
+		Server->PendingRequestFile = RequestFile;
+		Server->PendingSince = FPlatformTime::Seconds();
+		IFileManager::Get().Delete(*RequestPath);
+
+	}
+
+}
+
+//=========================================================================================================================================================
+UACM_MatchHostCommandlet::FManagedServer* UACM_MatchHostCommandlet::FindServerForMatch()
+{
+
+	FManagedServer* BestServer = nullptr;
+	float BestScore = TNumericLimits<float>::Max();
+
+	for (FManagedServer& Server : Servers)
+	{
+
+		if (!Server.bHasStatus || Server.Status.State != EACM_ServerState::Idle || !Server.PendingMatchId.IsEmpty())
+		{
+			continue;
+		}
+
+		if (Server.Status.AverageFrameMs > MaxFrameMs)
+		{
+			continue;
+		}
+
+		const float Score = ScoreServer(Server);
+		if (Score < BestScore)
+		{
+			BestScore = Score;
+			BestServer = &Server;
+		}
+
+	}
+
+	return BestServer;
+
+}
+
+//=========================================================================================================================================================
+float UACM_MatchHostCommandlet::ScoreServer(const FManagedServer& Server) const
+{
+
+	// Frame time reflects contention on the server's cores, players reflect work it is still winding down
+	const float PlayerWeightMs = 5.0f;
+	return Server.Status.AverageFrameMs + Server.Status.NumPlayers * PlayerWeightMs;
+
+}
@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MatchHost/ACM_MatchHostSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/CommandLine.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "ArkdeCM/ArkdeCMGameMode.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+//=========================================================================================================================================================
+UACM_MatchHostSubsystem::UACM_MatchHostSubsystem()
+{
+
+	ReportInterval = 1.0f;
+	MatchJoinTimeout = 120.0f;
+	Port = 0;
+	State = EACM_ServerState::Starting;
+	MatchesServed = 0;
+	bMatchHadPlayers = false;
+	TimeInMatch = 0.0f;
+	TimeSinceReport = 0.0f;
+	FrameTimeAccumulator = 0.0f;
+	FrameCount = 0;
+	AverageFrameMs = 0.0f;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_MatchHostSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+
+	FString ControlDirectory;
+	return IsRunningDedicatedServer() && FParse::Value(FCommandLine::Get(), TEXT("ACMHostDir="), ControlDirectory);
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+
+	if (!FParse::Value(FCommandLine::Get(), TEXT("Port="), Port))
+	{
+		Port = 7777;
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(ACM_MatchHost::GetStatusFilename(Port)), true);
+
+	TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UACM_MatchHostSubsystem::HandleTick));
+
+	UE_LOG(LogArkdeCM, Log, TEXT("Match host reporting enabled on port %d (%s)"), Port, *ACM_MatchHost::GetControlDirectory());
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostSubsystem::Deinitialize()
+{
+
+	FTicker::GetCoreTicker().RemoveTicker(TickHandle);
+
+	State = EACM_ServerState::Finished;
+	WriteStatus(0);
+
+	Super::Deinitialize();
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostSubsystem::FinishMatch()
+{
+
+	if (State != EACM_ServerState::InMatch)
+	{
+		return;
+	}
+
+	UE_LOG(LogArkdeCM, Log, TEXT("Match %s finished after %.1fs"), *MatchId, TimeInMatch);
+
+	State = EACM_ServerState::Finished;
+	WriteStatus(GetNumPlayers());
+
+}
+
+//=========================================================================================================================================================
+bool UACM_MatchHostSubsystem::HandleTick(float DeltaTime)
+{
+
+	FrameTimeAccumulator += DeltaTime;
+	FrameCount++;
+	TimeSinceReport += DeltaTime;
+
+	if (State == EACM_ServerState::InMatch)
+	{
+		TimeInMatch += DeltaTime;
+	}
+
+	if (TimeSinceReport < ReportInterval)
+	{
+		return true;
+	}
+
+	AverageFrameMs = FrameCount > 0 ? (FrameTimeAccumulator / FrameCount) * 1000.0f : 0.0f;
+	FrameTimeAccumulator = 0.0f;
+	FrameCount = 0;
+	TimeSinceReport = 0.0f;
+
+	const int32 NumPlayers = GetNumPlayers();
+
+	if (State == EACM_ServerState::Starting && IsValid(GetGameInstance()->GetWorld()))
+	{
+		State = EACM_ServerState::Idle;
+	}
+
+	if (State == EACM_ServerState::Idle)
+	{
+		PollAssignment();
+	}
+	else if (State == EACM_ServerState::InMatch)
+	{
+		UpdateMatchState(NumPlayers);
+	}
+
+	WriteStatus(NumPlayers);
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostSubsystem::PollAssignment()
+{
+
+	const FString AssignmentFilename = ACM_MatchHost::GetAssignmentFilename(Port);
+	if (!IFileManager::Get().FileExists(*AssignmentFilename))
+	{
+		return;
+	}
+
+	// The host wrote the file when it placed the match, so its age moves the start of the match back to that moment
+	const double FileAgeSeconds = (FDateTime::UtcNow() - IFileManager::Get().GetTimeStamp(*AssignmentFilename)).GetTotalSeconds();
+	const double AssignedSeconds = FPlatformTime::Seconds() - FMath::Max(FileAgeSeconds, 0.0);
+
+	FACM_MatchRequest Request;
+	const bool bValidRequest = Request.FromJson(ACM_MatchHost::ReadJsonFile(AssignmentFilename));
+
+	IFileManager::Get().Delete(*AssignmentFilename);
+
+	if (!bValidRequest)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Ignoring malformed match assignment %s"), *AssignmentFilename);
+		return;
+	}
+
+	StartMatch(Request, AssignedSeconds);
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostSubsystem::StartMatch(const FACM_MatchRequest& Request, double AssignedSeconds)
+{
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (!IsValid(World))
+	{
+		return;
+	}
+
+	UE_LOG(LogArkdeCM, Log, TEXT("Starting match %s on %s"), *Request.MatchId, *Request.MapName);
+
+	MatchId = Request.MatchId;
+	MatchesServed++;
+	bMatchHadPlayers = false;
+	TimeInMatch = 0.0f;
+	State = EACM_ServerState::InMatch;
+
+	// A pre-warmed server already sits on the map with everything loaded, it only needs to open up
+	AArkdeCMGameMode* GameMode = World->GetAuthGameMode<AArkdeCMGameMode>();
+	if (IsValid(GameMode) && GameMode->IsAwaitingMatchAssignment() && World->GetMapName() == FPackageName::GetShortName(Request.MapName))
+	{
+		GameMode->StartAssignedMatch(Request.MatchId, AssignedSeconds);
+		return;
+	}
+
+	World->ServerTravel(FString::Printf(TEXT("%s?ACMMatchId=%s"), *Request.MapName, *Request.MatchId), true);
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostSubsystem::UpdateMatchState(int32 NumPlayers)
+{
+
+	if (NumPlayers > 0)
+	{
+		bMatchHadPlayers = true;
+	}
+	else if (bMatchHadPlayers || TimeInMatch > MatchJoinTimeout)
+	{
+		FinishMatch();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_MatchHostSubsystem::WriteStatus(int32 NumPlayers)
+{
+
+	FACM_ServerStatus Status;
+	Status.ProcessId = FPlatformProcess::GetCurrentProcessId();
+	Status.Port = Port;
+	Status.State = State;
+	Status.MatchId = MatchId;
+	Status.NumPlayers = NumPlayers;
+	Status.AverageFrameMs = AverageFrameMs;
+	Status.MatchesServed = MatchesServed;
+	Status.Timestamp = FDateTime::UtcNow();
+
+	ACM_MatchHost::WriteJsonFile(ACM_MatchHost::GetStatusFilename(Port), Status.ToJson());
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_MatchHostSubsystem::GetNumPlayers() const
+{
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	AGameModeBase* GameMode = IsValid(World) ? World->GetAuthGameMode() : nullptr;
+
+	return IsValid(GameMode) ? GameMode->GetNumPlayers() : 0;
+
+}
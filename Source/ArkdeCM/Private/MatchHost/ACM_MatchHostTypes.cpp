@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MatchHost/ACM_MatchHostTypes.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "HAL/FileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+//=========================================================================================================================================================
+TSharedRef<FJsonObject> FACM_ServerStatus::ToJson() const
+{
+
+	TSharedRef<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+	JsonObject->SetNumberField(TEXT("ProcessId"), ProcessId);
+	JsonObject->SetNumberField(TEXT("Port"), Port);
+	JsonObject->SetStringField(TEXT("State"), ACM_MatchHost::LexToString(State));
+	JsonObject->SetStringField(TEXT("MatchId"), MatchId);
+	JsonObject->SetNumberField(TEXT("NumPlayers"), NumPlayers);
+	JsonObject->SetNumberField(TEXT("AverageFrameMs"), AverageFrameMs);
+	JsonObject->SetNumberField(TEXT("MatchesServed"), MatchesServed);
+	JsonObject->SetStringField(TEXT("Timestamp"), Timestamp.ToIso8601());
+
+	return JsonObject;
+
+}
+
+//=========================================================================================================================================================
+bool FACM_ServerStatus::FromJson(const TSharedPtr<FJsonObject>& JsonObject)
+{
+
+	if (!JsonObject.IsValid())
+	{
+		return false;
+	}
+
+	FString StateString;
+	FString TimestampString;
+
+	ProcessId = static_cast<uint32>(JsonObject->GetIntegerField(TEXT("ProcessId")));
+	Port = JsonObject->GetIntegerField(TEXT("Port"));
+	JsonObject->TryGetStringField(TEXT("State"), StateString);
+	State = ACM_MatchHost::ParseServerState(StateString);
+	JsonObject->TryGetStringField(TEXT("MatchId"), MatchId);
+	NumPlayers = JsonObject->GetIntegerField(TEXT("NumPlayers"));
+	AverageFrameMs = static_cast<float>(JsonObject->GetNumberField(TEXT("AverageFrameMs")));
+	MatchesServed = JsonObject->GetIntegerField(TEXT("MatchesServed"));
+
+	return JsonObject->TryGetStringField(TEXT("Timestamp"), TimestampString) && FDateTime::ParseIso8601(*TimestampString, Timestamp);
+
+}
+
+//=========================================================================================================================================================
+TSharedRef<FJsonObject> FACM_MatchRequest::ToJson() const
+{
+
+	TSharedRef<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+	JsonObject->SetStringField(TEXT("MatchId"), MatchId);
+	JsonObject->SetStringField(TEXT("MapName"), MapName);
+	JsonObject->SetNumberField(TEXT("MaxPlayers"), MaxPlayers);
+
+	return JsonObject;
+
+}
+
+//=========================================================================================================================================================
+bool FACM_MatchRequest::FromJson(const TSharedPtr<FJsonObject>& JsonObject)
+{
+
+	if (!JsonObject.IsValid())
+	{
+		return false;
+	}
+
+	JsonObject->TryGetStringField(TEXT("MatchId"), MatchId);
+	JsonObject->TryGetStringField(TEXT("MapName"), MapName);
+	MaxPlayers = JsonObject->GetIntegerField(TEXT("MaxPlayers"));
+
+	return !MatchId.IsEmpty() && !MapName.IsEmpty();
+
+}
+
+//=========================================================================================================================================================
+FString ACM_MatchHost::GetControlDirectory()
+{
+
+	FString ControlDirectory;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("ACMHostDir="), ControlDirectory))
+	{
+		ControlDirectory = FPaths::ProjectSavedDir() / TEXT("MatchHost");
+	}
+
+	return FPaths::ConvertRelativePathToFull(ControlDirectory);
+
+}
+
+FString ACM_MatchHost::GetInboxDirectory()
+{
+	return GetControlDirectory() / TEXT("Inbox");
+}
+
+FString ACM_MatchHost::GetStatusFilename(int32 Port)
+{
+	return GetControlDirectory() / TEXT("Servers") / FString::Printf(TEXT("%d.status.json"), Port);
+}
+
+FString ACM_MatchHost::GetAssignmentFilename(int32 Port)
+{
+	return GetControlDirectory() / TEXT("Servers") / FString::Printf(TEXT("%d.assign.json"), Port);
+}
+
+//=========================================================================================================================================================
+bool ACM_MatchHost::WriteJsonFile(const FString& Filename, const TSharedRef<FJsonObject>& JsonObject)
+{
+
+	FString Contents;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Contents);
+
+	if (!FJsonSerializer::Serialize(JsonObject, Writer))
+	{
+		return false;
+	}
+
+	const FString TempFilename = Filename + TEXT(".tmp");
+	if (!FFileHelper::SaveStringToFile(Contents, *TempFilename))
+	{
+		return false;
+	}
+
+	return IFileManager::Get().Move(*Filename, *TempFilename, true, true);
+
+}
+
+//=========================================================================================================================================================
+TSharedPtr<FJsonObject> ACM_MatchHost::ReadJsonFile(const FString& Filename)
+{
+
+	FString Contents;
+	if (!FFileHelper::LoadFileToString(Contents, *Filename))
+	{
+		return nullptr;
+	}
+
+	TSharedPtr<FJsonObject> JsonObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Contents);
+
+	if (!FJsonSerializer::Deserialize(Reader, JsonObject))
+	{
+		return nullptr;
+	}
+
+	return JsonObject;
+
+}
+
+//=========================================================================================================================================================
+const TCHAR* ACM_MatchHost::LexToString(EACM_ServerState State)
+{
+
+	switch (State)
+	{
+	case EACM_ServerState::Idle:
+		return TEXT("Idle");
+	case EACM_ServerState::InMatch:
+		return TEXT("InMatch");
+	case EACM_ServerState::Finished:
+		return TEXT("Finished");
+	default:
+		return TEXT("Starting");
+	}
+
+}
+
+EACM_ServerState ACM_MatchHost::ParseServerState(const FString& StateString)
+{
+
+	if (StateString == TEXT("Idle"))
+	{
+		return EACM_ServerState::Idle;
+	}
+	else if (StateString == TEXT("InMatch"))
+	{
+		return EACM_ServerState::InMatch;
+	}
+	else if (StateString == TEXT("Finished"))
+	{
+		return EACM_ServerState::Finished;
+	}
+
+	return EACM_ServerState::Starting;
+
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MatchHost/ACM_MatchmakerCommandlet.h"
+#include "MatchHost/ACM_MatchHostTypes.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+//=========================================================================================================================================================
+UACM_MatchmakerCommandlet::UACM_MatchmakerCommandlet()
+{
+
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_MatchmakerCommandlet::Main(const FString& Params)
+{
+
+	int32 NumMatches = 10;
+	float Interval = 5.0f;
+	FString MapName = TEXT("/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap");
+	int32 MaxPlayers = 8;
+
+	FParse::Value(*Params, TEXT("Matches="), NumMatches);
+	FParse::Value(*Params, TEXT("Interval="), Interval);
+	FParse::Value(*Params, TEXT("Map="), MapName);
+	FParse::Value(*Params, TEXT("MaxPlayers="), MaxPlayers);
+
+	const FString InboxDirectory = ACM_MatchHost::GetInboxDirectory();
+	IFileManager::Get().MakeDirectory(*InboxDirectory, true);
+
+	for (int32 MatchIndex = 0; MatchIndex < NumMatches && !IsEngineExitRequested(); MatchIndex++)
+	{
+
+		FACM_MatchRequest Request;
+		Request.MatchId = FString::Printf(TEXT("%s_%04d"), *FDateTime::UtcNow().ToString(TEXT("%Y%m%d%H%M%S")), MatchIndex);
+		Request.MapName = MapName;
+		Request.MaxPlayers = MaxPlayers;
+
+		if (ACM_MatchHost::WriteJsonFile(InboxDirectory / (Request.MatchId + TEXT(".json")), Request.ToJson()))
+		{
+			UE_LOG(LogArkdeCM, Display, TEXT("Pushed match %s"), *Request.MatchId);
+		}
+		else
+		{
+			UE_LOG(LogArkdeCM, Error, TEXT("Could not write match %s to %s"), *Request.MatchId, *InboxDirectory);
+			return 1;
+		}
+
+		FPlatformProcess::Sleep(Interval);
+
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,264 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Network/ACM_TimeSyncComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Time Sync Min Round Trip (ms)"), STAT_ACM_TimeSyncMinRoundTrip, STATGROUP_ArkdeCM);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Time Sync Estimate Error (ms)"), STAT_ACM_TimeSyncEstimateError, STATGROUP_ArkdeCM);
+
+namespace ACM_TimeSync
+{
+
+	static TAutoConsoleVariable<float> CVarInterval(
+		TEXT("ACM.TimeSync.Interval"),
+		2.0f,
+		TEXT("Seconds between time sync pings of a synchronized client."),
+		ECVF_Default);
+
+	/** Pings sent quickly after joining, so the first estimate is built from several samples */
+	static const int32 BurstPings = 5;
+	static const float BurstInterval = 0.25f;
+
+	/** Seconds of offset the estimate may take up per second, below this the estimate is never visibly stepped */
+	static const double SlewRate = 0.05;
+
+	/** Errors above this are taken up at once instead of slewed, e.g. after a hitch on either side */
+	static const double SnapThreshold = 0.25;
+
+}
+
+//=========================================================================================================================================================
+UACM_TimeSyncComponent::UACM_TimeSyncComponent()
+{
+
+	PrimaryComponentTick.bCanEverTick = false;
+	SetIsReplicatedByDefault(true);
+
+	FMemory::Memzero(PendingSendTimes);
+	FMemory::Memzero(PendingSequences);
+
+	NextSample = 0;
+	NextSequence = 0;
+	TargetOffset = 0.0;
+	SmoothedOffset = 0.0;
+	LastSlewTime = 0.0;
+	LastEstimate = 0.0;
+	NumBurstPings = 0;
+
+}
+
+//=========================================================================================================================================================
+double UACM_TimeSyncComponent::GetServerTime(const UObject* WorldContextObject)
+{
+
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr || World->GetNetMode() != NM_Client)
+	{
+		return GetServerClock();
+	}
+
+	for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+
+		const APlayerController* PlayerController = Iterator->Get();
+		const UACM_TimeSyncComponent* TimeSync = PlayerController != nullptr && PlayerController->IsLocalController() ? PlayerController->FindComponentByClass<UACM_TimeSyncComponent>() : nullptr;
+		if (TimeSync != nullptr)
+		{
+			return TimeSync->GetServerTimeEstimate();
+		}
+
+	}
+
+	return 0.0;
+
+}
+
+//=========================================================================================================================================================
+double UACM_TimeSyncComponent::GetServerClock()
+{
+	return FPlatformTime::Seconds() - GStartTime;
+}
+
+//=========================================================================================================================================================
+double UACM_TimeSyncComponent::GetServerTimeEstimate() const
+{
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		return GetServerClock();
+	}
+
+	if (Stats.NumSamples == 0)
+	{
+		return 0.0;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const double MaxStep = (Now - LastSlewTime) * ACM_TimeSync::SlewRate;
+	LastSlewTime = Now;
+
+	SmoothedOffset += FMath::Clamp(TargetOffset - SmoothedOffset, -MaxStep, MaxStep);
+	Stats.EstimateError = static_cast<float>(FMath::Abs(TargetOffset - SmoothedOffset));
+
+	// A backward correction holds the estimate until the clock catches up with it
+	LastEstimate = FMath::Max(LastEstimate, Now + SmoothedOffset);
+	return LastEstimate;
+
+}
+
+//=========================================================================================================================================================
+void UACM_TimeSyncComponent::BeginPlay()
+{
+
+	Super::BeginPlay();
+
+	const APlayerController* PlayerController = Cast<APlayerController>(GetOwner());
+	if (PlayerController == nullptr || !PlayerController->IsLocalController() || GetOwnerRole() == ROLE_Authority)
+	{
+		return;
+	}
+
+	NumBurstPings = 0;
+	GetWorld()->GetTimerManager().SetTimer(PingTimerHandle, this, &UACM_TimeSyncComponent::SendPing, ACM_TimeSync::BurstInterval, false, 0.0f);
+
+}
+
+//=========================================================================================================================================================
+void UACM_TimeSyncComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	GetWorld()->GetTimerManager().ClearTimer(PingTimerHandle);
+
+	Super::EndPlay(EndPlayReason);
+
+}
+
+//=========================================================================================================================================================
+void UACM_TimeSyncComponent::ServerRequestTime_Implementation(uint8 Sequence)
+{
+	ClientReceiveTime(Sequence, GetServerClock());
+}
+
+//=========================================================================================================================================================
+void UACM_TimeSyncComponent::ClientReceiveTime_Implementation(uint8 Sequence, double ServerTime)
+{
+
+	const int32 PendingIndex = Sequence % MaxPendingPings;
+	if (PendingSequences[PendingIndex] != Sequence || PendingSendTimes[PendingIndex] <= 0.0)
+	{
+		return;
+	}
+
+	const double ReceiveTime = FPlatformTime::Seconds();
+	const double SendTime = PendingSendTimes[PendingIndex];
+	PendingSendTimes[PendingIndex] = 0.0;
+
+	// The server read its clock somewhere in the round trip, the middle is the best guess without more information
+	const double RoundTrip = ReceiveTime - SendTime;
+	AddSample(RoundTrip, ServerTime - (SendTime + RoundTrip * 0.5));
+
+}
+
+//=========================================================================================================================================================
+void UACM_TimeSyncComponent::SendPing()
+{
+
+	const uint8 Sequence = NextSequence++;
+	const int32 PendingIndex = Sequence % MaxPendingPings;
+
+	PendingSequences[PendingIndex] = Sequence;
+	PendingSendTimes[PendingIndex] = FPlatformTime::Seconds();
+
+	ServerRequestTime(Sequence);
+
+	const bool bBurst = ++NumBurstPings < ACM_TimeSync::BurstPings;
+	const float Delay = bBurst ? ACM_TimeSync::BurstInterval : FMath::Max(ACM_TimeSync::CVarInterval.GetValueOnGameThread(), 0.1f);
+
+	GetWorld()->GetTimerManager().SetTimer(PingTimerHandle, this, &UACM_TimeSyncComponent::SendPing, Delay, false);
+
+}
+
+//=========================================================================================================================================================
+void UACM_TimeSyncComponent::AddSample(double RoundTrip, double Offset)
+{
+
+	Samples[NextSample].RoundTrip = RoundTrip;
+	Samples[NextSample].Offset = Offset;
+	NextSample = (NextSample + 1) % SampleWindow;
+
+	const bool bFirstSample = Stats.NumSamples == 0;
+	Stats.NumSamples++;
+
+	// Queuing only ever adds delay, so the fastest round trip in the window is the least distorted offset
+	const int32 NumValid = FMath::Min(Stats.NumSamples, SampleWindow);
+	int32 BestIndex = 0;
+	double MaxRoundTrip = Samples[0].RoundTrip;
+
+	for (int32 SampleIndex = 1; SampleIndex < NumValid; SampleIndex++)
+	{
+
+		if (Samples[SampleIndex].RoundTrip < Samples[BestIndex].RoundTrip)
+		{
+			BestIndex = SampleIndex;
+		}
+
+		MaxRoundTrip = FMath::Max(MaxRoundTrip, Samples[SampleIndex].RoundTrip);
+
+	}
+
+	TargetOffset = Samples[BestIndex].Offset;
+
+	if (bFirstSample || FMath::Abs(TargetOffset - SmoothedOffset) > ACM_TimeSync::SnapThreshold)
+	{
+		SmoothedOffset = TargetOffset;
+		LastSlewTime = FPlatformTime::Seconds();
+	}
+
+	Stats.LastRoundTrip = static_cast<float>(RoundTrip);
+	Stats.MinRoundTrip = static_cast<float>(Samples[BestIndex].RoundTrip);
+	Stats.RoundTripSpread = static_cast<float>(MaxRoundTrip - Samples[BestIndex].RoundTrip);
+	Stats.ErrorBound = Stats.MinRoundTrip * 0.5f;
+	Stats.EstimateError = static_cast<float>(FMath::Abs(TargetOffset - SmoothedOffset));
+
+	SET_FLOAT_STAT(STAT_ACM_TimeSyncMinRoundTrip, Stats.MinRoundTrip * 1000.0f);
+	SET_FLOAT_STAT(STAT_ACM_TimeSyncEstimateError, Stats.EstimateError * 1000.0f);
+
+}
+
+//=========================================================================================================================================================
+static void LogTimeSyncStats(const TArray<FString>& Args, UWorld* World)
+{
+
+	if (!IsValid(World))
+	{
+		return;
+	}
+
+	for (TObjectIterator<UACM_TimeSyncComponent> Iterator; Iterator; ++Iterator)
+	{
+
+		const UACM_TimeSyncComponent* TimeSync = *Iterator;
+		if (TimeSync->GetWorld() != World || TimeSync->GetOwnerRole() == ROLE_Authority)
+		{
+			continue;
+		}
+
+		const FACM_TimeSyncStats Stats = TimeSync->GetStats();
+		UE_LOG(LogArkdeCM, Display, TEXT("Time sync %s: server %.4f s, %d samples, rtt %.1f ms (min %.1f, spread %.1f), error %.2f ms (bound %.1f ms)"),
+			*GetNameSafe(TimeSync->GetOwner()), TimeSync->GetServerTimeEstimate(), Stats.NumSamples, Stats.LastRoundTrip * 1000.0f, Stats.MinRoundTrip * 1000.0f,
+			Stats.RoundTripSpread * 1000.0f, Stats.EstimateError * 1000.0f, Stats.ErrorBound * 1000.0f);
+
+	}
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarLogTimeSyncStats(
+	TEXT("ACM.TimeSync.Stats"),
+	TEXT("Logs the server time estimate of the local players and its error metrics"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LogTimeSyncStats));
@@ -0,0 +1,522 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Persistence/ACM_CheckpointSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "ArkdeCMGameMode.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_CYCLE_STAT(TEXT("Checkpoint Capture"), STAT_ACM_CheckpointCapture, STATGROUP_ArkdeCM);
+DECLARE_CYCLE_STAT(TEXT("Checkpoint Write"), STAT_ACM_CheckpointWrite, STATGROUP_ArkdeCM);
+
+namespace ACM_Checkpoint
+{
+
+	static TAutoConsoleVariable<float> CVarInterval(
+		TEXT("ACM.Checkpoint.Interval"),
+		10.0f,
+		TEXT("Seconds between crash recovery checkpoints on the server, 0 disables them."),
+		ECVF_Default);
+
+	static TAutoConsoleVariable<int32> CVarMaxFileMB(
+		TEXT("ACM.Checkpoint.MaxFileMB"),
+		64,
+		TEXT("The checkpoint file is rotated to .old once it grows past this size."),
+		ECVF_Default);
+
+	static const uint32 RecordMagic = 0x434D4341; // "ACMC"
+
+	/** Magic, payload size and payload CRC */
+	static const int32 RecordHeaderSize = 12;
+
+	/** Sanity limit for the player count read from a record */
+	static const int32 MaxPlayers = 1024;
+
+	struct FRoundTripState
+	{
+		float Health = 0.0f;
+		float HealthBase = 0.0f;
+		float MaxHealth = 0.0f;
+		float MaxHealthBase = 0.0f;
+		int32 NumEffects = 0;
+	};
+
+	static UACM_AbilitySystemComponent* SpawnCheckComponent(UWorld* World)
+	{
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+
+		AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+
+		UACM_AbilitySystemComponent* AbilityComponent = NewObject<UACM_AbilitySystemComponent>(Actor);
+		AbilityComponent->RegisterComponent();
+		AbilityComponent->AddAttributeSetSubobject(NewObject<UACM_AttributeSet>(Actor));
+		AbilityComponent->InitAbilityActorInfo(Actor, Actor);
+
+		return AbilityComponent;
+
+	}
+
+	static FRoundTripState CaptureState(const UAbilitySystemComponent* AbilityComponent)
+	{
+
+		FRoundTripState State;
+		State.Health = AbilityComponent->GetNumericAttribute(UACM_AttributeSet::GetHealthAttribute());
+		State.HealthBase = AbilityComponent->GetNumericAttributeBase(UACM_AttributeSet::GetHealthAttribute());
+		State.MaxHealth = AbilityComponent->GetNumericAttribute(UACM_AttributeSet::GetMaxHealthAttribute());
+		State.MaxHealthBase = AbilityComponent->GetNumericAttributeBase(UACM_AttributeSet::GetMaxHealthAttribute());
+		State.NumEffects = AbilityComponent->GetActiveEffects(FGameplayEffectQuery()).Num();
+
+		return State;
+
+	}
+
+	/** Saves a wounded character under a MaxHealth buff, restores it through the byte format and compares */
+	static void VerifyRoundTrip(const TArray<FString>& Args, UWorld* World)
+	{
+
+		if (!IsValid(World) || World->GetNetMode() == NM_Client)
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Checkpoint.VerifyRoundTrip needs an authoritative world"));
+			return;
+		}
+
+		UGameplayEffect* Damage = NewObject<UGameplayEffect>(GetTransientPackage(), MakeUniqueObjectName(GetTransientPackage(), UGameplayEffect::StaticClass(), TEXT("ACM_Check_Damage")));
+		FGameplayModifierInfo& DamageModifier = Damage->Modifiers.AddDefaulted_GetRef();
+		DamageModifier.Attribute = UACM_AttributeSet::GetHealthAttribute();
+		DamageModifier.ModifierOp = EGameplayModOp::Additive;
+		DamageModifier.ModifierMagnitude = FGameplayEffectModifierMagnitude(FScalableFloat(-70.0f));
+
+		UACM_AbilitySystemComponent* Source = SpawnCheckComponent(World);
+		Source->ApplyGameplayEffectToSelf(GetDefault<UACM_CheckpointCheckEffect>(), 1.0f, Source->MakeEffectContext());
+		Source->ApplyGameplayEffectToSelf(Damage, 1.0f, Source->MakeEffectContext());
+
+		const FRoundTripState Expected = CaptureState(Source);
+
+		FACM_PlayerSnapshot SavedSnapshot;
+		SavedSnapshot.Save(Source);
+
+		TArray<uint8> SnapshotBytes;
+		SavedSnapshot.ToBytes(SnapshotBytes);
+
+		FACM_PlayerSnapshot LoadedSnapshot;
+		if (!LoadedSnapshot.FromBytes(SnapshotBytes))
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("Checkpoint round trip: the saved snapshot of %d bytes does not load"), SnapshotBytes.Num());
+			Source->GetOwner()->Destroy();
+			return;
+		}
+
+		// Into a fresh pawn, as on resume or reconnect, and back over the state it was saved from
+		UACM_AbilitySystemComponent* Fresh = SpawnCheckComponent(World);
+
+		struct FRoundTripCase
+		{
+			const TCHAR* Name;
+			UACM_AbilitySystemComponent* Target;
+		};
+
+		const FRoundTripCase Cases[] =
+		{
+			{ TEXT("Fresh character"), Fresh },
+			{ TEXT("Same character"), Source }
+		};
+
+		int32 NumMismatches = 0;
+
+		for (const FRoundTripCase& Case : Cases)
+		{
+
+			const bool bRestored = LoadedSnapshot.Restore(Case.Target);
+			const FRoundTripState Restored = CaptureState(Case.Target);
+
+			const bool bMatches = bRestored
+				&& FMath::IsNearlyEqual(Expected.Health, Restored.Health)
+				&& FMath::IsNearlyEqual(Expected.HealthBase, Restored.HealthBase)
+				&& FMath::IsNearlyEqual(Expected.MaxHealth, Restored.MaxHealth)
+				&& FMath::IsNearlyEqual(Expected.MaxHealthBase, Restored.MaxHealthBase)
+				&& Expected.NumEffects == Restored.NumEffects;
+
+			if (!bMatches)
+			{
+				NumMismatches++;
+				UE_LOG(LogArkdeCM, Warning, TEXT("  %s: saved %.2f (base %.2f) / %.2f (base %.2f) with %d effects, restored %.2f (base %.2f) / %.2f (base %.2f) with %d effects"), Case.Name,
+					Expected.Health, Expected.HealthBase, Expected.MaxHealth, Expected.MaxHealthBase, Expected.NumEffects,
+					Restored.Health, Restored.HealthBase, Restored.MaxHealth, Restored.MaxHealthBase, Restored.NumEffects);
+			}
+
+		}
+
+		Source->GetOwner()->Destroy();
+		Fresh->GetOwner()->Destroy();
+
+		UE_LOG(LogArkdeCM, Display, TEXT("Checkpoint round trip: %d cases, %d mismatches"), static_cast<int32>(UE_ARRAY_COUNT(Cases)), NumMismatches);
+
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs CVarVerifyRoundTrip(
+		TEXT("ACM.Checkpoint.VerifyRoundTrip"),
+		TEXT("Saves a scratch character with Health below a buffed MaxHealth, restores the snapshot and reports values that differ"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&VerifyRoundTrip));
+
+}
+
+//=========================================================================================================================================================
+UACM_CheckpointCheckEffect::UACM_CheckpointCheckEffect()
+{
+
+	DurationPolicy = EGameplayEffectDurationType::Infinite;
+
+	FGameplayModifierInfo& Modifier = Modifiers.AddDefaulted_GetRef();
+	Modifier.Attribute = UACM_AttributeSet::GetMaxHealthAttribute();
+	Modifier.ModifierOp = EGameplayModOp::Additive;
+	Modifier.ModifierMagnitude = FGameplayEffectModifierMagnitude(FScalableFloat(100.0f));
+
+}
+
+//=========================================================================================================================================================
+void UACM_CheckpointSubsystem::Deinitialize()
+{
+
+	if (PendingWrite.IsValid())
+	{
+		PendingWrite.Wait();
+	}
+
+	FileWriter.Reset();
+
+	Super::Deinitialize();
+
+}
+
+//=========================================================================================================================================================
+FString UACM_CheckpointSubsystem::GetCheckpointFilename(const FString& MatchId)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Checkpoints") / FString::Printf(TEXT("ACM_%s.ckpt"), MatchId.IsEmpty() ? TEXT("Match") : *MatchId);
+}
+
+//=========================================================================================================================================================
+bool UACM_CheckpointSubsystem::ResumeFromCommandLine(AArkdeCMGameMode* GameMode)
+{
+
+	FString ResumeFilename;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("ACMResumeCheckpoint="), ResumeFilename))
+	{
+
+		if (!FParse::Param(FCommandLine::Get(), TEXT("ACMResumeCheckpoint")))
+		{
+			return false;
+		}
+
+		ResumeFilename = GetCheckpointFilename(GameMode->GetCurrentMatchId());
+
+	}
+
+	if (ResumeFromFile(ResumeFilename, GameMode))
+	{
+		return true;
+	}
+
+	return ResumeFromFile(ResumeFilename + TEXT(".old"), GameMode);
+
+}
+
+//=========================================================================================================================================================
+bool UACM_CheckpointSubsystem::ResumeFromFile(const FString& ResumeFilename, AArkdeCMGameMode* GameMode)
+{
+
+	using namespace ACM_Checkpoint;
+
+	TArray<uint8> FileData;
+	if (!IsValid(GameMode) || !FFileHelper::LoadFileToArray(FileData, *ResumeFilename, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	// Walk the records, the last one may be torn by the crash
+	int32 LatestOffset = INDEX_NONE;
+	int32 LatestSize = 0;
+	int32 Offset = 0;
+
+	FMemoryReader FileReader(FileData);
+	while (Offset + RecordHeaderSize <= FileData.Num())
+	{
+
+		uint32 Magic = 0;
+		int32 PayloadSize = 0;
+		uint32 PayloadCrc = 0;
+
+		FileReader.Seek(Offset);
+		FileReader << Magic << PayloadSize << PayloadCrc;
+
+		if (Magic != RecordMagic || PayloadSize < 0 || PayloadSize > FileData.Num() - Offset - RecordHeaderSize)
+		{
+			break;
+		}
+
+		if (FCrc::MemCrc32(FileData.GetData() + Offset + RecordHeaderSize, PayloadSize) == PayloadCrc)
+		{
+			LatestOffset = Offset + RecordHeaderSize;
+			LatestSize = PayloadSize;
+		}
+
+		Offset += RecordHeaderSize + PayloadSize;
+
+	}
+
+	if (LatestOffset == INDEX_NONE)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("No intact checkpoint in %s"), *ResumeFilename);
+		return false;
+	}
+
+	TArray<uint8> Payload(FileData.GetData() + LatestOffset, LatestSize);
+	FMemoryReader Reader(Payload);
+
+	uint32 Sequence = 0;
+	float MatchTime = 0.0f;
+	int32 NumPlayers = 0;
+	Reader << Sequence << MatchTime << NumPlayers;
+
+	if (Reader.IsError() || NumPlayers < 0 || NumPlayers > MaxPlayers)
+	{
+		return false;
+	}
+
+	int32 NumRestored = 0;
+	for (int32 PlayerIndex = 0; PlayerIndex < NumPlayers && !Reader.IsError(); PlayerIndex++)
+	{
+
+		FString PlayerKey;
+		float Score = 0.0f;
+		TArray<uint8> SnapshotBytes;
+		Reader << PlayerKey << Score << SnapshotBytes;
+
+		FACM_PlayerSnapshot Snapshot;
+		if (Reader.IsError() || !Snapshot.FromBytes(SnapshotBytes))
+		{
+			continue;
+		}
+
+		GameMode->AddPendingPlayerSnapshot(PlayerKey, Snapshot);
+		ResumedScores.Add(PlayerKey, Score);
+		NumRestored++;
+
+	}
+
+	NextSequence = Sequence + 1;
+
+	UE_LOG(LogArkdeCM, Log, TEXT("Resuming from checkpoint %u of %s at %.1f s, %d players"), Sequence, *ResumeFilename, MatchTime, NumRestored);
+	return true;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_CheckpointSubsystem::ConsumeResumedScore(const FString& PlayerKey, float& OutScore)
+{
+	return ResumedScores.RemoveAndCopyValue(PlayerKey, OutScore);
+}
+
+//=========================================================================================================================================================
+void UACM_CheckpointSubsystem::Checkpoint()
+{
+
+	if (IsWriting())
+	{
+		NumSkipped++;
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_CheckpointCapture);
+
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	UWorld* World = GetWorld();
+
+	if (Filename.IsEmpty())
+	{
+		const AArkdeCMGameMode* GameMode = World->GetAuthGameMode<AArkdeCMGameMode>();
+		Filename = GetCheckpointFilename(GameMode != nullptr ? GameMode->GetCurrentMatchId() : FString());
+	}
+
+	FCheckpointBuffer& Buffer = Buffers[BackBufferIndex];
+	Buffer.Sequence = NextSequence++;
+	Buffer.MatchTime = World->GetTimeSeconds();
+	Buffer.NumPlayers = 0;
+
+	for (FConstPlayerControllerIterator PlayerIterator = World->GetPlayerControllerIterator(); PlayerIterator; ++PlayerIterator)
+	{
+
+		const APlayerController* PlayerController = PlayerIterator->Get();
+		const UAbilitySystemComponent* AbilitySystemComponent = IsValid(PlayerController) ? UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(PlayerController->GetPawn()) : nullptr;
+
+		if (!IsValid(AbilitySystemComponent) || !IsValid(PlayerController->PlayerState))
+		{
+			continue;
+		}
+
+		if (Buffer.Players.Num() <= Buffer.NumPlayers)
+		{
+			Buffer.Players.AddDefaulted();
+		}
+
+		FPlayerCheckpoint& PlayerCheckpoint = Buffer.Players[Buffer.NumPlayers++];
+		PlayerCheckpoint.PlayerKey = AArkdeCMGameMode::GetPlayerSnapshotKey(PlayerController);
+		PlayerCheckpoint.Score = PlayerController->PlayerState->GetScore();
+		PlayerCheckpoint.Snapshot.Save(AbilitySystemComponent);
+
+	}
+
+	// The writer owns this buffer until PendingWrite is ready, the game thread fills the other one next time
+	BackBufferIndex ^= 1;
+	PendingWrite = Async(EAsyncExecution::ThreadPool, [this, &Buffer]()
+	{
+		WriteCheckpoint(Buffer);
+	});
+
+	const double CaptureSeconds = FPlatformTime::Seconds() - StartSeconds;
+	TotalCaptureSeconds += CaptureSeconds;
+	MaxCaptureSeconds = FMath::Max(MaxCaptureSeconds, CaptureSeconds);
+	NumCheckpoints++;
+
+}
+
+//=========================================================================================================================================================
+void UACM_CheckpointSubsystem::WriteCheckpoint(FCheckpointBuffer& Buffer)
+{
+
+	using namespace ACM_Checkpoint;
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_CheckpointWrite);
+
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	TArray<uint8> Payload;
+	FMemoryWriter PayloadWriter(Payload);
+
+	PayloadWriter << Buffer.Sequence << Buffer.MatchTime << Buffer.NumPlayers;
+
+	TArray<uint8> SnapshotBytes;
+	for (int32 PlayerIndex = 0; PlayerIndex < Buffer.NumPlayers; PlayerIndex++)
+	{
+		FPlayerCheckpoint& PlayerCheckpoint = Buffer.Players[PlayerIndex];
+		PlayerCheckpoint.Snapshot.ToBytes(SnapshotBytes);
+		PayloadWriter << PlayerCheckpoint.PlayerKey << PlayerCheckpoint.Score << SnapshotBytes;
+	}
+
+	const int64 MaxFileBytes = static_cast<int64>(FMath::Max(CVarMaxFileMB.GetValueOnAnyThread(), 1)) * 1024 * 1024;
+	if (FileWriter.IsValid() && FileWriter->TotalSize() > MaxFileBytes)
+	{
+		FileWriter.Reset();
+		IFileManager::Get().Move(*(Filename + TEXT(".old")), *Filename, true);
+	}
+
+	if (!FileWriter.IsValid())
+	{
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(Filename), true);
+		FileWriter.Reset(IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_Append | FILEWRITE_AllowRead));
+	}
+
+	if (!FileWriter.IsValid())
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Could not open checkpoint file %s"), *Filename);
+		return;
+	}
+
+	uint32 Magic = RecordMagic;
+	int32 PayloadSize = Payload.Num();
+	uint32 PayloadCrc = FCrc::MemCrc32(Payload.GetData(), Payload.Num());
+
+	*FileWriter << Magic << PayloadSize << PayloadCrc;
+	FileWriter->Serialize(Payload.GetData(), Payload.Num());
+	FileWriter->Flush();
+
+	BytesWritten += RecordHeaderSize + Payload.Num();
+	WriteMicroseconds += static_cast<int64>((FPlatformTime::Seconds() - StartSeconds) * 1000000.0);
+
+}
+
+//=========================================================================================================================================================
+void UACM_CheckpointSubsystem::LogStats() const
+{
+
+	const double AverageMs = NumCheckpoints > 0 ? TotalCaptureSeconds * 1000.0 / NumCheckpoints : 0.0;
+	const double WriteMs = NumCheckpoints > 0 ? WriteMicroseconds.Load() / 1000.0 / NumCheckpoints : 0.0;
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Checkpoints: %d taken, %d skipped while writing. Game thread %.3f ms avg, %.3f ms max. Writer %.3f ms avg, %lld bytes to %s"),
+		NumCheckpoints, NumSkipped, AverageMs, MaxCaptureSeconds * 1000.0, WriteMs, BytesWritten.Load(), *Filename);
+
+}
+
+//=========================================================================================================================================================
+void UACM_CheckpointSubsystem::Tick(float DeltaTime)
+{
+
+	TimeSinceCheckpoint += DeltaTime;
+
+	if (TimeSinceCheckpoint >= ACM_Checkpoint::CVarInterval.GetValueOnGameThread())
+	{
+		TimeSinceCheckpoint = 0.0f;
+		Checkpoint();
+	}
+
+}
+
+//=========================================================================================================================================================
+bool UACM_CheckpointSubsystem::IsTickable() const
+{
+
+	const UWorld* World = GetWorld();
+	if (!IsValid(World) || World->GetNetMode() == NM_Client || World->GetNetMode() == NM_Standalone || !World->HasBegunPlay())
+	{
+		return false;
+	}
+
+	// A pre-warmed server has no match to recover yet
+	const AArkdeCMGameMode* GameMode = World->GetAuthGameMode<AArkdeCMGameMode>();
+	if (GameMode == nullptr || GameMode->IsAwaitingMatchAssignment())
+	{
+		return false;
+	}
+
+	return ACM_Checkpoint::CVarInterval.GetValueOnGameThread() > 0.0f;
+
+}
+
+//=========================================================================================================================================================
+TStatId UACM_CheckpointSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UACM_CheckpointSubsystem, STATGROUP_Tickables);
+}
+
+//=========================================================================================================================================================
+static void LogCheckpointStats(const TArray<FString>& Args, UWorld* World)
+{
+
+	const UACM_CheckpointSubsystem* CheckpointSubsystem = IsValid(World) ? World->GetSubsystem<UACM_CheckpointSubsystem>() : nullptr;
+	if (IsValid(CheckpointSubsystem))
+	{
+		CheckpointSubsystem->LogStats();
+	}
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarLogCheckpointStats(
+	TEXT("ACM.Checkpoint.Stats"),
+	TEXT("Logs the game thread cost of crash recovery checkpoints and what the writer has written."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LogCheckpointStats));
@@ -0,0 +1,481 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Persistence/ACM_PlayerSnapshot.h"
+#include "AbilitySystemComponent.h"
+#include "GameplayEffect.h"
+#include "GameplayCueManager.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/World.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "UObject/SoftObjectPath.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_AuraSubsystem.h"
+#include "GameplayAbility/ACM_SharedEffectSubsystem.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_CYCLE_STAT(TEXT("Player Snapshot Save"), STAT_ACM_PlayerSnapshotSave, STATGROUP_ArkdeCM);
+DECLARE_CYCLE_STAT(TEXT("Player Snapshot Restore"), STAT_ACM_PlayerSnapshotRestore, STATGROUP_ArkdeCM);
+
+namespace ACM_PlayerSnapshot
+{
+
+	/** Sanity limit for counts read from a snapshot */
+	static const int32 MaxEntries = 4096;
+
+	/** Packed int that keeps INDEX_NONE one byte */
+	static void SerializeIndex(FArchive& Ar, int32& Value)
+	{
+
+		uint32 Packed = static_cast<uint32>(Value + 1);
+		Ar.SerializeIntPacked(Packed);
+		Value = static_cast<int32>(Packed) - 1;
+
+	}
+
+	static bool SerializeCount(FArchive& Ar, int32 Count, int32& OutCount)
+	{
+
+		uint32 Packed = static_cast<uint32>(Count);
+		Ar.SerializeIntPacked(Packed);
+
+		if (Ar.IsError() || Packed > static_cast<uint32>(MaxEntries))
+		{
+			Ar.SetError();
+			return false;
+		}
+
+		OutCount = static_cast<int32>(Packed);
+		return true;
+
+	}
+
+	static const APlayerState* GetInstigatingPlayerState(const AActor* Instigator)
+	{
+
+		if (const APawn* Pawn = Cast<APawn>(Instigator))
+		{
+			return Pawn->GetPlayerState();
+		}
+
+		if (const AController* Controller = Cast<AController>(Instigator))
+		{
+			return Controller->PlayerState;
+		}
+
+		return Cast<APlayerState>(Instigator);
+
+	}
+
+	/** Same key as AArkdeCMGameMode::GetPlayerSnapshotKey, stable across server processes */
+	static FString GetPlayerKey(const APlayerState* PlayerState)
+	{
+		return PlayerState->GetUniqueId().IsValid() ? PlayerState->GetUniqueId().ToString() : PlayerState->GetPlayerName();
+	}
+
+	static APawn* FindPlayerPawn(const UWorld* World, const FString& PlayerKey)
+	{
+
+		const AGameStateBase* GameState = IsValid(World) ? World->GetGameState() : nullptr;
+		if (!IsValid(GameState))
+		{
+			return nullptr;
+		}
+
+		for (const APlayerState* PlayerState : GameState->PlayerArray)
+		{
+			if (IsValid(PlayerState) && GetPlayerKey(PlayerState) == PlayerKey)
+			{
+				return PlayerState->GetPawn();
+			}
+		}
+
+		return nullptr;
+
+	}
+
+	/** Entries a shared effect group or an aura applied, their subsystem removes them */
+	static bool IsOwnedBySubsystem(const UAbilitySystemComponent* AbilitySystemComponent, FActiveGameplayEffectHandle Handle)
+	{
+
+		const UWorld* World = AbilitySystemComponent->GetWorld();
+		const UACM_SharedEffectSubsystem* SharedEffectSubsystem = IsValid(World) ? World->GetSubsystem<UACM_SharedEffectSubsystem>() : nullptr;
+		const UACM_AuraSubsystem* AuraSubsystem = IsValid(World) ? World->GetSubsystem<UACM_AuraSubsystem>() : nullptr;
+
+		return (IsValid(SharedEffectSubsystem) && SharedEffectSubsystem->OwnsEffect(AbilitySystemComponent, Handle))
+			|| (IsValid(AuraSubsystem) && AuraSubsystem->OwnsEffect(AbilitySystemComponent, Handle));
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void FACM_PlayerSnapshot::Reset()
+{
+
+	Version = CurrentVersion;
+	Strings.Reset();
+	AttributeBaseValues.Reset();
+	Abilities.Reset();
+	Effects.Reset();
+
+}
+
+//=========================================================================================================================================================
+void FACM_PlayerSnapshot::Save(const UAbilitySystemComponent* AbilitySystemComponent)
+{
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_PlayerSnapshotSave);
+
+	Reset();
+
+	if (!IsValid(AbilitySystemComponent))
+	{
+		return;
+	}
+
+	for (const FGameplayAttribute& Attribute : UACM_AttributeSet::GetAllAttributes())
+	{
+		AttributeBaseValues.Add(AbilitySystemComponent->HasAttributeSetForAttribute(Attribute) ? AbilitySystemComponent->GetNumericAttributeBase(Attribute) : 0.0f);
+	}
+
+	for (const FGameplayAbilitySpec& AbilitySpec : AbilitySystemComponent->GetActivatableAbilities())
+	{
+
+		if (AbilitySpec.Ability == nullptr)
+		{
+			continue;
+		}
+
+		FAbility& Ability = Abilities.AddDefaulted_GetRef();
+		Ability.ClassIndex = Strings.AddUnique(AbilitySpec.Ability->GetClass()->GetPathName());
+		Ability.Level = AbilitySpec.Level;
+		Ability.InputId = AbilitySpec.InputID;
+
+	}
+
+	using namespace ACM_PlayerSnapshot;
+
+	const float WorldTime = AbilitySystemComponent->GetWorld()->GetTimeSeconds();
+
+	for (const FActiveGameplayEffectHandle& EffectHandle : AbilitySystemComponent->GetActiveEffects(FGameplayEffectQuery()))
+	{
+
+		const FActiveGameplayEffect* ActiveEffect = AbilitySystemComponent->GetActiveGameplayEffect(EffectHandle);
+		if (ActiveEffect == nullptr || ActiveEffect->Spec.Def == nullptr || ActiveEffect->IsPendingRemove || IsOwnedBySubsystem(AbilitySystemComponent, EffectHandle))
+		{
+			continue;
+		}
+
+		FEffect& Effect = Effects.AddDefaulted_GetRef();
+		Effect.ClassIndex = Strings.AddUnique(ActiveEffect->Spec.Def->GetClass()->GetPathName());
+		Effect.Level = ActiveEffect->Spec.GetLevel();
+		Effect.StackCount = ActiveEffect->Spec.StackCount;
+		Effect.RemainingDuration = ActiveEffect->GetDuration() > 0.0f ? ActiveEffect->GetTimeRemaining(WorldTime) : -1.0f;
+
+		for (const TPair<FGameplayTag, float>& MagnitudePair : ActiveEffect->Spec.SetByCallerTagMagnitudes)
+		{
+			Effect.SetByCallerMagnitudes.Add({ Strings.AddUnique(MagnitudePair.Key.ToString()), MagnitudePair.Value });
+		}
+
+		const FGameplayEffectContextHandle& EffectContext = ActiveEffect->Spec.GetContext();
+		Effect.Instigator = EffectContext.GetOriginalInstigator();
+		Effect.EffectCauser = EffectContext.GetEffectCauser();
+
+		const APlayerState* InstigatorPlayerState = GetInstigatingPlayerState(EffectContext.GetOriginalInstigator());
+		if (IsValid(InstigatorPlayerState))
+		{
+			Effect.InstigatorIndex = Strings.AddUnique(GetPlayerKey(InstigatorPlayerState));
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+bool FACM_PlayerSnapshot::Restore(UAbilitySystemComponent* AbilitySystemComponent) const
+{
+
+	using namespace ACM_PlayerSnapshot;
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_PlayerSnapshotRestore);
+
+	if (!IsValid(AbilitySystemComponent) || !AbilitySystemComponent->IsOwnerActorAuthoritative() || IsEmpty() || !HasValidIndices())
+	{
+		return false;
+	}
+
+	TArray<UClass*> Classes;
+	Classes.Reserve(Strings.Num());
+
+	for (const FString& String : Strings)
+	{
+		// Tag names fail to resolve as classes and stay null
+		Classes.Add(String.StartsWith(TEXT("/")) ? FSoftClassPath(String).TryLoadClass<UObject>() : nullptr);
+	}
+
+	// Saved resources already hold every Max rescale, the re-applied Max effects must not rescale them again. Held
+	// until the batch below is evaluated, which is when the Max changes reach the set
+	UACM_AttributeSet* AttributeSet = const_cast<UACM_AttributeSet*>(AbilitySystemComponent->GetSet<UACM_AttributeSet>());
+	UACM_AbilitySystemComponent* ArkdeAbilitySystemComponent = Cast<UACM_AbilitySystemComponent>(AbilitySystemComponent);
+
+	if (AttributeSet != nullptr)
+	{
+		AttributeSet->SetMaxAdjustSuppressed(true);
+	}
+
+	// One cue batch and one aggregator evaluation for the whole restore
+	FScopedGameplayCueSendContext GameplayCueSendContext;
+	UACM_AttributeSet::BeginAggregationBatch();
+
+	// Shared group and aura entries stay, their subsystem still tracks them and re-applying would leave orphan copies
+	bool bKeptEffects = false;
+	for (const FActiveGameplayEffectHandle& EffectHandle : AbilitySystemComponent->GetActiveEffects(FGameplayEffectQuery()))
+	{
+
+		if (IsOwnedBySubsystem(AbilitySystemComponent, EffectHandle))
+		{
+			bKeptEffects = true;
+			continue;
+		}
+
+		AbilitySystemComponent->RemoveActiveGameplayEffect(EffectHandle);
+
+	}
+
+	AbilitySystemComponent->ClearAllAbilities();
+
+	for (const FAbility& Ability : Abilities)
+	{
+		UClass* AbilityClass = Classes[Ability.ClassIndex];
+		if (AbilityClass != nullptr && AbilityClass->IsChildOf(UGameplayAbility::StaticClass()))
+		{
+			AbilitySystemComponent->GiveAbility(FGameplayAbilitySpec(AbilityClass, Ability.Level, Ability.InputId, AbilitySystemComponent->GetAvatarActor()));
+		}
+	}
+
+	// Written into the set as saved, with no effect left the current values equal the bases until the effects return.
+	// Aggregators that still hold the modifiers of kept effects are evaluated again when the batch ends
+	const TArray<FGameplayAttribute>& AllAttributes = UACM_AttributeSet::GetAllAttributes();
+	for (int32 AttributeIndex = 0; AttributeIndex < AllAttributes.Num() && AttributeIndex < AttributeBaseValues.Num() && AttributeSet != nullptr; AttributeIndex++)
+	{
+
+		AttributeSet->WriteAttributeValue(AllAttributes[AttributeIndex], AttributeBaseValues[AttributeIndex], AttributeBaseValues[AttributeIndex]);
+
+		if (IsValid(ArkdeAbilitySystemComponent))
+		{
+			ArkdeAbilitySystemComponent->SetAggregatorBaseValue(AllAttributes[AttributeIndex], AllAttributes[AttributeIndex].GetGameplayAttributeData(AttributeSet)->GetBaseValue(), bKeptEffects);
+		}
+
+	}
+
+	for (const FEffect& Effect : Effects)
+	{
+
+		UClass* EffectClass = Classes[Effect.ClassIndex];
+		if (EffectClass == nullptr || !EffectClass->IsChildOf(UGameplayEffect::StaticClass()))
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("Snapshot effect %s could not be loaded and is skipped"), *Strings[Effect.ClassIndex]);
+			continue;
+		}
+
+		// Damage history and source based captures read the instigator, a self instigated copy would lose it
+		FGameplayEffectContextHandle EffectContext = AbilitySystemComponent->MakeEffectContext();
+
+		AActor* Instigator = Effect.Instigator.Get();
+		if (Instigator == nullptr && Effect.InstigatorIndex != INDEX_NONE)
+		{
+			Instigator = FindPlayerPawn(AbilitySystemComponent->GetWorld(), Strings[Effect.InstigatorIndex]);
+		}
+
+		if (Instigator != nullptr)
+		{
+			EffectContext.AddInstigator(Instigator, Effect.EffectCauser.IsValid() ? Effect.EffectCauser.Get() : Instigator);
+		}
+
+		FGameplayEffectSpec Spec(EffectClass->GetDefaultObject<UGameplayEffect>(), EffectContext, Effect.Level);
+		Spec.SetStackCount(Effect.StackCount);
+
+		if (Effect.RemainingDuration > 0.0f)
+		{
+			Spec.SetDuration(Effect.RemainingDuration, true);
+		}
+
+		for (const FSetByCaller& SetByCaller : Effect.SetByCallerMagnitudes)
+		{
+			const FGameplayTag Tag = FGameplayTag::RequestGameplayTag(FName(*Strings[SetByCaller.TagIndex]), false);
+			if (Tag.IsValid())
+			{
+				Spec.SetSetByCallerMagnitude(Tag, SetByCaller.Magnitude);
+			}
+		}
+
+		AbilitySystemComponent->ApplyGameplayEffectSpecToSelf(Spec);
+
+	}
+
+	UACM_AttributeSet::EndAggregationBatch(AbilitySystemComponent->GetWorld());
+
+	// Nested in the frame batch, the Max changes would only reach the set at the end of the tick
+	UACM_AttributeSet::FlushDeferredAggregation(AbilitySystemComponent);
+
+	if (AttributeSet != nullptr)
+	{
+		AttributeSet->SetMaxAdjustSuppressed(false);
+	}
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+void FACM_PlayerSnapshot::Serialize(FArchive& Ar)
+{
+
+	using namespace ACM_PlayerSnapshot;
+
+	Ar << Version;
+	if (Ar.IsLoading() && (Version == 0 || Version > CurrentVersion))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	int32 Count = 0;
+
+	if (!SerializeCount(Ar, Strings.Num(), Count))
+	{
+		return;
+	}
+
+	Strings.SetNum(Count);
+	for (FString& String : Strings)
+	{
+		Ar << String;
+	}
+
+	if (!SerializeCount(Ar, AttributeBaseValues.Num(), Count))
+	{
+		return;
+	}
+
+	AttributeBaseValues.SetNumZeroed(Count);
+	for (float& Value : AttributeBaseValues)
+	{
+		Ar << Value;
+	}
+
+	if (!SerializeCount(Ar, Abilities.Num(), Count))
+	{
+		return;
+	}
+
+	Abilities.SetNum(Count);
+	for (FAbility& Ability : Abilities)
+	{
+		SerializeIndex(Ar, Ability.ClassIndex);
+		SerializeIndex(Ar, Ability.Level);
+		SerializeIndex(Ar, Ability.InputId);
+	}
+
+	if (!SerializeCount(Ar, Effects.Num(), Count))
+	{
+		return;
+	}
+
+	Effects.SetNum(Count);
+	for (FEffect& Effect : Effects)
+	{
+
+		SerializeIndex(Ar, Effect.ClassIndex);
+		Ar << Effect.Level;
+		SerializeIndex(Ar, Effect.StackCount);
+		Ar << Effect.RemainingDuration;
+
+		if (!SerializeCount(Ar, Effect.SetByCallerMagnitudes.Num(), Count))
+		{
+			return;
+		}
+
+		Effect.SetByCallerMagnitudes.SetNum(Count);
+		for (FSetByCaller& SetByCaller : Effect.SetByCallerMagnitudes)
+		{
+			SerializeIndex(Ar, SetByCaller.TagIndex);
+			Ar << SetByCaller.Magnitude;
+		}
+
+		if (Version >= 2)
+		{
+			SerializeIndex(Ar, Effect.InstigatorIndex);
+		}
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void FACM_PlayerSnapshot::ToBytes(TArray<uint8>& OutBytes)
+{
+
+	OutBytes.Reset();
+
+	FMemoryWriter Writer(OutBytes);
+	Serialize(Writer);
+
+}
+
+//=========================================================================================================================================================
+bool FACM_PlayerSnapshot::FromBytes(const TArray<uint8>& Bytes)
+{
+
+	FMemoryReader Reader(Bytes);
+	Serialize(Reader);
+
+	if (Reader.IsError() || !HasValidIndices())
+	{
+		Reset();
+		return false;
+	}
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+bool FACM_PlayerSnapshot::HasValidIndices() const
+{
+
+	for (const FAbility& Ability : Abilities)
+	{
+		if (!Strings.IsValidIndex(Ability.ClassIndex))
+		{
+			return false;
+		}
+	}
+
+	for (const FEffect& Effect : Effects)
+	{
+
+		if (!Strings.IsValidIndex(Effect.ClassIndex) || (Effect.InstigatorIndex != INDEX_NONE && !Strings.IsValidIndex(Effect.InstigatorIndex)))
+		{
+			return false;
+		}
+
+		for (const FSetByCaller& SetByCaller : Effect.SetByCallerMagnitudes)
+		{
+			if (!Strings.IsValidIndex(SetByCaller.TagIndex))
+			{
+				return false;
+			}
+		}
+
+	}
+
+	return true;
+
+}
@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Profiling/ACM_FootprintReport.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemInterface.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/UObjectHash.h"
+#include "ArkdeCM/ArkdeCMCharacter.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+namespace ACM_Footprint
+{
+
+	static TAutoConsoleVariable<int32> CVarMaxKB(
+		TEXT("ACM.Footprint.MaxKB"),
+		256,
+		TEXT("Bytes of one freshly spawned character, in KB, above which ACM.Footprint.Check reports an error."),
+		ECVF_Default);
+
+	static TAutoConsoleVariable<int32> CVarMaxObjects(
+		TEXT("ACM.Footprint.MaxObjects"),
+		64,
+		TEXT("Objects of one freshly spawned character above which ACM.Footprint.Check reports an error."),
+		ECVF_Default);
+
+}
+
+//=========================================================================================================================================================
+static bool IsReplicatedObject(const UObject* Object)
+{
+
+	if (const AActor* Actor = Cast<AActor>(Object))
+	{
+		return Actor->GetIsReplicated();
+	}
+	else if (const UActorComponent* Component = Cast<UActorComponent>(Object))
+	{
+		return Component->GetIsReplicated();
+	}
+
+	return Object->IsSupportedForNetworking();
+
+}
+
+//=========================================================================================================================================================
+static int64 GetReplicatedPropertyBytes(UObject* Object)
+{
+
+	UClass* ObjectClass = Object->GetClass();
+	ObjectClass->SetUpRuntimeReplicationData();
+
+	int64 Bytes = 0;
+	for (const FRepRecord& Record : ObjectClass->ClassReps)
+	{
+		Bytes += Record.Property->ElementSize;
+	}
+
+	return Bytes;
+
+}
+
+//=========================================================================================================================================================
+FACM_FootprintReport FACM_FootprintReport::Build(AActor* Character)
+{
+
+	FACM_FootprintReport Report;
+
+	TArray<UObject*> Objects;
+	GetObjectsWithOuter(Character, Objects, true);
+	Objects.Add(Character);
+
+	for (UObject* Object : Objects)
+	{
+
+		FArchiveCountMem CountMem(Object);
+		const int64 Bytes = CountMem.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+		const int64 ShadowBytes = IsReplicatedObject(Object) ? GetReplicatedPropertyBytes(Object) : 0;
+
+		FClassEntry& Entry = Report.Classes.FindOrAdd(Object->GetClass()->GetFName());
+		Entry.NumObjects++;
+		Entry.Bytes += Bytes;
+		Entry.ShadowBytes += ShadowBytes;
+
+		Report.NumObjects++;
+		Report.TotalBytes += Bytes;
+		Report.TotalShadowBytes += ShadowBytes;
+
+	}
+
+	// Active effects are plain structs inside the ASC, they don't show up as objects. Their array is already part of the
+	// ASC's bytes, so this is only the breakdown of that share
+	IAbilitySystemInterface* AbilitySystemInterface = Cast<IAbilitySystemInterface>(Character);
+	UAbilitySystemComponent* AbilitySystemComponent = AbilitySystemInterface ? AbilitySystemInterface->GetAbilitySystemComponent() : nullptr;
+
+	if (IsValid(AbilitySystemComponent))
+	{
+
+		for (const FActiveGameplayEffectHandle& EffectHandle : AbilitySystemComponent->GetActiveEffects(FGameplayEffectQuery()))
+		{
+
+			const FActiveGameplayEffect* ActiveEffect = AbilitySystemComponent->GetActiveGameplayEffect(EffectHandle);
+			if (ActiveEffect != nullptr)
+			{
+				Report.NumActiveEffects++;
+				Report.ActiveEffectBytes += sizeof(FActiveGameplayEffect) + ActiveEffect->Spec.Modifiers.GetAllocatedSize() + ActiveEffect->Spec.SetByCallerTagMagnitudes.GetAllocatedSize();
+			}
+
+		}
+
+	}
+
+	Report.Classes.ValueSort([](const FClassEntry& A, const FClassEntry& B)
+	{
+		return A.Bytes > B.Bytes;
+	});
+
+	return Report;
+
+}
+
+//=========================================================================================================================================================
+void FACM_FootprintReport::Log(const FString& CharacterName) const
+{
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Footprint of %s: %d objects, %.1f KB, %.1f KB replication shadow state per connection"),
+		*CharacterName, NumObjects, TotalBytes / 1024.0f, TotalShadowBytes / 1024.0f);
+
+	for (const TPair<FName, FClassEntry>& ClassPair : Classes)
+	{
+		UE_LOG(LogArkdeCM, Display, TEXT("  %4d x %-48s %10lld bytes %8lld shadow"), ClassPair.Value.NumObjects, *ClassPair.Key.ToString(), ClassPair.Value.Bytes, ClassPair.Value.ShadowBytes);
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("  %4d x %-48s %10lld bytes (in the ASC bytes)"), NumActiveEffects, TEXT("ActiveGameplayEffect"), ActiveEffectBytes);
+
+}
+
+//=========================================================================================================================================================
+bool FACM_FootprintReport::WriteJson(const FString& Filename, const FString& CharacterName) const
+{
+
+	TArray<TSharedPtr<FJsonValue>> ClassValues;
+	for (const TPair<FName, FClassEntry>& ClassPair : Classes)
+	{
+		TSharedRef<FJsonObject> ClassObject = MakeShared<FJsonObject>();
+		ClassObject->SetStringField(TEXT("Class"), ClassPair.Key.ToString());
+		ClassObject->SetNumberField(TEXT("NumObjects"), ClassPair.Value.NumObjects);
+		ClassObject->SetNumberField(TEXT("Bytes"), ClassPair.Value.Bytes);
+		ClassObject->SetNumberField(TEXT("ShadowBytes"), ClassPair.Value.ShadowBytes);
+		ClassValues.Add(MakeShared<FJsonValueObject>(ClassObject));
+	}
+
+	TSharedRef<FJsonObject> ReportObject = MakeShared<FJsonObject>();
+	ReportObject->SetStringField(TEXT("Character"), CharacterName);
+	ReportObject->SetNumberField(TEXT("NumObjects"), NumObjects);
+	ReportObject->SetNumberField(TEXT("TotalBytes"), TotalBytes);
+	ReportObject->SetNumberField(TEXT("TotalShadowBytes"), TotalShadowBytes);
+	ReportObject->SetNumberField(TEXT("NumActiveEffects"), NumActiveEffects);
+	ReportObject->SetNumberField(TEXT("ActiveEffectBytes"), ActiveEffectBytes);
+	ReportObject->SetArrayField(TEXT("Classes"), ClassValues);
+
+	FString Contents;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Contents);
+
+	return FJsonSerializer::Serialize(ReportObject, Writer) && FFileHelper::SaveStringToFile(Contents, *Filename);
+
+}
+
+//=========================================================================================================================================================
+static AArkdeCMCharacter* SpawnFootprintCharacter(UWorld* World)
+{
+
+	AGameModeBase* GameMode = World->GetAuthGameMode();
+	if (!IsValid(GameMode))
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return Cast<AArkdeCMCharacter>(World->SpawnActor<APawn>(GameMode->DefaultPawnClass, FTransform::Identity, SpawnParameters));
+
+}
+
+//=========================================================================================================================================================
+static void ReportCharacterFootprint(const TArray<FString>& Args, UWorld* World)
+{
+
+	if (!IsValid(World))
+	{
+		return;
+	}
+
+	const FString RequestedName = Args.Num() > 0 ? Args[0] : FString();
+	const FString ReportFilename = Args.Num() > 1 ? Args[1] : FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("ACM_Footprint.json");
+
+	AArkdeCMCharacter* Character = nullptr;
+	for (TActorIterator<AArkdeCMCharacter> It(World); It; ++It)
+	{
+		if (RequestedName.IsEmpty() || It->GetName() == RequestedName)
+		{
+			Character = *It;
+			break;
+		}
+	}
+
+	// Headless runs usually have nobody connected, measure a freshly spawned default pawn instead
+	bool bSpawnedForReport = false;
+
+	if (!IsValid(Character) && RequestedName.IsEmpty())
+	{
+		Character = SpawnFootprintCharacter(World);
+		bSpawnedForReport = IsValid(Character);
+	}
+
+	if (!IsValid(Character))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Footprint: no character to measure"));
+		return;
+	}
+
+	const FACM_FootprintReport Report = FACM_FootprintReport::Build(Character);
+	Report.Log(Character->GetName());
+
+	if (!Report.WriteJson(ReportFilename, Character->GetName()))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("ACM.Footprint: could not write %s"), *ReportFilename);
+	}
+
+	if (bSpawnedForReport)
+	{
+		Character->Destroy();
+	}
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarReportCharacterFootprint(
+	TEXT("ACM.Footprint"),
+	TEXT("Logs object count, bytes per class and replication shadow size of a character. Args: [ActorName] [ReportFile]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReportCharacterFootprint));
+
+//=========================================================================================================================================================
+static void CheckCharacterFootprint(const TArray<FString>& Args, UWorld* World)
+{
+
+	// Always a fresh pawn, characters already in play carry whatever effects and abilities the match gave them
+	AArkdeCMCharacter* Character = IsValid(World) ? SpawnFootprintCharacter(World) : nullptr;
+	if (!IsValid(Character))
+	{
+		UE_LOG(LogArkdeCM, Error, TEXT("ACM.Footprint.Check needs an authoritative world with an ArkdeCM default pawn"));
+		return;
+	}
+
+	const FString CharacterName = Character->GetName();
+	const FACM_FootprintReport Report = FACM_FootprintReport::Build(Character);
+	Character->Destroy();
+
+	const int64 MaxBytes = static_cast<int64>(ACM_Footprint::CVarMaxKB.GetValueOnGameThread()) * 1024;
+	const int32 MaxObjects = ACM_Footprint::CVarMaxObjects.GetValueOnGameThread();
+
+	int32 NumOverBudget = 0;
+
+	if (Report.TotalBytes > MaxBytes)
+	{
+		NumOverBudget++;
+		UE_LOG(LogArkdeCM, Error, TEXT("  Character footprint is %.1f KB, ACM.Footprint.MaxKB is %d"), Report.TotalBytes / 1024.0f, ACM_Footprint::CVarMaxKB.GetValueOnGameThread());
+	}
+
+	if (Report.NumObjects > MaxObjects)
+	{
+		NumOverBudget++;
+		UE_LOG(LogArkdeCM, Error, TEXT("  Character has %d objects, ACM.Footprint.MaxObjects is %d"), Report.NumObjects, MaxObjects);
+	}
+
+	if (NumOverBudget > 0)
+	{
+		Report.Log(CharacterName);
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Character footprint: 2 cases, %d over budget (%d objects, %.1f KB)"), NumOverBudget, Report.NumObjects, Report.TotalBytes / 1024.0f);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarCheckCharacterFootprint(
+	TEXT("ACM.Footprint.Check"),
+	TEXT("Spawns a default pawn and reports an error when its bytes or object count exceed ACM.Footprint.MaxKB or ACM.Footprint.MaxObjects"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&CheckCharacterFootprint));
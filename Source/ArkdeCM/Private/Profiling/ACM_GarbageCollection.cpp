@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Profiling/ACM_GarbageCollection.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectArray.h"
+#include "GameplayAbility/ACM_GameplayAbility.h"
+#include "GameplayAbility/ACM_GameplayEffect.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+//=========================================================================================================================================================
+void ACM_GarbageCollection::ClusterGameplayClass(UClass* GameplayClass)
+{
+
+	// Blueprints get recompiled and reinstanced in the editor, a cluster would keep the stale class around
+	if (GIsEditor || !IsValid(GameplayClass) || GameplayClass->IsNative())
+	{
+		return;
+	}
+
+	if (!GameplayClass->IsChildOf(UACM_GameplayAbility::StaticClass()) && !GameplayClass->IsChildOf(UACM_GameplayEffect::StaticClass()))
+	{
+		return;
+	}
+
+	// Blueprint classes only cluster with gc.BlueprintClusteringEnabled, same as the engine does on load
+	if (!GameplayClass->CanBeClusterRoot())
+	{
+		return;
+	}
+
+	// Already a root, or already pulled into another cluster
+	FUObjectItem* ClassItem = GUObjectArray.ObjectToObjectItem(GameplayClass);
+	if (ClassItem->HasAnyFlags(EInternalObjectFlags::ClusterRoot) || ClassItem->GetOwnerIndex() != 0)
+	{
+		return;
+	}
+
+	// The CDO has to exist before the cluster is built or it would be left outside of it. The tuning and level caches
+	// written onto ability and effect CDOs at runtime hold plain values, no object references, so the cluster's
+	// reference list stays valid. The class is not rooted: it stays loaded only while something references it
+	GameplayClass->GetDefaultObject();
+
+	GameplayClass->CreateCluster();
+
+}
+
+//=========================================================================================================================================================
+static void MeasureGarbageCollection(const TArray<FString>& Args, UWorld* World)
+{
+
+	AGameModeBase* GameMode = IsValid(World) ? World->GetAuthGameMode() : nullptr;
+	if (!IsValid(GameMode))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("ACM.GC.Measure needs an authoritative world"));
+		return;
+	}
+
+	const int32 NumCharacters = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100;
+	const int32 NumPasses = 5;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<APawn*> SpawnedPawns;
+	for (int32 CharacterIndex = 0; CharacterIndex < NumCharacters; CharacterIndex++)
+	{
+		const FVector Location(200.0f * (CharacterIndex % 10), 200.0f * (CharacterIndex / 10), 200.0f);
+		SpawnedPawns.Add(World->SpawnActor<APawn>(GameMode->DefaultPawnClass, FTransform(Location), SpawnParameters));
+	}
+
+	double TotalMs = 0.0;
+	double WorstMs = 0.0;
+
+	for (int32 PassIndex = 0; PassIndex < NumPasses; PassIndex++)
+	{
+
+		const double PassStartSeconds = FPlatformTime::Seconds();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+		const double PassMs = (FPlatformTime::Seconds() - PassStartSeconds) * 1000.0;
+
+		TotalMs += PassMs;
+		WorstMs = FMath::Max(WorstMs, PassMs);
+
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("GC with %d extra characters: %.2fms average, %.2fms worst over %d passes (%d objects, %d clusters)"),
+		NumCharacters, TotalMs / NumPasses, WorstMs, NumPasses, GUObjectArray.GetObjectArrayNumMinusAvailable(), GUObjectClusters.GetNumAllocatedClusters());
+
+	for (APawn* SpawnedPawn : SpawnedPawns)
+	{
+		if (IsValid(SpawnedPawn))
+		{
+			SpawnedPawn->Destroy();
+		}
+	}
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarMeasureGarbageCollection(
+	TEXT("ACM.GC.Measure"),
+	TEXT("Spawns N characters (default 100) and times full garbage collections with them alive"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&MeasureGarbageCollection));
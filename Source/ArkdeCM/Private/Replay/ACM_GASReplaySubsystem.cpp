@@ -0,0 +1,876 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/ACM_GASReplaySubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "Engine/DemoNetDriver.h"
+#include "Engine/World.h"
+#include "Algo/BinarySearch.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "ArkdeCMCharacter.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "GameplayAbility/ACM_ContentId.h"
+#include "Replay/ACM_VarInt.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_CYCLE_STAT(TEXT("GAS Replay Recording"), STAT_ACM_GASReplayRecord, STATGROUP_ArkdeCM);
+DECLARE_CYCLE_STAT(TEXT("GAS Replay Playback"), STAT_ACM_GASReplayPlayback, STATGROUP_ArkdeCM);
+
+namespace ACM_GASReplay
+{
+
+	static TAutoConsoleVariable<int32> CVarCompactGAS(
+		TEXT("ACM.Replay.CompactGAS"),
+		0,
+		TEXT("Records attributes and active effects into the compact GAS stream instead of replicating them to replays.\n")
+		TEXT("Read when the replication layouts are built, set it from an ini or the command line."),
+		ECVF_ReadOnly);
+
+	static TAutoConsoleVariable<float> CVarSampleRate(
+		TEXT("ACM.Replay.GASRate"),
+		10.0f,
+		TEXT("Attribute samples per second in the compact GAS stream."),
+		ECVF_Default);
+
+	static TAutoConsoleVariable<float> CVarPrecision(
+		TEXT("ACM.Replay.GASPrecision"),
+		0.1f,
+		TEXT("Attribute values are recorded on a grid of this step."),
+		ECVF_Default);
+
+	static TAutoConsoleVariable<float> CVarChunkSeconds(
+		TEXT("ACM.Replay.GASChunkSeconds"),
+		10.0f,
+		TEXT("Length of a compact GAS stream chunk. Every chunk starts with a keyframe."),
+		ECVF_Default);
+
+	static const TCHAR* EventGroup = TEXT("ACM_GAS");
+
+	/** Version 2 added EffectStackChanged, version 1 chunks still play */
+	static const uint32 StreamVersion = 2;
+
+	/** Limit accepted when decompressing a chunk */
+	static const int32 MaxChunkBytes = 16 * 1024 * 1024;
+
+	enum class ERecordType : uint32
+	{
+		Attributes,
+		EffectStarted,
+		EffectStopped,
+		EffectStackChanged
+	};
+
+	static uint32 GetTimeMs(const UDemoNetDriver* DemoNetDriver)
+	{
+		return static_cast<uint32>(FMath::Max(DemoNetDriver->GetDemoCurrentTime(), 0.0f) * 1000.0f);
+	}
+
+	static uint32 GetActorGUID(const UDemoNetDriver* DemoNetDriver, const AActor* Actor)
+	{
+		return IsValid(Actor) ? DemoNetDriver->GetGUIDForActor(Actor).Value : 0;
+	}
+
+	static int32 Quantize(float Value, float Precision)
+	{
+		return FMath::RoundToInt(Value / Precision);
+	}
+
+}
+
+//=========================================================================================================================================================
+bool UACM_GASReplaySubsystem::IsCompactStreamEnabled()
+{
+	return ACM_GASReplay::CVarCompactGAS.GetValueOnAnyThread() != 0;
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UACM_GASReplaySubsystem::HandleWorldTickStart);
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UACM_GASReplaySubsystem::HandleWorldPreActorTick);
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::Deinitialize()
+{
+
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+
+	UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+	if (bChunkOpen && DemoNetDriver != nullptr && DemoNetDriver->IsRecording())
+	{
+		FlushChunk(DemoNetDriver);
+	}
+
+	ActorStates.Empty();
+	ChunkBuffer.Empty();
+	Chunks.Empty();
+
+	Super::Deinitialize();
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::RecordEffectStarted(UAbilitySystemComponent* AbilitySystemComponent, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle)
+{
+
+	UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+	if (!bChunkOpen || DemoNetDriver == nullptr || !Handle.IsValid() || Spec.Def == nullptr)
+	{
+		return;
+	}
+
+	const uint32 ActorGUID = ACM_GASReplay::GetActorGUID(DemoNetDriver, AbilitySystemComponent->GetAvatarActor());
+	if (ActorGUID == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_GASReplayRecord);
+
+	WriteRecordHeader(DemoNetDriver, static_cast<uint32>(ACM_GASReplay::ERecordType::EffectStarted));
+	ACM_VarInt::WriteUInt(ChunkBuffer, ActorGUID);
+	ACM_VarInt::WriteUInt(ChunkBuffer, GetTypeHash(Handle));
+	ACM_VarInt::WriteUInt(ChunkBuffer, ACM_ContentId::FromClass(Spec.Def->GetClass()));
+	ACM_VarInt::WriteUInt(ChunkBuffer, AbilitySystemComponent->GetCurrentStackCount(Handle));
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::RecordEffectStopped(UAbilitySystemComponent* AbilitySystemComponent, const FActiveGameplayEffect& Effect)
+{
+
+	UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+	if (!bChunkOpen || DemoNetDriver == nullptr)
+	{
+		return;
+	}
+
+	const uint32 ActorGUID = ACM_GASReplay::GetActorGUID(DemoNetDriver, AbilitySystemComponent->GetAvatarActor());
+	if (ActorGUID == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_GASReplayRecord);
+
+	WriteRecordHeader(DemoNetDriver, static_cast<uint32>(ACM_GASReplay::ERecordType::EffectStopped));
+	ACM_VarInt::WriteUInt(ChunkBuffer, ActorGUID);
+	ACM_VarInt::WriteUInt(ChunkBuffer, GetTypeHash(Effect.Handle));
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::RecordEffectStackChanged(UAbilitySystemComponent* AbilitySystemComponent, FActiveGameplayEffectHandle Handle, int32 NewStackCount)
+{
+
+	UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+	if (!bChunkOpen || DemoNetDriver == nullptr)
+	{
+		return;
+	}
+
+	const uint32 ActorGUID = ACM_GASReplay::GetActorGUID(DemoNetDriver, AbilitySystemComponent->GetAvatarActor());
+	if (ActorGUID == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_GASReplayRecord);
+
+	WriteRecordHeader(DemoNetDriver, static_cast<uint32>(ACM_GASReplay::ERecordType::EffectStackChanged));
+	ACM_VarInt::WriteUInt(ChunkBuffer, ActorGUID);
+	ACM_VarInt::WriteUInt(ChunkBuffer, GetTypeHash(Handle));
+	ACM_VarInt::WriteUInt(ChunkBuffer, FMath::Max(NewStackCount, 0));
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::GetReplayActiveEffects(const AActor* Avatar, TArray<TSubclassOf<UGameplayEffect>>& OutEffectClasses) const
+{
+
+	OutEffectClasses.Reset();
+
+	UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+	if (DemoNetDriver == nullptr || !DemoNetDriver->IsPlaying())
+	{
+		return;
+	}
+
+	const FActorState* ActorState = ActorStates.Find(ACM_GASReplay::GetActorGUID(DemoNetDriver, Avatar));
+	if (ActorState == nullptr)
+	{
+		return;
+	}
+
+	for (const TPair<uint32, FEffectState>& EffectPair : ActorState->Effects)
+	{
+		OutEffectClasses.Add(ACM_ContentId::FindClass(EffectPair.Value.EffectId, UGameplayEffect::StaticClass()));
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::Tick(float DeltaTime)
+{
+
+	using namespace ACM_GASReplay;
+
+	UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+
+	if (DemoNetDriver->IsPlaying())
+	{
+
+		SCOPE_CYCLE_COUNTER(STAT_ACM_GASReplayPlayback);
+
+		const double StartSeconds = FPlatformTime::Seconds();
+
+		if (!bChunksRequested)
+		{
+			RequestChunks(DemoNetDriver);
+		}
+
+		UpdatePlayback(DemoNetDriver, GetTimeMs(DemoNetDriver));
+		ApplyPlaybackState(DemoNetDriver);
+
+		PlaybackSeconds += FPlatformTime::Seconds() - StartSeconds;
+		PlayedSeconds += DeltaTime;
+		return;
+
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_GASReplayRecord);
+
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	if (!bChunkOpen)
+	{
+		BeginChunk(DemoNetDriver);
+	}
+
+	TimeSinceSample += DeltaTime;
+
+	const float SampleInterval = 1.0f / FMath::Max(CVarSampleRate.GetValueOnGameThread(), 0.1f);
+	if (TimeSinceSample >= SampleInterval)
+	{
+		TimeSinceSample = FMath::Fmod(TimeSinceSample, SampleInterval);
+		SampleAttributes(DemoNetDriver);
+	}
+
+	if (GetTimeMs(DemoNetDriver) - ChunkStartMs >= static_cast<uint32>(CVarChunkSeconds.GetValueOnGameThread() * 1000.0f))
+	{
+		FlushChunk(DemoNetDriver);
+		BeginChunk(DemoNetDriver);
+	}
+
+	RecordingSeconds += FPlatformTime::Seconds() - StartSeconds;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_GASReplaySubsystem::IsTickable() const
+{
+
+	const UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+	if (DemoNetDriver == nullptr)
+	{
+		return false;
+	}
+
+	return DemoNetDriver->IsPlaying() || (DemoNetDriver->IsRecording() && IsCompactStreamEnabled());
+
+}
+
+//=========================================================================================================================================================
+TStatId UACM_GASReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UACM_GASReplaySubsystem, STATGROUP_Tickables);
+}
+
+//=========================================================================================================================================================
+UDemoNetDriver* UACM_GASReplaySubsystem::GetDemoNetDriver() const
+{
+
+	const UWorld* World = GetWorld();
+	return IsValid(World) ? World->GetDemoNetDriver() : nullptr;
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::SampleAttributes(UDemoNetDriver* DemoNetDriver)
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = UACM_AttributeSet::GetAllAttributes();
+	const float Precision = ACM_GASReplay::CVarPrecision.GetValueOnGameThread();
+
+	TArray<uint8> Changes;
+	int32 NumChanged = 0;
+
+	for (TActorIterator<AArkdeCMCharacter> CharacterIterator(GetWorld()); CharacterIterator; ++CharacterIterator)
+	{
+
+		const AArkdeCMCharacter* Character = *CharacterIterator;
+		const uint32 ActorGUID = ACM_GASReplay::GetActorGUID(DemoNetDriver, Character);
+		if (ActorGUID == 0 || !IsValid(Character->AttributeSet))
+		{
+			continue;
+		}
+
+		// Actors that showed up after the keyframe are written in full, against zero
+		FActorState& ActorState = ActorStates.FindOrAdd(ActorGUID);
+		ActorState.Values.SetNumZeroed(AllAttributes.Num());
+
+		uint32 ChangedMask = 0;
+		int32 NewValues[32];
+
+		for (int32 AttributeIndex = 0; AttributeIndex < AllAttributes.Num() && AttributeIndex < 32; AttributeIndex++)
+		{
+
+			NewValues[AttributeIndex] = ACM_GASReplay::Quantize(AllAttributes[AttributeIndex].GetNumericValue(Character->AttributeSet), Precision);
+			if (NewValues[AttributeIndex] != ActorState.Values[AttributeIndex])
+			{
+				ChangedMask |= 1u << AttributeIndex;
+			}
+
+		}
+
+		if (ChangedMask == 0)
+		{
+			continue;
+		}
+
+		ACM_VarInt::WriteUInt(Changes, ActorGUID);
+		ACM_VarInt::WriteUInt(Changes, ChangedMask);
+
+		for (int32 AttributeIndex = 0; AttributeIndex < AllAttributes.Num() && AttributeIndex < 32; AttributeIndex++)
+		{
+			if ((ChangedMask & (1u << AttributeIndex)) != 0)
+			{
+				ACM_VarInt::WriteInt(Changes, NewValues[AttributeIndex] - ActorState.Values[AttributeIndex]);
+				ActorState.Values[AttributeIndex] = NewValues[AttributeIndex];
+			}
+		}
+
+		NumChanged++;
+
+	}
+
+	if (NumChanged == 0)
+	{
+		return;
+	}
+
+	WriteRecordHeader(DemoNetDriver, static_cast<uint32>(ACM_GASReplay::ERecordType::Attributes));
+	ACM_VarInt::WriteUInt(ChunkBuffer, NumChanged);
+	ChunkBuffer.Append(Changes);
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::BeginChunk(UDemoNetDriver* DemoNetDriver)
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = UACM_AttributeSet::GetAllAttributes();
+	const float Precision = ACM_GASReplay::CVarPrecision.GetValueOnGameThread();
+
+	ChunkStartMs = ACM_GASReplay::GetTimeMs(DemoNetDriver);
+	LastRecordMs = ChunkStartMs;
+	bChunkOpen = true;
+
+	ChunkBuffer.Reset();
+	ActorStates.Reset();
+
+	ACM_VarInt::WriteUInt(ChunkBuffer, ACM_GASReplay::StreamVersion);
+	ACM_VarInt::WriteUInt(ChunkBuffer, ChunkStartMs);
+	uint32 PrecisionBits;
+	FMemory::Memcpy(&PrecisionBits, &Precision, sizeof(PrecisionBits));
+	ACM_VarInt::WriteUInt(ChunkBuffer, PrecisionBits);
+	ACM_VarInt::WriteUInt(ChunkBuffer, AllAttributes.Num());
+
+	// Keyframe: every attribute and active effect, so a chunk can be played without the ones before it
+	TArray<uint8> Keyframe;
+	int32 NumActors = 0;
+
+	for (TActorIterator<AArkdeCMCharacter> CharacterIterator(GetWorld()); CharacterIterator; ++CharacterIterator)
+	{
+
+		const AArkdeCMCharacter* Character = *CharacterIterator;
+		const uint32 ActorGUID = ACM_GASReplay::GetActorGUID(DemoNetDriver, Character);
+		const UAbilitySystemComponent* AbilitySystemComponent = Character->GetAbilitySystemComponent();
+
+		if (ActorGUID == 0 || !IsValid(Character->AttributeSet) || !IsValid(AbilitySystemComponent))
+		{
+			continue;
+		}
+
+		FActorState& ActorState = ActorStates.Add(ActorGUID);
+		ACM_VarInt::WriteUInt(Keyframe, ActorGUID);
+
+		for (const FGameplayAttribute& Attribute : AllAttributes)
+		{
+			const int32 Value = ACM_GASReplay::Quantize(Attribute.GetNumericValue(Character->AttributeSet), Precision);
+			ActorState.Values.Add(Value);
+			ACM_VarInt::WriteInt(Keyframe, Value);
+		}
+
+		const TArray<FActiveGameplayEffectHandle> EffectHandles = AbilitySystemComponent->GetActiveEffects(FGameplayEffectQuery());
+		ACM_VarInt::WriteUInt(Keyframe, EffectHandles.Num());
+
+		for (const FActiveGameplayEffectHandle& EffectHandle : EffectHandles)
+		{
+			const FActiveGameplayEffect* ActiveEffect = AbilitySystemComponent->GetActiveGameplayEffect(EffectHandle);
+			ACM_VarInt::WriteUInt(Keyframe, GetTypeHash(EffectHandle));
+			ACM_VarInt::WriteUInt(Keyframe, ActiveEffect != nullptr && ActiveEffect->Spec.Def != nullptr ? ACM_ContentId::FromClass(ActiveEffect->Spec.Def->GetClass()) : 0);
+			ACM_VarInt::WriteUInt(Keyframe, AbilitySystemComponent->GetCurrentStackCount(EffectHandle));
+		}
+
+		NumActors++;
+
+	}
+
+	ACM_VarInt::WriteUInt(ChunkBuffer, NumActors);
+	ChunkBuffer.Append(Keyframe);
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::FlushChunk(UDemoNetDriver* DemoNetDriver)
+{
+
+	bChunkOpen = false;
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, ChunkBuffer.Num());
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+
+	if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, ChunkBuffer.GetData(), ChunkBuffer.Num()))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Could not compress a GAS replay chunk of %d bytes, it is dropped"), ChunkBuffer.Num());
+		return;
+	}
+
+	TArray<uint8> EventData;
+	FMemoryWriter Writer(EventData);
+
+	int32 UncompressedSize = ChunkBuffer.Num();
+	Writer << UncompressedSize;
+	Writer.Serialize(Compressed.GetData(), CompressedSize);
+
+	DemoNetDriver->AddEvent(ACM_GASReplay::EventGroup, FString::Printf(TEXT("%u"), ChunkStartMs), EventData);
+
+	RecordedBytes += EventData.Num();
+	RecordedChunks++;
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::WriteRecordHeader(UDemoNetDriver* DemoNetDriver, uint32 RecordType)
+{
+
+	const uint32 TimeMs = FMath::Max(ACM_GASReplay::GetTimeMs(DemoNetDriver), LastRecordMs);
+
+	ACM_VarInt::WriteUInt(ChunkBuffer, TimeMs - LastRecordMs);
+	ACM_VarInt::WriteUInt(ChunkBuffer, RecordType);
+
+	LastRecordMs = TimeMs;
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::RequestChunks(UDemoNetDriver* DemoNetDriver)
+{
+
+	bChunksRequested = true;
+
+	TWeakObjectPtr<UACM_GASReplaySubsystem> WeakThis(this);
+	DemoNetDriver->EnumerateEvents(ACM_GASReplay::EventGroup, [WeakThis](const FEnumerateEventsResult& Result)
+	{
+
+		UDemoNetDriver* CurrentDemoNetDriver = WeakThis.IsValid() ? WeakThis->GetDemoNetDriver() : nullptr;
+		if (CurrentDemoNetDriver == nullptr || !Result.WasSuccessful())
+		{
+			return;
+		}
+
+		for (const FReplayEventListItem& Event : Result.ReplayEventList.ReplayEvents)
+		{
+			CurrentDemoNetDriver->RequestEventData(Event.ID, [WeakThis](const FRequestEventDataResult& DataResult)
+			{
+				if (WeakThis.IsValid() && DataResult.WasSuccessful())
+				{
+					WeakThis->AddChunk(DataResult.ReplayEventListItem);
+				}
+			});
+		}
+
+	});
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::AddChunk(const TArray<uint8>& EventData)
+{
+
+	FMemoryReader HeaderReader(EventData);
+
+	int32 UncompressedSize = 0;
+	HeaderReader << UncompressedSize;
+
+	if (HeaderReader.IsError() || UncompressedSize <= 0 || UncompressedSize > ACM_GASReplay::MaxChunkBytes)
+	{
+		return;
+	}
+
+	const int32 HeaderSize = static_cast<int32>(HeaderReader.Tell());
+
+	FChunk Chunk;
+	Chunk.Payload.SetNumUninitialized(UncompressedSize);
+
+	if (!FCompression::UncompressMemory(NAME_Zlib, Chunk.Payload.GetData(), UncompressedSize, EventData.GetData() + HeaderSize, EventData.Num() - HeaderSize))
+	{
+		return;
+	}
+
+	ACM_VarInt::FReader Reader(Chunk.Payload.GetData(), Chunk.Payload.Num());
+	const uint32 Version = Reader.ReadUInt();
+	if (Version == 0 || Version > ACM_GASReplay::StreamVersion)
+	{
+		return;
+	}
+
+	Chunk.StartMs = Reader.ReadUInt();
+
+	const int32 InsertIndex = Algo::UpperBoundBy(Chunks, Chunk.StartMs, &FChunk::StartMs);
+	Chunks.Insert(MoveTemp(Chunk), InsertIndex);
+
+	// Chunks arrive in any order, rebuild from the right keyframe on the next update
+	PlaybackChunk = INDEX_NONE;
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::UpdatePlayback(UDemoNetDriver* DemoNetDriver, uint32 TimeMs)
+{
+
+	using namespace ACM_GASReplay;
+
+	const int32 ChunkIndex = Algo::UpperBoundBy(Chunks, TimeMs, &FChunk::StartMs) - 1;
+	if (ChunkIndex < 0)
+	{
+		return;
+	}
+
+	const FChunk& Chunk = Chunks[ChunkIndex];
+	ACM_VarInt::FReader Reader(Chunk.Payload.GetData(), Chunk.Payload.Num());
+
+	// Scrubbing back or into another chunk restarts from that chunk's keyframe
+	if (ChunkIndex != PlaybackChunk || TimeMs < PlaybackTimeMs)
+	{
+
+		ActorStates.Reset();
+
+		Reader.ReadUInt();
+		Reader.ReadUInt();
+		const uint32 PrecisionBits = Reader.ReadUInt();
+		FMemory::Memcpy(&PlaybackPrecision, &PrecisionBits, sizeof(PlaybackPrecision));
+		PlaybackNumAttributes = static_cast<int32>(Reader.ReadUInt());
+
+		if (Reader.bError || PlaybackNumAttributes > 32)
+		{
+			return;
+		}
+
+		const uint32 NumActors = Reader.ReadUInt();
+		for (uint32 ActorIndex = 0; ActorIndex < NumActors && !Reader.bError; ActorIndex++)
+		{
+
+			FActorState& ActorState = ActorStates.Add(Reader.ReadUInt());
+			ActorState.bDirty = true;
+
+			for (int32 AttributeIndex = 0; AttributeIndex < PlaybackNumAttributes && !Reader.bError; AttributeIndex++)
+			{
+				ActorState.Values.Add(Reader.ReadInt());
+			}
+
+			const uint32 NumEffects = Reader.ReadUInt();
+			for (uint32 EffectIndex = 0; EffectIndex < NumEffects && !Reader.bError; EffectIndex++)
+			{
+				const uint32 EffectHandle = Reader.ReadUInt();
+				FEffectState& EffectState = ActorState.Effects.Add(EffectHandle);
+				EffectState.EffectId = Reader.ReadUInt();
+				EffectState.StackCount = static_cast<int32>(Reader.ReadUInt());
+			}
+
+		}
+
+		PlaybackChunk = ChunkIndex;
+		PlaybackPosition = Reader.Position;
+		PlaybackRecordMs = Chunk.StartMs;
+
+	}
+
+	PlaybackTimeMs = TimeMs;
+	Reader.Position = PlaybackPosition;
+
+	while (!Reader.AtEnd())
+	{
+
+		const uint32 RecordMs = PlaybackRecordMs + Reader.ReadUInt();
+		if (RecordMs > TimeMs)
+		{
+			break;
+		}
+
+		const ERecordType RecordType = static_cast<ERecordType>(Reader.ReadUInt());
+		const uint32 ActorGUID = RecordType == ERecordType::Attributes ? 0 : Reader.ReadUInt();
+
+		switch (RecordType)
+		{
+
+		case ERecordType::Attributes:
+		{
+
+			const uint32 NumActors = Reader.ReadUInt();
+			for (uint32 ActorIndex = 0; ActorIndex < NumActors && !Reader.bError; ActorIndex++)
+			{
+
+				FActorState& ActorState = ActorStates.FindOrAdd(Reader.ReadUInt());
+				ActorState.Values.SetNumZeroed(PlaybackNumAttributes);
+				ActorState.bDirty = true;
+
+				const uint32 ChangedMask = Reader.ReadUInt();
+				for (int32 AttributeIndex = 0; AttributeIndex < PlaybackNumAttributes && AttributeIndex < 32; AttributeIndex++)
+				{
+					if ((ChangedMask & (1u << AttributeIndex)) != 0)
+					{
+						ActorState.Values[AttributeIndex] += Reader.ReadInt();
+					}
+				}
+
+			}
+
+			break;
+
+		}
+
+		case ERecordType::EffectStarted:
+		{
+
+			const uint32 EffectHandle = Reader.ReadUInt();
+			FEffectState& EffectState = ActorStates.FindOrAdd(ActorGUID).Effects.FindOrAdd(EffectHandle);
+			EffectState.EffectId = Reader.ReadUInt();
+			EffectState.StackCount = static_cast<int32>(Reader.ReadUInt());
+
+			OnReplayEffectEvent.Broadcast(DemoNetDriver->GetActorForGUID(FNetworkGUID(ActorGUID)), ACM_ContentId::FindClass(EffectState.EffectId, UGameplayEffect::StaticClass()), EffectState.StackCount, true);
+			break;
+
+		}
+
+		case ERecordType::EffectStopped:
+		{
+
+			FEffectState EffectState;
+			FActorState* ActorState = ActorStates.Find(ActorGUID);
+
+			if (ActorState != nullptr && ActorState->Effects.RemoveAndCopyValue(Reader.ReadUInt(), EffectState))
+			{
+				OnReplayEffectEvent.Broadcast(DemoNetDriver->GetActorForGUID(FNetworkGUID(ActorGUID)), ACM_ContentId::FindClass(EffectState.EffectId, UGameplayEffect::StaticClass()), 0, false);
+			}
+
+			break;
+
+		}
+
+		case ERecordType::EffectStackChanged:
+		{
+
+			const uint32 EffectHandle = Reader.ReadUInt();
+			const int32 StackCount = static_cast<int32>(Reader.ReadUInt());
+
+			FActorState* ActorState = ActorStates.Find(ActorGUID);
+			FEffectState* EffectState = ActorState != nullptr ? ActorState->Effects.Find(EffectHandle) : nullptr;
+
+			if (EffectState != nullptr && EffectState->StackCount != StackCount)
+			{
+				EffectState->StackCount = StackCount;
+				OnReplayEffectEvent.Broadcast(DemoNetDriver->GetActorForGUID(FNetworkGUID(ActorGUID)), ACM_ContentId::FindClass(EffectState->EffectId, UGameplayEffect::StaticClass()), StackCount, true);
+			}
+
+			break;
+
+		}
+
+		default:
+			Reader.bError = true;
+			break;
+
+		}
+
+		if (Reader.bError)
+		{
+			UE_LOG(LogArkdeCM, Warning, TEXT("GAS replay chunk at %u ms is corrupt, playback of it stops here"), Chunk.StartMs);
+			PlaybackPosition = Chunk.Payload.Num();
+			return;
+		}
+
+		PlaybackRecordMs = RecordMs;
+		PlaybackPosition = Reader.Position;
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::ApplyPlaybackState(UDemoNetDriver* DemoNetDriver)
+{
+
+	const TArray<FGameplayAttribute>& AllAttributes = UACM_AttributeSet::GetAllAttributes();
+	const int32 NumAttributes = FMath::Min(AllAttributes.Num(), PlaybackNumAttributes);
+
+	for (TPair<uint32, FActorState>& ActorPair : ActorStates)
+	{
+
+		FActorState& ActorState = ActorPair.Value;
+		if (!ActorState.bDirty)
+		{
+			continue;
+		}
+
+		// Not spawned by the replay yet, retried next frame
+		const AArkdeCMCharacter* Character = Cast<AArkdeCMCharacter>(DemoNetDriver->GetActorForGUID(FNetworkGUID(ActorPair.Key)));
+		UACM_AttributeSet* AttributeSet = IsValid(Character) ? Character->AttributeSet : nullptr;
+		if (!IsValid(AttributeSet))
+		{
+			continue;
+		}
+
+		// Recorded values are final, going through the ASC would rescale resources again on every Max change
+		for (int32 AttributeIndex = 0; AttributeIndex < NumAttributes && AttributeIndex < ActorState.Values.Num(); AttributeIndex++)
+		{
+			const float Value = ActorState.Values[AttributeIndex] * PlaybackPrecision;
+			AttributeSet->WriteAttributeValue(AllAttributes[AttributeIndex], Value, Value);
+		}
+
+		ActorState.bDirty = false;
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World == GetWorld())
+	{
+		DispatchStartSeconds = FPlatformTime::Seconds();
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_GASReplaySubsystem::HandleWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+
+	if (World != GetWorld() || DispatchStartSeconds == 0.0)
+	{
+		return;
+	}
+
+	const UDemoNetDriver* DemoNetDriver = GetDemoNetDriver();
+	if (DemoNetDriver != nullptr && DemoNetDriver->IsPlaying())
+	{
+		DemoDispatchSeconds += FPlatformTime::Seconds() - DispatchStartSeconds;
+	}
+
+	DispatchStartSeconds = 0.0;
+
+}
+
+//=========================================================================================================================================================
+static void LogGASReplayStats(const TArray<FString>& Args, UWorld* World)
+{
+
+	UACM_GASReplaySubsystem* GASReplaySubsystem = IsValid(World) ? World->GetSubsystem<UACM_GASReplaySubsystem>() : nullptr;
+	UDemoNetDriver* DemoNetDriver = IsValid(World) ? World->GetDemoNetDriver() : nullptr;
+
+	if (!IsValid(GASReplaySubsystem) || DemoNetDriver == nullptr || (!DemoNetDriver->IsRecording() && !DemoNetDriver->IsPlaying()))
+	{
+		UE_LOG(LogArkdeCM, Display, TEXT("No replay is being recorded or played"));
+		return;
+	}
+
+	if (DemoNetDriver->IsPlaying())
+	{
+
+		const double PlayedMinutes = GASReplaySubsystem->GetPlayedSeconds() / 60.0;
+		const double SessionScale = PlayedMinutes > 0.0 ? 30.0 / PlayedMinutes : 0.0;
+
+		UE_LOG(LogArkdeCM, Display, TEXT("Replay playback, compact GAS stream %s: %.1f min played, %.2f ms demo dispatch, %.2f ms compact stream. Projected for 30 min: %.1f ms, %.1f ms"),
+			UACM_GASReplaySubsystem::IsCompactStreamEnabled() ? TEXT("on") : TEXT("off"), PlayedMinutes,
+			GASReplaySubsystem->GetDemoDispatchSeconds() * 1000.0, GASReplaySubsystem->GetPlaybackSeconds() * 1000.0,
+			GASReplaySubsystem->GetDemoDispatchSeconds() * 1000.0 * SessionScale, GASReplaySubsystem->GetPlaybackSeconds() * 1000.0 * SessionScale);
+		return;
+
+	}
+
+	const float RecordedMinutes = DemoNetDriver->GetDemoCurrentTime() / 60.0f;
+	const float SessionScale = RecordedMinutes > 0.0f ? 30.0f / RecordedMinutes : 0.0f;
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Compact GAS stream %s: %lld bytes in %d chunks over %.1f min, %.2f ms recording. Projected for 30 min: %.1f KB, %.1f ms"),
+		UACM_GASReplaySubsystem::IsCompactStreamEnabled() ? TEXT("on") : TEXT("off"),
+		GASReplaySubsystem->GetRecordedBytes(), GASReplaySubsystem->GetRecordedChunks(), RecordedMinutes, GASReplaySubsystem->GetRecordingSeconds() * 1000.0,
+		GASReplaySubsystem->GetRecordedBytes() * SessionScale / 1024.0f, GASReplaySubsystem->GetRecordingSeconds() * 1000.0 * SessionScale);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarLogGASReplayStats(
+	TEXT("ACM.Replay.GASStats"),
+	TEXT("While recording, logs the size and recording cost of the compact GAS stream. While playing, logs the demo dispatch and compact stream playback cost. Both are projected to a 30 minute session."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LogGASReplayStats));
+
+//=========================================================================================================================================================
+static void CompareGASReplays(const TArray<FString>& Args, UWorld* World)
+{
+
+	if (Args.Num() < 2)
+	{
+		UE_LOG(LogArkdeCM, Display, TEXT("Usage: ACM.Replay.GASCompare <RegularReplay> <CompactReplay> [Minutes], both recorded from the same session"));
+		return;
+	}
+
+	// Where the local file replay streamer writes, under the replay name passed to demorec
+	const FString DemoDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Demos"));
+	const int64 RegularBytes = IFileManager::Get().FileSize(*FPaths::Combine(DemoDir, Args[0] + TEXT(".replay")));
+	const int64 CompactBytes = IFileManager::Get().FileSize(*FPaths::Combine(DemoDir, Args[1] + TEXT(".replay")));
+
+	if (RegularBytes <= 0 || CompactBytes <= 0)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Replay %s not found in %s"), RegularBytes <= 0 ? *Args[0] : *Args[1], *DemoDir);
+		return;
+	}
+
+	const float Minutes = Args.Num() > 2 ? FMath::Max(FCString::Atof(*Args[2]), 0.1f) : 30.0f;
+	const float SessionScale = 30.0f / Minutes;
+
+	UE_LOG(LogArkdeCM, Display, TEXT("GAS replay comparison over %.1f min: regular %.1f KB, compact %.1f KB (%.1f%%). Projected for 30 min: %.1f KB, %.1f KB"),
+		Minutes, RegularBytes / 1024.0f, CompactBytes / 1024.0f, 100.0f * CompactBytes / RegularBytes,
+		RegularBytes * SessionScale / 1024.0f, CompactBytes * SessionScale / 1024.0f);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarCompareGASReplays(
+	TEXT("ACM.Replay.GASCompare"),
+	TEXT("Compares the file size of a regular and a compact GAS replay of the same session, recorded over Minutes (default 30)."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&CompareGASReplays));
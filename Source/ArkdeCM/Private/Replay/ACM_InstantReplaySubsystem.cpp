@@ -0,0 +1,621 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/ACM_InstantReplaySubsystem.h"
+#include "Abilities/GameplayAbility.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "ArkdeCMCharacter.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+#include "GameplayAbility/ACM_ContentId.h"
+#include "Replay/ACM_VarInt.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+DECLARE_CYCLE_STAT(TEXT("Instant Replay Capture"), STAT_ACM_ReplayCapture, STATGROUP_ArkdeCM);
+DECLARE_MEMORY_STAT(TEXT("Instant Replay Buffer"), STAT_ACM_ReplayMemory, STATGROUP_ArkdeCM);
+
+namespace ACM_InstantReplay
+{
+
+	static TAutoConsoleVariable<float> CVarReplayRate(
+		TEXT("ACM.Replay.Rate"),
+		15.0f,
+		TEXT("Instant replay frames recorded per second on the server, 0 disables recording."),
+		ECVF_Default);
+
+	static TAutoConsoleVariable<float> CVarKeyframeInterval(
+		TEXT("ACM.Replay.KeyframeInterval"),
+		1.0f,
+		TEXT("Seconds between instant replay keyframes, clips start at a keyframe."),
+		ECVF_Default);
+
+	static TAutoConsoleVariable<int32> CVarMemoryKB(
+		TEXT("ACM.Replay.MemoryKB"),
+		1024,
+		TEXT("Size of the instant replay ring buffer. Oldest frames are dropped when it is full."),
+		ECVF_Default);
+
+	static const uint32 ClipMagic = 0x52434D41; // "ACMR"
+	static const uint32 ClipVersion = 1;
+
+	/** Location X/Y/Z, yaw, health, mana, stamina */
+	static const int32 NumIntColumns = 7;
+
+	/** Per frame cap on recorded ability activations, keeps frames bounded */
+	static const int32 MaxAbilityEventsPerFrame = 256;
+
+	/** Limit accepted when decoding, well above what the ring can hold */
+	static const int32 MaxClipBytes = 64 * 1024 * 1024;
+
+	static int32 GetColumn(const UACM_InstantReplaySubsystem::FSample& Sample, int32 Column)
+	{
+		switch (Column)
+		{
+		case 0: return Sample.Location[0];
+		case 1: return Sample.Location[1];
+		case 2: return Sample.Location[2];
+		case 3: return Sample.Yaw;
+		case 4: return Sample.Health;
+		case 5: return Sample.Mana;
+		default: return Sample.Stamina;
+		}
+	}
+
+	static void SetColumn(UACM_InstantReplaySubsystem::FSample& Sample, int32 Column, int32 Value)
+	{
+		switch (Column)
+		{
+		case 0: Sample.Location[0] = Value; break;
+		case 1: Sample.Location[1] = Value; break;
+		case 2: Sample.Location[2] = Value; break;
+		case 3: Sample.Yaw = Value; break;
+		case 4: Sample.Health = Value; break;
+		case 5: Sample.Mana = Value; break;
+		default: Sample.Stamina = Value; break;
+		}
+	}
+
+	static int32 QuantizePercent(float Value, float MaxValue)
+	{
+		return MaxValue > 0.0f ? FMath::Clamp(FMath::RoundToInt(255.0f * Value / MaxValue), 0, 255) : 0;
+	}
+
+	/** Index of the same character in Previous for every sample, both sorted by id. INDEX_NONE for keyframes */
+	static void FindBases(const TArray<UACM_InstantReplaySubsystem::FSample>& Current, const TArray<UACM_InstantReplaySubsystem::FSample>& Previous, bool bKeyframe, TArray<int32>& OutBases)
+	{
+
+		OutBases.Reset(Current.Num());
+
+		int32 PreviousIndex = 0;
+		for (const UACM_InstantReplaySubsystem::FSample& Sample : Current)
+		{
+
+			while (!bKeyframe && PreviousIndex < Previous.Num() && Previous[PreviousIndex].CharacterId < Sample.CharacterId)
+			{
+				PreviousIndex++;
+			}
+
+			const bool bHasBase = !bKeyframe && PreviousIndex < Previous.Num() && Previous[PreviousIndex].CharacterId == Sample.CharacterId;
+			OutBases.Add(bHasBase ? PreviousIndex : INDEX_NONE);
+
+		}
+
+	}
+
+	static void EncodeFrame(const TArray<UACM_InstantReplaySubsystem::FSample>& Current, const TArray<UACM_InstantReplaySubsystem::FSample>& Previous, const TArray<UACM_InstantReplaySubsystem::FAbilityEvent>& AbilityEvents, bool bKeyframe, TArray<uint8>& Out)
+	{
+
+		Out.Reset();
+
+		TArray<int32> Bases;
+		FindBases(Current, Previous, bKeyframe, Bases);
+
+		ACM_VarInt::WriteUInt(Out, Current.Num());
+
+		int32 PreviousId = 0;
+		for (const UACM_InstantReplaySubsystem::FSample& Sample : Current)
+		{
+			ACM_VarInt::WriteUInt(Out, static_cast<uint32>(Sample.CharacterId - PreviousId));
+			PreviousId = Sample.CharacterId;
+		}
+
+		for (int32 Column = 0; Column < NumIntColumns; Column++)
+		{
+			for (int32 SampleIndex = 0; SampleIndex < Current.Num(); SampleIndex++)
+			{
+				const int32 Base = Bases[SampleIndex] != INDEX_NONE ? GetColumn(Previous[Bases[SampleIndex]], Column) : 0;
+				ACM_VarInt::WriteInt(Out, GetColumn(Current[SampleIndex], Column) - Base);
+			}
+		}
+
+		for (int32 SampleIndex = 0; SampleIndex < Current.Num(); SampleIndex++)
+		{
+			const uint32 Base = Bases[SampleIndex] != INDEX_NONE ? Previous[Bases[SampleIndex]].PublicTagBits : 0;
+			ACM_VarInt::WriteUInt(Out, Current[SampleIndex].PublicTagBits ^ Base);
+		}
+
+		ACM_VarInt::WriteUInt(Out, AbilityEvents.Num());
+		for (const UACM_InstantReplaySubsystem::FAbilityEvent& AbilityEvent : AbilityEvents)
+		{
+			ACM_VarInt::WriteUInt(Out, static_cast<uint32>(AbilityEvent.CharacterId));
+			ACM_VarInt::WriteUInt(Out, AbilityEvent.AbilityId);
+		}
+
+	}
+
+	static bool DecodeFrame(ACM_VarInt::FReader& Reader, const TArray<UACM_InstantReplaySubsystem::FSample>& Previous, bool bKeyframe, TArray<UACM_InstantReplaySubsystem::FSample>& OutCurrent, TArray<UACM_InstantReplaySubsystem::FAbilityEvent>& OutAbilityEvents)
+	{
+
+		const uint32 NumSamples = Reader.ReadUInt();
+		if (Reader.bError || NumSamples > static_cast<uint32>(Reader.Num))
+		{
+			return false;
+		}
+
+		OutCurrent.SetNumZeroed(NumSamples);
+
+		int32 PreviousId = 0;
+		for (UACM_InstantReplaySubsystem::FSample& Sample : OutCurrent)
+		{
+			Sample.CharacterId = PreviousId + static_cast<int32>(Reader.ReadUInt());
+			PreviousId = Sample.CharacterId;
+		}
+
+		TArray<int32> Bases;
+		FindBases(OutCurrent, Previous, bKeyframe, Bases);
+
+		for (int32 Column = 0; Column < NumIntColumns; Column++)
+		{
+			for (uint32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+			{
+				const int32 Base = Bases[SampleIndex] != INDEX_NONE ? GetColumn(Previous[Bases[SampleIndex]], Column) : 0;
+				SetColumn(OutCurrent[SampleIndex], Column, Base + Reader.ReadInt());
+			}
+		}
+
+		for (uint32 SampleIndex = 0; SampleIndex < NumSamples; SampleIndex++)
+		{
+			const uint32 Base = Bases[SampleIndex] != INDEX_NONE ? Previous[Bases[SampleIndex]].PublicTagBits : 0;
+			OutCurrent[SampleIndex].PublicTagBits = Reader.ReadUInt() ^ Base;
+		}
+
+		const uint32 NumAbilityEvents = Reader.ReadUInt();
+		if (Reader.bError || NumAbilityEvents > static_cast<uint32>(MaxAbilityEventsPerFrame))
+		{
+			return false;
+		}
+
+		OutAbilityEvents.SetNumZeroed(NumAbilityEvents);
+		for (UACM_InstantReplaySubsystem::FAbilityEvent& AbilityEvent : OutAbilityEvents)
+		{
+			AbilityEvent.CharacterId = static_cast<int32>(Reader.ReadUInt());
+			AbilityEvent.AbilityId = Reader.ReadUInt();
+		}
+
+		return !Reader.bError;
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_InstantReplaySubsystem::Deinitialize()
+{
+
+	DEC_MEMORY_STAT_BY(STAT_ACM_ReplayMemory, Ring.GetAllocatedSize());
+
+	Ring.Empty();
+	FrameRing.Empty();
+	FirstFrameSlot = 0;
+	NumBufferedFrames = 0;
+	PreviousSamples.Empty();
+	PendingAbilityEvents.Empty();
+
+	Super::Deinitialize();
+
+}
+
+//=========================================================================================================================================================
+void UACM_InstantReplaySubsystem::RecordAbilityActivation(const AActor* Avatar, const UGameplayAbility* Ability)
+{
+
+	if (!IsTickable() || !IsValid(Avatar) || Ability == nullptr || PendingAbilityEvents.Num() >= ACM_InstantReplay::MaxAbilityEventsPerFrame)
+	{
+		return;
+	}
+
+	PendingAbilityEvents.Add({ static_cast<int32>(Avatar->GetUniqueID()), ACM_ContentId::FromClass(Ability->GetClass()) });
+
+}
+
+//=========================================================================================================================================================
+bool UACM_InstantReplaySubsystem::ExtractClip(float Seconds, TArray<uint8>& OutClip) const
+{
+
+	using namespace ACM_InstantReplay;
+
+	OutClip.Reset();
+
+	if (NumBufferedFrames == 0)
+	{
+		return false;
+	}
+
+	// Never more than the buffer holds, so a bogus request cannot ask for an unbounded window
+	Seconds = FMath::Clamp(Seconds, 0.0f, GetBufferedSeconds());
+
+	// Start at the last keyframe that still covers the requested window
+	const float StartTime = GetFrame(NumBufferedFrames - 1).Time - Seconds;
+	int32 FirstFrame = 0;
+	for (int32 FrameIndex = 0; FrameIndex < NumBufferedFrames && GetFrame(FrameIndex).Time <= StartTime; FrameIndex++)
+	{
+		if (GetFrame(FrameIndex).bKeyframe)
+		{
+			FirstFrame = FrameIndex;
+		}
+	}
+
+	TArray<uint8> Payload;
+	ACM_VarInt::WriteUInt(Payload, ClipVersion);
+	ACM_VarInt::WriteUInt(Payload, NumBufferedFrames - FirstFrame);
+
+	const float FirstFrameTime = GetFrame(FirstFrame).Time;
+
+	for (int32 FrameIndex = FirstFrame; FrameIndex < NumBufferedFrames; FrameIndex++)
+	{
+
+		const FFrameInfo& Frame = GetFrame(FrameIndex);
+
+		ACM_VarInt::WriteUInt(Payload, static_cast<uint32>(FMath::RoundToInt((Frame.Time - FirstFrameTime) * 1000.0f)));
+		ACM_VarInt::WriteUInt(Payload, Frame.bKeyframe ? 1 : 0);
+		ACM_VarInt::WriteUInt(Payload, Frame.Size);
+
+		const int32 FrameStart = Payload.AddUninitialized(Frame.Size);
+		ReadFromRing(Frame.Offset, Frame.Size, Payload.GetData() + FrameStart);
+
+	}
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Payload.Num());
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+
+	if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Payload.GetData(), Payload.Num()))
+	{
+		return false;
+	}
+
+	FMemoryWriter Writer(OutClip);
+
+	uint32 Magic = ClipMagic;
+	int32 UncompressedSize = Payload.Num();
+	Writer << Magic << UncompressedSize;
+	Writer.Serialize(Compressed.GetData(), CompressedSize);
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+bool UACM_InstantReplaySubsystem::DecodeClip(const TArray<uint8>& Clip, TArray<FACM_ReplayFrame>& OutFrames)
+{
+
+	using namespace ACM_InstantReplay;
+
+	OutFrames.Reset();
+
+	FMemoryReader HeaderReader(Clip);
+
+	uint32 Magic = 0;
+	int32 UncompressedSize = 0;
+	HeaderReader << Magic << UncompressedSize;
+
+	if (HeaderReader.IsError() || Magic != ClipMagic || UncompressedSize <= 0 || UncompressedSize > MaxClipBytes)
+	{
+		return false;
+	}
+
+	const int32 HeaderSize = static_cast<int32>(HeaderReader.Tell());
+
+	TArray<uint8> Payload;
+	Payload.SetNumUninitialized(UncompressedSize);
+
+	if (!FCompression::UncompressMemory(NAME_Zlib, Payload.GetData(), UncompressedSize, Clip.GetData() + HeaderSize, Clip.Num() - HeaderSize))
+	{
+		return false;
+	}
+
+	ACM_VarInt::FReader Reader(Payload.GetData(), Payload.Num());
+	if (Reader.ReadUInt() != ClipVersion)
+	{
+		return false;
+	}
+
+	const uint32 NumFrames = Reader.ReadUInt();
+
+	TArray<FSample> PreviousSamples;
+	TArray<FSample> Samples;
+	TArray<FAbilityEvent> AbilityEvents;
+
+	for (uint32 FrameIndex = 0; FrameIndex < NumFrames && !Reader.bError; FrameIndex++)
+	{
+
+		const float Time = Reader.ReadUInt() / 1000.0f;
+		const bool bKeyframe = Reader.ReadUInt() != 0;
+		const int32 FrameSize = static_cast<int32>(Reader.ReadUInt());
+
+		if (Reader.bError || FrameSize < 0 || Reader.Position + FrameSize > Reader.Num || (FrameIndex == 0 && !bKeyframe))
+		{
+			return false;
+		}
+
+		ACM_VarInt::FReader FrameReader(Reader.Data + Reader.Position, FrameSize);
+		Reader.Position += FrameSize;
+
+		if (!DecodeFrame(FrameReader, PreviousSamples, bKeyframe, Samples, AbilityEvents))
+		{
+			return false;
+		}
+
+		FACM_ReplayFrame& Frame = OutFrames.AddDefaulted_GetRef();
+		Frame.Time = Time;
+
+		for (const FSample& Sample : Samples)
+		{
+			FACM_ReplayCharacterFrame& CharacterFrame = Frame.Characters.AddDefaulted_GetRef();
+			CharacterFrame.CharacterId = Sample.CharacterId;
+			CharacterFrame.Location = FVector(Sample.Location[0], Sample.Location[1], Sample.Location[2]);
+			CharacterFrame.Yaw = FRotator::DecompressAxisFromByte(static_cast<uint8>(Sample.Yaw));
+			CharacterFrame.HealthPercent = Sample.Health / 255.0f;
+			CharacterFrame.ManaPercent = Sample.Mana / 255.0f;
+			CharacterFrame.StaminaPercent = Sample.Stamina / 255.0f;
+			CharacterFrame.PublicTagBits = static_cast<int32>(Sample.PublicTagBits);
+		}
+
+		for (const FAbilityEvent& AbilityEvent : AbilityEvents)
+		{
+			FACM_ReplayAbilityEvent& ReplayEvent = Frame.AbilityEvents.AddDefaulted_GetRef();
+			ReplayEvent.CharacterId = AbilityEvent.CharacterId;
+			ReplayEvent.AbilityClass = ACM_ContentId::FindClass(AbilityEvent.AbilityId, UGameplayAbility::StaticClass());
+		}
+
+		Swap(PreviousSamples, Samples);
+
+	}
+
+	return !Reader.bError;
+
+}
+
+//=========================================================================================================================================================
+float UACM_InstantReplaySubsystem::GetBufferedSeconds() const
+{
+	return NumBufferedFrames > 0 ? GetFrame(NumBufferedFrames - 1).Time - GetFrame(0).Time : 0.0f;
+}
+
+//=========================================================================================================================================================
+void UACM_InstantReplaySubsystem::Tick(float DeltaTime)
+{
+
+	const float Rate = ACM_InstantReplay::CVarReplayRate.GetValueOnGameThread();
+
+	TimeSinceCapture += DeltaTime;
+	TimeSinceKeyframe += DeltaTime;
+
+	if (TimeSinceCapture >= 1.0f / Rate)
+	{
+		TimeSinceCapture = FMath::Fmod(TimeSinceCapture, 1.0f / Rate);
+		CaptureFrame();
+	}
+
+}
+
+//=========================================================================================================================================================
+bool UACM_InstantReplaySubsystem::IsTickable() const
+{
+
+	const UWorld* World = GetWorld();
+	return IsValid(World) && World->GetNetMode() != NM_Client && World->HasBegunPlay() && ACM_InstantReplay::CVarReplayRate.GetValueOnGameThread() > 0.0f;
+
+}
+
+//=========================================================================================================================================================
+TStatId UACM_InstantReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UACM_InstantReplaySubsystem, STATGROUP_Tickables);
+}
+
+//=========================================================================================================================================================
+void UACM_InstantReplaySubsystem::CaptureFrame()
+{
+
+	using namespace ACM_InstantReplay;
+
+	SCOPE_CYCLE_COUNTER(STAT_ACM_ReplayCapture);
+
+	// A resized buffer starts over
+	const int32 RingSize = FMath::Max(CVarMemoryKB.GetValueOnGameThread(), 1) * 1024;
+	if (Ring.Num() != RingSize)
+	{
+		DEC_MEMORY_STAT_BY(STAT_ACM_ReplayMemory, Ring.GetAllocatedSize());
+		Ring.Empty(RingSize);
+		Ring.SetNumUninitialized(RingSize);
+		INC_MEMORY_STAT_BY(STAT_ACM_ReplayMemory, Ring.GetAllocatedSize());
+
+		RingWrite = 0;
+		RingUsed = 0;
+		FirstFrameSlot = 0;
+		NumBufferedFrames = 0;
+	}
+
+	CurrentSamples.Reset();
+	for (TActorIterator<AArkdeCMCharacter> CharacterIterator(GetWorld()); CharacterIterator; ++CharacterIterator)
+	{
+
+		const AArkdeCMCharacter* Character = *CharacterIterator;
+		if (Character->IsHidden())
+		{
+			continue;
+		}
+
+		const FVector Location = Character->GetActorLocation();
+
+		FSample& Sample = CurrentSamples.AddZeroed_GetRef();
+		Sample.CharacterId = static_cast<int32>(Character->GetUniqueID());
+		Sample.Location[0] = FMath::RoundToInt(Location.X);
+		Sample.Location[1] = FMath::RoundToInt(Location.Y);
+		Sample.Location[2] = FMath::RoundToInt(Location.Z);
+		Sample.Yaw = FRotator::CompressAxisToByte(Character->GetActorRotation().Yaw);
+
+		const UACM_AttributeSet* AttributeSet = Character->AttributeSet;
+		if (IsValid(AttributeSet))
+		{
+			Sample.Health = QuantizePercent(AttributeSet->GetHealth(), AttributeSet->GetMaxHealth());
+			Sample.Mana = QuantizePercent(AttributeSet->GetMana(), AttributeSet->GetMaxMana());
+			Sample.Stamina = QuantizePercent(AttributeSet->GetStamina(), AttributeSet->GetMaxStamina());
+		}
+
+		const UACM_AbilitySystemComponent* AbilitySystemComponent = Cast<UACM_AbilitySystemComponent>(Character->GetAbilitySystemComponent());
+		if (IsValid(AbilitySystemComponent))
+		{
+			Sample.PublicTagBits = AbilitySystemComponent->GetPublicTagState().GetBits();
+		}
+
+	}
+
+	CurrentSamples.Sort([](const FSample& A, const FSample& B)
+	{
+		return A.CharacterId < B.CharacterId;
+	});
+
+	bool bKeyframe = NumBufferedFrames == 0 || TimeSinceKeyframe >= CVarKeyframeInterval.GetValueOnGameThread();
+	EncodeFrame(CurrentSamples, PreviousSamples, PendingAbilityEvents, bKeyframe, FrameScratch);
+
+	while (NumBufferedFrames > 0 && RingUsed + FrameScratch.Num() > Ring.Num())
+	{
+		DropOldestFrame();
+	}
+
+	// Everything was dropped to make room, the buffer has to restart from a keyframe
+	if (!bKeyframe && NumBufferedFrames == 0)
+	{
+		bKeyframe = true;
+		EncodeFrame(CurrentSamples, PreviousSamples, PendingAbilityEvents, bKeyframe, FrameScratch);
+	}
+
+	PendingAbilityEvents.Reset();
+
+	if (FrameScratch.Num() > Ring.Num())
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Instant replay frame of %d bytes does not fit in the buffer"), FrameScratch.Num());
+		return;
+	}
+
+	StoreFrame(FrameScratch, bKeyframe);
+	Swap(PreviousSamples, CurrentSamples);
+
+	if (bKeyframe)
+	{
+		TimeSinceKeyframe = 0.0f;
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_InstantReplaySubsystem::StoreFrame(const TArray<uint8>& FrameBytes, bool bKeyframe)
+{
+
+	// The frame ring only grows when full, frames are added and dropped without moving the others
+	if (NumBufferedFrames == FrameRing.Num())
+	{
+		TArray<FFrameInfo> GrownRing;
+		GrownRing.Reserve(FMath::Max(FrameRing.Num() * 2, 64));
+
+		for (int32 FrameIndex = 0; FrameIndex < NumBufferedFrames; FrameIndex++)
+		{
+			GrownRing.Add(GetFrame(FrameIndex));
+		}
+
+		GrownRing.SetNumUninitialized(GrownRing.Max());
+		FrameRing = MoveTemp(GrownRing);
+		FirstFrameSlot = 0;
+	}
+
+	FFrameInfo& Frame = FrameRing[(FirstFrameSlot + NumBufferedFrames) % FrameRing.Num()];
+	NumBufferedFrames++;
+
+	Frame.Time = GetWorld()->GetTimeSeconds();
+	Frame.Offset = RingWrite;
+	Frame.Size = FrameBytes.Num();
+	Frame.bKeyframe = bKeyframe;
+
+	const int32 FirstPart = FMath::Min(FrameBytes.Num(), Ring.Num() - RingWrite);
+	FMemory::Memcpy(Ring.GetData() + RingWrite, FrameBytes.GetData(), FirstPart);
+	FMemory::Memcpy(Ring.GetData(), FrameBytes.GetData() + FirstPart, FrameBytes.Num() - FirstPart);
+
+	RingWrite = (RingWrite + FrameBytes.Num()) % Ring.Num();
+	RingUsed += FrameBytes.Num();
+
+}
+
+//=========================================================================================================================================================
+void UACM_InstantReplaySubsystem::DropOldestFrame()
+{
+
+	// Delta frames are useless without the keyframe before them, drop up to the next keyframe
+	do
+	{
+		RingUsed -= GetFrame(0).Size;
+		FirstFrameSlot = (FirstFrameSlot + 1) % FrameRing.Num();
+		NumBufferedFrames--;
+	}
+	while (NumBufferedFrames > 0 && !GetFrame(0).bKeyframe);
+
+}
+
+//=========================================================================================================================================================
+const UACM_InstantReplaySubsystem::FFrameInfo& UACM_InstantReplaySubsystem::GetFrame(int32 FrameIndex) const
+{
+	return FrameRing[(FirstFrameSlot + FrameIndex) % FrameRing.Num()];
+}
+
+//=========================================================================================================================================================
+void UACM_InstantReplaySubsystem::ReadFromRing(int32 Offset, int32 Size, uint8* OutBytes) const
+{
+
+	const int32 FirstPart = FMath::Min(Size, Ring.Num() - Offset);
+	FMemory::Memcpy(OutBytes, Ring.GetData() + Offset, FirstPart);
+	FMemory::Memcpy(OutBytes + FirstPart, Ring.GetData(), Size - FirstPart);
+
+}
+
+//=========================================================================================================================================================
+static void LogReplayStats(const TArray<FString>& Args, UWorld* World)
+{
+
+	UACM_InstantReplaySubsystem* ReplaySubsystem = IsValid(World) ? World->GetSubsystem<UACM_InstantReplaySubsystem>() : nullptr;
+	if (!IsValid(ReplaySubsystem))
+	{
+		return;
+	}
+
+	const float ClipSeconds = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.0f;
+
+	const double StartSeconds = FPlatformTime::Seconds();
+	TArray<uint8> Clip;
+	ReplaySubsystem->ExtractClip(ClipSeconds, Clip);
+	const double ExtractMs = (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Instant replay: %.1f s buffered in %d bytes, %.0f s clip is %d bytes compressed (%.2f ms)"),
+		ReplaySubsystem->GetBufferedSeconds(), ReplaySubsystem->GetBufferedBytes(), ClipSeconds, Clip.Num(), ExtractMs);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarLogReplayStats(
+	TEXT("ACM.Replay.Stats"),
+	TEXT("Logs the instant replay buffer usage and the size of a clip. Args: [ClipSeconds=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&LogReplayStats));
@@ -0,0 +1,213 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Spectator/ACM_SpectatorSnapshot.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "Net/UnrealNetwork.h"
+#include "ArkdeCMCharacter.h"
+#include "GameplayAbility/ACM_AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_AttributeSet.h"
+
+//=========================================================================================================================================================
+AACM_SpectatorSnapshot::AACM_SpectatorSnapshot()
+{
+
+	PrimaryActorTick.bCanEverTick = true;
+
+	bReplicates = true;
+	bOnlyRelevantToOwner = true;
+	SetReplicatingMovement(false);
+
+	SnapshotRate = 4.0f;
+	InterestRadius = 8000.0f;
+	MaxCharacters = 64;
+	ProxyInterpolationSpeed = 10.0f;
+
+	NetUpdateFrequency = SnapshotRate;
+
+}
+
+//=========================================================================================================================================================
+void AACM_SpectatorSnapshot::BeginPlay()
+{
+
+	Super::BeginPlay();
+
+	// The server only ticks to capture, the spectator ticks every frame to interpolate
+	if (HasAuthority())
+	{
+		NetUpdateFrequency = SnapshotRate;
+		SetActorTickInterval(1.0f / SnapshotRate);
+	}
+
+}
+
+//=========================================================================================================================================================
+void AACM_SpectatorSnapshot::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+
+	for (const TPair<int32, AActor*>& ProxyPair : Proxies)
+	{
+		if (IsValid(ProxyPair.Value))
+		{
+			ProxyPair.Value->Destroy();
+		}
+	}
+
+	Proxies.Reset();
+
+	Super::EndPlay(EndPlayReason);
+
+}
+
+//=========================================================================================================================================================
+void AACM_SpectatorSnapshot::Tick(float DeltaSeconds)
+{
+
+	Super::Tick(DeltaSeconds);
+
+	if (HasAuthority())
+	{
+		CaptureSnapshot();
+	}
+	else
+	{
+		InterpolateProxies(DeltaSeconds);
+	}
+
+}
+
+//=========================================================================================================================================================
+void AACM_SpectatorSnapshot::CaptureSnapshot()
+{
+
+	APlayerController* SpectatorController = Cast<APlayerController>(GetOwner());
+	if (!IsValid(SpectatorController))
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	SpectatorController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	const float InterestRadiusSquared = FMath::Square(InterestRadius);
+
+	Characters.Reset();
+	for (TActorIterator<AArkdeCMCharacter> CharacterIterator(GetWorld()); CharacterIterator; ++CharacterIterator)
+	{
+
+		AArkdeCMCharacter* Character = *CharacterIterator;
+		if (Character->IsHidden() || FVector::DistSquared(Character->GetActorLocation(), ViewLocation) > InterestRadiusSquared)
+		{
+			continue;
+		}
+
+		FACM_SpectatorCharacterState& State = Characters.AddDefaulted_GetRef();
+		State.CharacterId = static_cast<int32>(Character->GetUniqueID());
+		State.Location = Character->GetActorLocation();
+		State.PackedYaw = FRotator::CompressAxisToByte(Character->GetActorRotation().Yaw);
+
+		const UACM_AttributeSet* AttributeSet = Character->AttributeSet;
+		if (IsValid(AttributeSet) && AttributeSet->GetMaxHealth() > 0.0f)
+		{
+			State.HealthPercent = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(100.0f * AttributeSet->GetHealth() / AttributeSet->GetMaxHealth()), 0, 100));
+		}
+
+		const UACM_AbilitySystemComponent* AbilitySystemComponent = Cast<UACM_AbilitySystemComponent>(Character->GetAbilitySystemComponent());
+		if (IsValid(AbilitySystemComponent))
+		{
+			State.PublicTagBits = AbilitySystemComponent->GetPublicTagState().GetBits();
+		}
+
+	}
+
+	// Keep the closest characters when there are more than the snapshot holds
+	if (Characters.Num() > MaxCharacters)
+	{
+
+		Characters.Sort([&ViewLocation](const FACM_SpectatorCharacterState& A, const FACM_SpectatorCharacterState& B)
+		{
+			return FVector::DistSquared(A.Location, ViewLocation) < FVector::DistSquared(B.Location, ViewLocation);
+		});
+
+		Characters.SetNum(MaxCharacters);
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void AACM_SpectatorSnapshot::InterpolateProxies(float DeltaSeconds)
+{
+
+	for (const FACM_SpectatorCharacterState& State : Characters)
+	{
+
+		AActor* Proxy = Proxies.FindRef(State.CharacterId);
+		if (!IsValid(Proxy))
+		{
+			continue;
+		}
+
+		const FVector Location = FMath::VInterpTo(Proxy->GetActorLocation(), State.Location, DeltaSeconds, ProxyInterpolationSpeed);
+		const FRotator Rotation = FMath::RInterpTo(Proxy->GetActorRotation(), FRotator(0.0f, State.GetYaw(), 0.0f), DeltaSeconds, ProxyInterpolationSpeed);
+		Proxy->SetActorLocationAndRotation(Location, Rotation);
+
+	}
+
+}
+
+//=========================================================================================================================================================
+void AACM_SpectatorSnapshot::OnRep_Characters()
+{
+
+	if (IsValid(SpectatorProxyClass))
+	{
+
+		TSet<int32> SeenIds;
+		for (const FACM_SpectatorCharacterState& State : Characters)
+		{
+
+			SeenIds.Add(State.CharacterId);
+
+			if (!Proxies.Contains(State.CharacterId))
+			{
+				FActorSpawnParameters SpawnParameters;
+				SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+				AActor* Proxy = GetWorld()->SpawnActor<AActor>(SpectatorProxyClass, State.Location, FRotator(0.0f, State.GetYaw(), 0.0f), SpawnParameters);
+				Proxies.Add(State.CharacterId, Proxy);
+			}
+
+		}
+
+		for (auto ProxyIterator = Proxies.CreateIterator(); ProxyIterator; ++ProxyIterator)
+		{
+			if (!SeenIds.Contains(ProxyIterator->Key))
+			{
+				if (IsValid(ProxyIterator->Value))
+				{
+					ProxyIterator->Value->Destroy();
+				}
+
+				ProxyIterator.RemoveCurrent();
+			}
+		}
+
+	}
+
+	OnSnapshotReceived.Broadcast(Characters);
+
+}
+
+//=========================================================================================================================================================
+void AACM_SpectatorSnapshot::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AACM_SpectatorSnapshot, Characters);
+
+}
@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Startup/ACM_PrewarmSubsystem.h"
+#include "AbilitySystemGlobals.h"
+#include "AssetRegistryModule.h"
+#include "Engine/Blueprint.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Misc/CommandLine.h"
+#include "Misc/PackageName.h"
+#include "Modules/ModuleManager.h"
+#include "GameplayAbility/ACM_GameplayAbility.h"
+#include "GameplayAbility/ACM_GameplayEffect.h"
+#include "Profiling/ACM_GarbageCollection.h"
+#include "Startup/ACM_StartupProfiler.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+//=========================================================================================================================================================
+bool UACM_PrewarmSubsystem::IsPrewarmMode()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("ACMPrewarm"));
+}
+
+//=========================================================================================================================================================
+bool UACM_PrewarmSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return IsPrewarmMode();
+}
+
+//=========================================================================================================================================================
+void UACM_PrewarmSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+
+	Super::Initialize(Collection);
+
+	FACM_ScopedStartupPhase PrewarmPhase(TEXT("Prewarm"));
+
+	InitAbilitySystemGlobals();
+	LoadGameplayClasses();
+	ClusterGameplayClasses();
+
+}
+
+//=========================================================================================================================================================
+void UACM_PrewarmSubsystem::InitAbilitySystemGlobals()
+{
+
+	// Globals are process wide, a second game instance (PIE) or the module must not rebuild them
+	static bool bGlobalDataInitialized = false;
+	if (!bGlobalDataInitialized)
+	{
+		FACM_ScopedStartupPhase GlobalsPhase(TEXT("AbilitySystemGlobals"));
+		UAbilitySystemGlobals::Get().InitGlobalData();
+		bGlobalDataInitialized = true;
+	}
+
+}
+
+//=========================================================================================================================================================
+void UACM_PrewarmSubsystem::LoadGameplayClasses()
+{
+
+	FACM_ScopedStartupPhase LoadPhase(TEXT("Prewarm.GameplayClasses"));
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	if (AssetRegistry.IsLoadingAssets())
+	{
+		AssetRegistry.SearchAllAssets(true);
+	}
+
+	FARFilter Filter;
+	Filter.ClassNames.Add(UBlueprint::StaticClass()->GetFName());
+	Filter.ClassNames.Add(UBlueprintGeneratedClass::StaticClass()->GetFName());
+	Filter.bRecursiveClasses = true;
+	Filter.PackagePaths.Add(TEXT("/Game"));
+	Filter.bRecursivePaths = true;
+
+	TArray<FAssetData> BlueprintAssets;
+	AssetRegistry.GetAssets(Filter, BlueprintAssets);
+
+	for (const FAssetData& BlueprintAsset : BlueprintAssets)
+	{
+
+		FString NativeParentClassPath;
+		if (!BlueprintAsset.GetTagValue(FBlueprintTags::NativeParentClassPath, NativeParentClassPath))
+		{
+			continue;
+		}
+
+		const UClass* NativeParentClass = FindObject<UClass>(ANY_PACKAGE, *FPackageName::ExportTextPathToObjectName(NativeParentClassPath));
+		if (!IsValid(NativeParentClass) || !(NativeParentClass->IsChildOf(UACM_GameplayAbility::StaticClass()) || NativeParentClass->IsChildOf(UACM_GameplayEffect::StaticClass())))
+		{
+			continue;
+		}
+
+		FString ClassPath = BlueprintAsset.ObjectPath.ToString();
+		if (BlueprintAsset.AssetClass == UBlueprint::StaticClass()->GetFName())
+		{
+			ClassPath += TEXT("_C");
+		}
+
+		UClass* GameplayClass = LoadObject<UClass>(nullptr, *ClassPath);
+		if (IsValid(GameplayClass))
+		{
+			// Building the CDO here keeps its construction off the grant and apply paths
+			GameplayClass->GetDefaultObject();
+			PrewarmedClasses.AddUnique(GameplayClass);
+		}
+
+	}
+
+	UE_LOG(LogArkdeCM, Log, TEXT("Prewarmed %d ability and effect classes"), PrewarmedClasses.Num());
+
+}
+
+//=========================================================================================================================================================
+void UACM_PrewarmSubsystem::ClusterGameplayClasses()
+{
+
+	FACM_ScopedStartupPhase ClusterPhase(TEXT("Prewarm.GCClusters"));
+
+	for (UClass* GameplayClass : PrewarmedClasses)
+	{
+		ACM_GarbageCollection::ClusterGameplayClass(GameplayClass);
+	}
+
+}
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Startup/ACM_StartupProfiler.h"
+#include "CoreGlobals.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+namespace ACM_StartupProfiler
+{
+	static TArray<FACM_StartupProfiler::FPhase> Phases;
+	static TMap<FString, double> OpenPhases;
+	static bool bFinished = false;
+}
+
+//=========================================================================================================================================================
+void FACM_StartupProfiler::RecordPhase(const TCHAR* PhaseName, double PhaseStartSeconds)
+{
+
+	const double DurationMs = (FPlatformTime::Seconds() - PhaseStartSeconds) * 1000.0;
+	UE_LOG(LogArkdeCM, Log, TEXT("Startup phase %s: %.2fms (t=%.3fs)"), PhaseName, DurationMs, GetSecondsSinceProcessStart());
+
+	if (!ACM_StartupProfiler::bFinished)
+	{
+		ACM_StartupProfiler::Phases.Add({ PhaseName, PhaseStartSeconds - GStartTime, DurationMs });
+	}
+
+}
+
+//=========================================================================================================================================================
+void FACM_StartupProfiler::RecordMarker(const TCHAR* MarkerName)
+{
+	RecordPhase(MarkerName, FPlatformTime::Seconds());
+}
+
+//=========================================================================================================================================================
+void FACM_StartupProfiler::BeginPhase(const TCHAR* PhaseName)
+{
+
+	if (!ACM_StartupProfiler::bFinished && !ACM_StartupProfiler::OpenPhases.Contains(PhaseName))
+	{
+		ACM_StartupProfiler::OpenPhases.Add(PhaseName, FPlatformTime::Seconds());
+	}
+
+}
+
+//=========================================================================================================================================================
+void FACM_StartupProfiler::EndPhase(const TCHAR* PhaseName)
+{
+
+	double PhaseStartSeconds = 0.0;
+	if (ACM_StartupProfiler::OpenPhases.RemoveAndCopyValue(PhaseName, PhaseStartSeconds))
+	{
+		RecordPhase(PhaseName, PhaseStartSeconds);
+	}
+
+}
+
+//=========================================================================================================================================================
+void FACM_StartupProfiler::Finish(const TCHAR* MarkerName)
+{
+
+	if (ACM_StartupProfiler::bFinished)
+	{
+		return;
+	}
+
+	RecordMarker(MarkerName);
+	ACM_StartupProfiler::bFinished = true;
+
+	WriteReport();
+
+}
+
+//=========================================================================================================================================================
+bool FACM_StartupProfiler::IsCollecting()
+{
+	return !ACM_StartupProfiler::bFinished;
+}
+
+//=========================================================================================================================================================
+const TArray<FACM_StartupProfiler::FPhase>& FACM_StartupProfiler::GetPhases()
+{
+	return ACM_StartupProfiler::Phases;
+}
+
+//=========================================================================================================================================================
+double FACM_StartupProfiler::GetSecondsSinceProcessStart()
+{
+	return FPlatformTime::Seconds() - GStartTime;
+}
+
+//=========================================================================================================================================================
+void FACM_StartupProfiler::WriteReport()
+{
+
+	const double TotalSeconds = GetSecondsSinceProcessStart();
+
+	TArray<TSharedPtr<FJsonValue>> PhaseValues;
+	UE_LOG(LogArkdeCM, Log, TEXT("Startup report (%.3fs total):"), TotalSeconds);
+
+	for (const FPhase& Phase : ACM_StartupProfiler::Phases)
+	{
+
+		UE_LOG(LogArkdeCM, Log, TEXT("  %8.3fs %10.2fms  %s"), Phase.StartSeconds, Phase.DurationMs, *Phase.Name);
+
+		TSharedRef<FJsonObject> PhaseObject = MakeShared<FJsonObject>();
+		PhaseObject->SetStringField(TEXT("Name"), Phase.Name);
+		PhaseObject->SetNumberField(TEXT("StartSeconds"), Phase.StartSeconds);
+		PhaseObject->SetNumberField(TEXT("DurationMs"), Phase.DurationMs);
+		PhaseValues.Add(MakeShared<FJsonValueObject>(PhaseObject));
+
+	}
+
+	TSharedRef<FJsonObject> ReportObject = MakeShared<FJsonObject>();
+	ReportObject->SetNumberField(TEXT("ProcessId"), FPlatformProcess::GetCurrentProcessId());
+	ReportObject->SetBoolField(TEXT("DedicatedServer"), IsRunningDedicatedServer());
+	ReportObject->SetNumberField(TEXT("TotalSeconds"), TotalSeconds);
+	ReportObject->SetArrayField(TEXT("Phases"), PhaseValues);
+
+	FString ReportFilename;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("ACMStartupReport="), ReportFilename))
+	{
+		ReportFilename = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("ACM_Startup.json");
+	}
+
+	FString Contents;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Contents);
+	FJsonSerializer::Serialize(ReportObject, Writer);
+
+	if (!FFileHelper::SaveStringToFile(Contents, *ReportFilename))
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("Could not write startup report to %s"), *ReportFilename);
+	}
+
+}
+
+//=========================================================================================================================================================
+FACM_ScopedStartupPhase::FACM_ScopedStartupPhase(const TCHAR* InPhaseName)
+	: PhaseName(InPhaseName)
+	, StartSeconds(FPlatformTime::Seconds())
+{
+}
+
+FACM_ScopedStartupPhase::~FACM_ScopedStartupPhase()
+{
+	FACM_StartupProfiler::RecordPhase(PhaseName, StartSeconds);
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Tuning/ACM_TuningBakeCommandlet.h"
+#include "Tuning/ACM_TuningTable.h"
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+//=========================================================================================================================================================
+UACM_TuningBakeCommandlet::UACM_TuningBakeCommandlet()
+{
+
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+}
+
+//=========================================================================================================================================================
+int32 UACM_TuningBakeCommandlet::Main(const FString& Params)
+{
+
+	FString SourceFilename;
+	FString OutputFilename = FACM_TuningTable::GetDefaultFilename();
+
+	if (!FParse::Value(*Params, TEXT("Source="), SourceFilename))
+	{
+		UE_LOG(LogArkdeCM, Error, TEXT("Usage: -run=ACM_TuningBake -Source=Tuning.json [-Output=File.acmt]"));
+		return 1;
+	}
+
+	FParse::Value(*Params, TEXT("Output="), OutputFilename);
+
+	FString JsonText;
+	TSharedPtr<FJsonObject> RootObject;
+	if (!FFileHelper::LoadFileToString(JsonText, *SourceFilename) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(JsonText), RootObject) || !RootObject.IsValid())
+	{
+		UE_LOG(LogArkdeCM, Error, TEXT("Could not read tuning sheet %s"), *SourceFilename);
+		return 1;
+	}
+
+	TArray<FACM_TuningEntry> Entries;
+
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& OwnerPair : RootObject->Values)
+	{
+
+		const TSharedPtr<FJsonObject>* FieldsObject = nullptr;
+		if (!OwnerPair.Value->TryGetObject(FieldsObject))
+		{
+			UE_LOG(LogArkdeCM, Error, TEXT("Tuning owner %s is not an object"), *OwnerPair.Key);
+			return 1;
+		}
+
+		// Same CRC as ACM_ContentId::FromClass, so the class does not have to be loaded to bake it
+		const uint32 OwnerId = FCrc::StrCrc32(*OwnerPair.Key);
+
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& FieldPair : (*FieldsObject)->Values)
+		{
+
+			double Value = 0.0;
+			if (!FieldPair.Value->TryGetNumber(Value))
+			{
+				UE_LOG(LogArkdeCM, Error, TEXT("Tuning field %s.%s is not a number"), *OwnerPair.Key, *FieldPair.Key);
+				return 1;
+			}
+
+			FACM_TuningEntry& Entry = Entries.AddDefaulted_GetRef();
+			Entry.OwnerId = OwnerId;
+			Entry.FieldId = ACM_TuningField::Id(*FieldPair.Key);
+			Entry.Value = static_cast<float>(Value);
+			Entry.Reserved = 0;
+
+		}
+
+	}
+
+	if (!FACM_TuningTable::Write(OutputFilename, Entries))
+	{
+		UE_LOG(LogArkdeCM, Error, TEXT("Could not write tuning table %s"), *OutputFilename);
+		return 1;
+	}
+
+	UE_LOG(LogArkdeCM, Display, TEXT("Baked %d tuning entries from %d owners into %s"), Entries.Num(), RootObject->Values.Num(), *OutputFilename);
+	return 0;
+
+}
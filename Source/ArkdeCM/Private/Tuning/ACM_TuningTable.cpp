@@ -0,0 +1,315 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Tuning/ACM_TuningTable.h"
+#include "Async/MappedFileHandle.h"
+#include "AttributeSet.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Engine/World.h"
+#include "ArkdeCMGameMode.h"
+#include "ArkdeCM/ArkdeCM.h"
+
+const uint32 ACM_TuningField::Cooldown = ACM_TuningField::Id(TEXT("Cooldown"));
+const uint32 ACM_TuningField::Cost = ACM_TuningField::Id(TEXT("Cost"));
+const uint32 ACM_TuningField::Duration = ACM_TuningField::Id(TEXT("Duration"));
+const uint32 ACM_TuningField::Period = ACM_TuningField::Id(TEXT("Period"));
+const uint32 ACM_TuningField::Magnitude = ACM_TuningField::Id(TEXT("Magnitude"));
+
+namespace ACM_TuningTable
+{
+
+	/** Backing storage of the active table. Region and handle when mapped, FallbackData otherwise */
+	struct FMappedTable
+	{
+
+		TUniquePtr<IMappedFileHandle> FileHandle;
+		TUniquePtr<IMappedFileRegion> Region;
+		TArray<uint8> FallbackData;
+
+		FString Filename;
+
+		const FACM_TuningEntry* Entries = nullptr;
+		int32 NumEntries = 0;
+
+		void Reset()
+		{
+			// The region has to go before the handle it was mapped from
+			Region.Reset();
+			FileHandle.Reset();
+			FallbackData.Empty();
+			Filename.Empty();
+			Entries = nullptr;
+			NumEntries = 0;
+		}
+
+	};
+
+	static FMappedTable ActiveTable;
+
+	static uint32 Generation = 1;
+
+	static bool ValidateTable(const uint8* Data, int64 Size, FMappedTable& OutTable)
+	{
+
+		if (Data == nullptr || Size < static_cast<int64>(sizeof(FACM_TuningHeader)))
+		{
+			return false;
+		}
+
+		const FACM_TuningHeader* Header = reinterpret_cast<const FACM_TuningHeader*>(Data);
+		if (Header->Magic != FACM_TuningTable::Magic || Header->Version != FACM_TuningTable::CurrentVersion)
+		{
+			return false;
+		}
+
+		if (static_cast<int64>(Header->NumEntries) > (Size - static_cast<int64>(sizeof(FACM_TuningHeader))) / static_cast<int64>(sizeof(FACM_TuningEntry)))
+		{
+			return false;
+		}
+
+		const FACM_TuningEntry* Entries = reinterpret_cast<const FACM_TuningEntry*>(Data + sizeof(FACM_TuningHeader));
+
+		// Lookups rely on the order, a table that was not written by FACM_TuningTable::Write is rejected
+		for (uint32 EntryIndex = 1; EntryIndex < Header->NumEntries; EntryIndex++)
+		{
+			const FACM_TuningEntry& Previous = Entries[EntryIndex - 1];
+			const FACM_TuningEntry& Current = Entries[EntryIndex];
+			if (Previous.OwnerId > Current.OwnerId || (Previous.OwnerId == Current.OwnerId && Previous.FieldId >= Current.FieldId))
+			{
+				return false;
+			}
+		}
+
+		OutTable.Entries = Entries;
+		OutTable.NumEntries = static_cast<int32>(Header->NumEntries);
+		return true;
+
+	}
+
+}
+
+//=========================================================================================================================================================
+bool FACM_TuningView::TryGet(uint32 FieldId, float& OutValue) const
+{
+
+	for (int32 EntryIndex = 0; EntryIndex < NumEntries; EntryIndex++)
+	{
+		if (Entries[EntryIndex].FieldId == FieldId)
+		{
+			OutValue = Entries[EntryIndex].Value;
+			return true;
+		}
+	}
+
+	return false;
+
+}
+
+//=========================================================================================================================================================
+bool FACM_AttributeTuning::TryGetDefault(const FGameplayAttribute& Attribute, float& OutValue) const
+{
+	return !IsEmpty() && TryGet(ACM_TuningField::Id(*Attribute.GetName()), OutValue);
+}
+
+//=========================================================================================================================================================
+FString FACM_TuningTable::GetDefaultFilename()
+{
+
+	FString Filename;
+	if (FParse::Value(FCommandLine::Get(), TEXT("ACMTuning="), Filename))
+	{
+		return Filename;
+	}
+
+	return FPaths::ProjectContentDir() / TEXT("Tuning") / TEXT("ACM_Tuning.acmt");
+
+}
+
+//=========================================================================================================================================================
+bool FACM_TuningTable::Load(const FString& Filename)
+{
+
+	using namespace ACM_TuningTable;
+
+	FMappedTable NewTable;
+
+	NewTable.FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	if (NewTable.FileHandle.IsValid())
+	{
+		NewTable.Region.Reset(NewTable.FileHandle->MapRegion(0, NewTable.FileHandle->GetFileSize(), true));
+	}
+
+	bool bValid = false;
+	if (NewTable.Region.IsValid())
+	{
+		bValid = ValidateTable(NewTable.Region->GetMappedPtr(), NewTable.Region->GetMappedSize(), NewTable);
+	}
+	else if (FFileHelper::LoadFileToArray(NewTable.FallbackData, *Filename, FILEREAD_Silent))
+	{
+		// No mapping on this platform, the table is read into one allocation instead
+		bValid = ValidateTable(NewTable.FallbackData.GetData(), NewTable.FallbackData.Num(), NewTable);
+	}
+
+	if (!bValid)
+	{
+		NewTable.Reset();
+		UE_LOG(LogArkdeCM, Warning, TEXT("Could not load tuning table %s, keeping the current one"), *Filename);
+		return false;
+	}
+
+	// Views into the old table die here, consumers look values up again through FindOwner
+	ActiveTable.Reset();
+	ActiveTable.FileHandle = MoveTemp(NewTable.FileHandle);
+	ActiveTable.Region = MoveTemp(NewTable.Region);
+	ActiveTable.FallbackData = MoveTemp(NewTable.FallbackData);
+	ActiveTable.Filename = FPaths::ConvertRelativePathToFull(Filename);
+	ActiveTable.Entries = NewTable.Entries;
+	ActiveTable.NumEntries = NewTable.NumEntries;
+	Generation++;
+
+	UE_LOG(LogArkdeCM, Log, TEXT("Tuning table %s loaded, %d entries%s"), *Filename, ActiveTable.NumEntries, ActiveTable.Region.IsValid() ? TEXT(" (mapped)") : TEXT(""));
+	return true;
+
+}
+
+//=========================================================================================================================================================
+void FACM_TuningTable::Unload()
+{
+
+	ACM_TuningTable::ActiveTable.Reset();
+	ACM_TuningTable::Generation++;
+
+}
+
+//=========================================================================================================================================================
+bool FACM_TuningTable::IsLoaded()
+{
+	return ACM_TuningTable::ActiveTable.Entries != nullptr;
+}
+
+//=========================================================================================================================================================
+uint32 FACM_TuningTable::GetGeneration()
+{
+	return ACM_TuningTable::Generation;
+}
+
+//=========================================================================================================================================================
+FACM_TuningView FACM_TuningTable::FindOwner(uint32 OwnerId)
+{
+
+	const ACM_TuningTable::FMappedTable& Table = ACM_TuningTable::ActiveTable;
+
+	FACM_TuningView View;
+	if (Table.NumEntries == 0 || OwnerId == 0)
+	{
+		return View;
+	}
+
+	int32 First = 0;
+	int32 Count = Table.NumEntries;
+	while (Count > 0)
+	{
+		const int32 Step = Count / 2;
+		if (Table.Entries[First + Step].OwnerId < OwnerId)
+		{
+			First += Step + 1;
+			Count -= Step + 1;
+		}
+		else
+		{
+			Count = Step;
+		}
+	}
+
+	int32 Last = First;
+	while (Last < Table.NumEntries && Table.Entries[Last].OwnerId == OwnerId)
+	{
+		Last++;
+	}
+
+	View.Entries = Table.Entries + First;
+	View.NumEntries = Last - First;
+	return View;
+
+}
+
+//=========================================================================================================================================================
+bool FACM_TuningTable::Write(const FString& Filename, TArray<FACM_TuningEntry>& Entries)
+{
+
+	Entries.Sort([](const FACM_TuningEntry& A, const FACM_TuningEntry& B)
+	{
+		return A.OwnerId != B.OwnerId ? A.OwnerId < B.OwnerId : A.FieldId < B.FieldId;
+	});
+
+	for (int32 EntryIndex = 1; EntryIndex < Entries.Num(); EntryIndex++)
+	{
+		if (Entries[EntryIndex - 1].OwnerId == Entries[EntryIndex].OwnerId && Entries[EntryIndex - 1].FieldId == Entries[EntryIndex].FieldId)
+		{
+			UE_LOG(LogArkdeCM, Error, TEXT("Duplicate tuning field %08X on owner %08X"), Entries[EntryIndex].FieldId, Entries[EntryIndex].OwnerId);
+			return false;
+		}
+	}
+
+	FACM_TuningHeader Header;
+	Header.Magic = Magic;
+	Header.Version = CurrentVersion;
+	Header.NumEntries = Entries.Num();
+	Header.Reserved = 0;
+
+	TArray<uint8> FileData;
+	FileData.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	FileData.Append(reinterpret_cast<const uint8*>(Entries.GetData()), Entries.Num() * sizeof(FACM_TuningEntry));
+
+	const FString TempFilename = Filename + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(FileData, *TempFilename))
+	{
+		return false;
+	}
+
+	// Windows refuses to replace a mapped file, a table this process maps from the target is released first
+	if (ACM_TuningTable::ActiveTable.Region.IsValid() && ACM_TuningTable::ActiveTable.Filename == FPaths::ConvertRelativePathToFull(Filename))
+	{
+		Unload();
+	}
+
+	// On POSIX a server mapping the old file keeps its view. Elsewhere the move fails while any process maps it
+	if (!IFileManager::Get().Move(*Filename, *TempFilename, true))
+	{
+		UE_LOG(LogArkdeCM, Error, TEXT("Could not replace %s, it may be mapped by a running server. The new table is at %s"), *Filename, *TempFilename);
+		return false;
+	}
+
+	return true;
+
+}
+
+//=========================================================================================================================================================
+static void ReloadTuningTable(const TArray<FString>& Args, UWorld* World)
+{
+
+	AArkdeCMGameMode* GameMode = IsValid(World) ? World->GetAuthGameMode<AArkdeCMGameMode>() : nullptr;
+	const bool bForce = Args.Contains(TEXT("-force"));
+
+	// Specs already applied keep the old values, swapping is safe while there is nobody to notice the mix
+	const bool bSafeWindow = GameMode == nullptr || GameMode->IsAwaitingMatchAssignment() || GameMode->GetNumPlayers() == 0;
+	if (!bSafeWindow && !bForce)
+	{
+		UE_LOG(LogArkdeCM, Warning, TEXT("%d players are connected, tuning is swapped while nobody plays. Add -force to swap anyway"), GameMode->GetNumPlayers());
+		return;
+	}
+
+	const FString Filename = Args.Num() > 0 && Args[0] != TEXT("-force") ? Args[0] : FACM_TuningTable::GetDefaultFilename();
+	FACM_TuningTable::Load(Filename);
+
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CVarReloadTuningTable(
+	TEXT("ACM.Tuning.Reload"),
+	TEXT("Maps a tuning table and swaps it in. Args: [File] [-force to swap while players are connected]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ReloadTuningTable));
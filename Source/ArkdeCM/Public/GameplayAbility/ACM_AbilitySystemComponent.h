@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AbilitySystemComponent.h"
+#include "GameplayAbility/ACM_TagBits.h"
+#include "GameplayAbility/ACM_PublicTagState.h"
+#include "GameplayAbility/ACM_GameplayAbility.h"
+#include "ACM_AbilitySystemComponent.generated.h"
+
+class UACM_GameplayEffect;
+class UACM_AbilityTask;
+
+/**
+ * Ability system component used by ArkdeCM characters.
+ *
+ * The owned tags are mirrored into an FACM_TagBits bitset that is updated as tags are added or removed, and the
+ * tag masks of active immunity effects are tracked as they come and go. On the authority this turns the application
+ * gate of a UACM_GameplayEffect into a few mask operations that reject blocked specs before the container queries run.
+ * Specs that pass, and anything the masks cannot represent, go through the regular checks so the result is unchanged.
+ */
+UCLASS()
+class ARKDECM_API UACM_AbilitySystemComponent : public UAbilitySystemComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void InitializeComponent() override;
+
+	virtual FActiveGameplayEffectHandle ApplyGameplayEffectSpecToSelf(const FGameplayEffectSpec& GameplayEffect, FPredictionKey PredictionKey = FPredictionKey()) override;
+
+	/**
+	 * Applies the effect's FACM_TuningTable values to a UACM_GameplayEffect spec: Period, Magnitude as SetByCaller
+	 * Data.Magnitude, and for HasDuration effects the duration, locked to the tuned value or else the level cache.
+	 * Check with ACM.Tuning.VerifyDurations
+	 */
+	virtual FGameplayEffectSpecHandle MakeOutgoingSpec(TSubclassOf<UGameplayEffect> GameplayEffectClass, float Level, FGameplayEffectContextHandle Context) const override;
+
+	/** Sets and locks the duration of Spec, replacing a duration MakeOutgoingSpec already locked, e.g. for tuned cooldowns */
+	static void OverrideDuration(FGameplayEffectSpec& Spec, float Duration);
+
+	/**
+	 * Removes every effect matching Query in one pass, for death, cleanse and respawn. Gameplay cue RPCs are batched
+	 * and aggregators are evaluated once after all removals, whether ACM.Attributes.DeferredAggregation is on or not.
+	 * UACM_AttributeSet then gets one OnBatchAttributeChanged per attribute that actually changed. Removals and
+	 * attribute values made in the same frame already go out as one replication update. Returns the number of
+	 * effects removed.
+	 */
+	int32 RemoveActiveEffectsBatched(const FGameplayEffectQuery& Query, int32 StacksToRemove = -1);
+
+	/** True while the aggregator of Attribute waits for a deferred batch to end, see UACM_AttributeSet */
+	bool IsAttributeAggregationPending(const FGameplayAttribute& Attribute) const;
+
+	/**
+	 * Moves the base the aggregator of Attribute evaluates from. For bases written straight into the set, bEvaluate
+	 * re-evaluates aggregators that still hold modifiers (deferred while a batch is open)
+	 */
+	void SetAggregatorBaseValue(const FGameplayAttribute& Attribute, float BaseValue, bool bEvaluate = false);
+
+	/** Owned tags as bits over FACM_TagIndex */
+	const FACM_TagBits& GetOwnedTagBits();
+
+	/**
+	 * Whether the character has one of the FACM_GameplayTags public tags, on the server and on every client. GAS never
+	 * replicates loose tags, such as ability activation tags or State.Dead, and with Mixed replication non-owners only
+	 * see effect granted tags. The server therefore tracks every public tag, loose or granted, in PublicTagState and
+	 * replicates that bitset to all clients, which read it here.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Gameplay Ability System")
+	bool HasPublicTag(FGameplayTag Tag) const;
+
+	/** Public tag bits, read by spectator snapshots and instant replays */
+	const FACM_PublicTagState& GetPublicTagState() const { return PublicTagState; }
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/* ----- Activation Groups START ----- */
+
+	/** Exclusive abilities are blocked while an Exclusive_Blocking ability is active */
+	bool IsActivationGroupBlocked(EACM_AbilityActivationGroup Group) const;
+
+	/** Bit per EACM_AbilityActivationGroup with at least one active ability */
+	uint8 GetActiveGroupMask() const { return ActiveGroupMask; }
+
+	virtual void NotifyAbilityActivated(const FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability) override;
+
+	virtual void NotifyAbilityEnded(FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability, bool bWasCancelled) override;
+
+	/** Adds the activation groups to showdebug AbilitySystem */
+	virtual void DisplayDebug(UCanvas* Canvas, const FDebugDisplayInfo& DebugDisplay, float& YL, float& YPos) override;
+
+	/* ----- Activation Groups END ----- */
+
+	/* ----- Ability Task Pool START ----- */
+
+	/** A finished task of exactly TaskClass that was released on an earlier frame, null when there is none */
+	UACM_AbilityTask* TakePooledAbilityTask(UClass* TaskClass);
+
+	/** Keeps a finished, reset task for reuse. False when the pool is full and the task is left for garbage collection */
+	bool ReturnPooledAbilityTask(UACM_AbilityTask* Task);
+
+	/* ----- Ability Task Pool END ----- */
+
+protected:
+
+	virtual void OnTagUpdated(const FGameplayTag& Tag, bool TagExists) override;
+
+	/** Returns true when the masks prove the spec would be rejected by immunity or tag requirements */
+	bool IsBlockedByTagMasks(const FGameplayEffectSpec& Spec);
+
+	void RebuildOwnedTagBits();
+
+	/** Recomputes the public bits Tag affects from the owned tag counts */
+	void UpdatePublicTagState(const FGameplayTag& Tag);
+
+	void CancelReplaceableAbilities(const FGameplayAbilitySpecHandle& IgnoreHandle);
+
+	void HandleActiveEffectAdded(UAbilitySystemComponent* Target, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle);
+
+	void HandleActiveEffectRemoved(const FActiveGameplayEffect& Effect);
+
+	void HandleActiveEffectStackChanged(FActiveGameplayEffectHandle Handle, int32 NewStackCount, int32 PreviousStackCount);
+
+protected:
+
+	struct FImmunityEntry
+	{
+		FActiveGameplayEffectHandle Handle;
+		const UACM_GameplayEffect* Effect = nullptr;
+	};
+
+	FACM_TagBits OwnedTagBits;
+
+	/** FACM_TagIndex generation OwnedTagBits was built against */
+	uint32 OwnedTagBitsGeneration = 0;
+
+	/** Active effects granting application immunity that the masks can represent */
+	TArray<FImmunityEntry> ImmunityEffects;
+
+	static constexpr uint8 ExclusiveGroupMask = (1 << static_cast<uint8>(EACM_AbilityActivationGroup::Exclusive_Replaceable)) | (1 << static_cast<uint8>(EACM_AbilityActivationGroup::Exclusive_Blocking));
+
+	/** Active abilities per EACM_AbilityActivationGroup */
+	uint8 ActivationGroupCounts[static_cast<uint8>(EACM_AbilityActivationGroup::MAX)] = {};
+
+	uint8 ActiveGroupMask = 0;
+
+	/** Written on the authority from OnTagUpdated, replicated to every client */
+	UPROPERTY(Replicated)
+	FACM_PublicTagState PublicTagState;
+
+	/** Active immunity effects the masks cannot represent, the fast path is skipped while there are any */
+	TArray<FActiveGameplayEffectHandle> InexactImmunityHandles;
+
+	/** Finished UACM_AbilityTask objects, of any class */
+	UPROPERTY(Transient)
+	TArray<UACM_AbilityTask*> PooledAbilityTasks;
+
+};
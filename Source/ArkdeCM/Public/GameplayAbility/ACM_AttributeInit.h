@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCurveTable;
+
+/** Initial attribute values of one character class at one level, in UACM_AttributeSet::GetAllAttributes order */
+struct ARKDECM_API FACM_AttributeInitSpec
+{
+	TArray<float> Values;
+
+	/** Bit per attribute the table has a row for, the others keep their constructor default */
+	uint32 Mask = 0;
+};
+
+/**
+ * Attribute initialization tables baked into FACM_AttributeInitSpec.
+ *
+ * A table has one curve per class and attribute, named "<Class>.<Attribute>" (e.g. "Warrior.MaxHealth"), with a key per
+ * level. The whole table is evaluated once, at load or on first use, into one spec per class and level. Spawning
+ * only looks up a spec and writes it into the attribute set; no curve is evaluated and no effect is executed.
+ * Levels past the last key use the last level. Editing a table in the editor drops its baked specs.
+ */
+class ARKDECM_API FACM_AttributeInitRegistry
+{
+
+public:
+
+	/** Evaluates every row of Table, if that was not done yet */
+	static void Bake(const UCurveTable* Table);
+
+	/** Null when the table has no row for InitClass */
+	static const FACM_AttributeInitSpec* FindSpec(const UCurveTable* Table, FName InitClass, int32 Level);
+
+	static void Invalidate(const UCurveTable* Table);
+
+};
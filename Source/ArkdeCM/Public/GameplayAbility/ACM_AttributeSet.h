@@ -7,9 +7,20 @@
 #include "AbilitySystemComponent.h"
 #include "ACM_AttributeSet.generated.h"
 
+struct FACM_AttributeInitSpec;
+struct FOnAttributeChangeData;
+
+/** Like GAMEPLAYATTRIBUTE_VALUE_GETTER, but evaluates a deferred aggregation batch first when the value is pending */
+#define ACM_ATTRIBUTE_VALUE_GETTER(PropertyName) \
+     FORCEINLINE float Get##PropertyName() const \
+     { \
+          FlushBeforeRead(Get##PropertyName##Attribute()); \
+          return PropertyName.GetCurrentValue(); \
+     }
+
 #define ATTRIBUTE_ACCESSORS(ClassName, PropertyName) \
      GAMEPLAYATTRIBUTE_PROPERTY_GETTER(ClassName, PropertyName) \
-     GAMEPLAYATTRIBUTE_VALUE_GETTER(PropertyName) \
+     ACM_ATTRIBUTE_VALUE_GETTER(PropertyName) \
      GAMEPLAYATTRIBUTE_VALUE_SETTER(PropertyName) \
      GAMEPLAYATTRIBUTE_VALUE_INITTER(PropertyName)
 
@@ -26,10 +37,118 @@ public:
 
 	UACM_AttributeSet();
 
+	virtual void PostInitProperties() override;
+
 	virtual void PreAttributeChange(const FGameplayAttribute& Attribute, float& NewValue) override;
+	virtual void PreAttributeBaseChange(const FGameplayAttribute& Attribute, float& NewValue) const override;
+	virtual bool PreGameplayEffectExecute(struct FGameplayEffectModCallbackData& Data) override;
 	virtual void PostGameplayEffectExecute(const struct FGameplayEffectModCallbackData &Data) override;
 	void AdjustAttributeForMaxChange(FGameplayAttributeData& AffectedAttribute, const FGameplayAttributeData& MaxAttribute, float NewMaxValue, const FGameplayAttribute& AffectedAttributeProperty);
 
+	/**
+	 * Writes base and current values straight into the attribute data, without aggregators or effects. Meant for a
+	 * fresh set at spawn, before any modifier targets it
+	 */
+	void InitFromSpec(const FACM_AttributeInitSpec& Spec);
+
+	/** Same as InitFromSpec, with the attribute defaults of this set class in the loaded FACM_TuningTable */
+	void ApplyTuningDefaults();
+
+	/**
+	 * Writes a recorded base and current value straight into the attribute data like InitFromSpec, so no
+	 * PreAttributeChange and no Max rescale. Listeners of the attribute are told about the new current value
+	 */
+	void WriteAttributeValue(const FGameplayAttribute& Attribute, float BaseValue, float CurrentValue);
+
+	/**
+	 * While set, Max changes leave Health, Mana and Stamina alone. For restoring saved values, whose resources already
+	 * include every rescale, while the effects that raised their Max are applied again
+	 */
+	void SetMaxAdjustSuppressed(bool bSuppressed) { bMaxAdjustSuppressed = bSuppressed; }
+
+	/* ----- Deferred aggregation START ----- */
+
+	/**
+	 * With ACM.Attributes.DeferredAggregation on, the server batches aggregator updates from the start of each world
+	 * tick until actors have ticked. Every attribute is then evaluated once, however many effects touched it.
+	 * Max* changes seen during that evaluation are rescaled after all other attributes are final. An instant execute
+	 * on a resource whose Max is still pending evaluates the batch first, so Max changes keep their place before the
+	 * resource changes that came after them. Batch state is kept per world.
+	 *
+	 * Reads through the Get<Attribute>() getters evaluate the batch on demand when the attribute, or the Max of a
+	 * resource, is pending. Reads that bypass the set's getters (FGameplayAttribute::GetNumericValue,
+	 * UAbilitySystemComponent::GetNumericAttribute, the FGameplayAttributeData members) see the value from before the
+	 * batch until it ends; call FlushDeferredAggregation before them when that matters
+	 */
+	static void RegisterDeferredAggregation();
+	static void UnregisterDeferredAggregation();
+
+	/** Evaluates pending attribute changes now instead of at the end of the actor tick */
+	UFUNCTION(BlueprintCallable, Category = "Attributes", meta = (WorldContext = "WorldContextObject"))
+	static void FlushDeferredAggregation(const UObject* WorldContextObject);
+
+	/**
+	 * Nests inside the frame batch when there is one. Otherwise the outermost End evaluates every dirty attribute,
+	 * with the same Max ordering as the frame batch for the sets of World
+	 */
+	static void BeginAggregationBatch();
+	static void EndAggregationBatch(const UWorld* World);
+
+	/** Rescales against the Max changes queued while the last batch was evaluated */
+	void ApplyPendingMaxChanges();
+
+	/** Evaluates the deferred batch when Attribute, or the Max of a resource Attribute, has changes pending in it */
+	void FlushBeforeRead(const FGameplayAttribute& Attribute) const;
+
+	/* ----- Deferred aggregation END ----- */
+
+	/* ----- Batched notifications START ----- */
+
+	DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnBatchAttributeChanged, const FGameplayAttribute& /*Attribute*/, float /*OldValue*/, float /*NewValue*/);
+
+	/** Broadcast once per changed attribute after a batched operation, e.g. UACM_AbilitySystemComponent::RemoveActiveEffectsBatched */
+	FOnBatchAttributeChanged OnBatchAttributeChanged;
+
+	/** Every FGameplayAttributeData of the set, in declaration order */
+	static const TArray<FGameplayAttribute>& GetAllAttributes();
+
+	void CaptureAttributeValues(TArray<float>& OutValues) const;
+
+	/** Broadcasts OnBatchAttributeChanged for the attributes that differ from OldValues */
+	void BroadcastBatchChanges(const TArray<float>& OldValues);
+
+	/* ----- Batched notifications END ----- */
+
+	/* ----- Range watches START ----- */
+
+	DECLARE_DELEGATE_OneParam(FOnRangeEntered, float /*NewValue*/);
+
+	/**
+	 * Calls OnEntered when Attribute moves from outside [MinValue, MaxValue] into it. Changes that stay inside or stay
+	 * outside wake nobody, and neither do replicated values equal to the old one. The set binds once per watched
+	 * attribute to the ASC, however many watches there are. OnRegenChanged is called when the regen rate of the
+	 * attribute changes, so a forecast can be redone. Returns the id for RemoveRangeWatch
+	 */
+	int32 AddRangeWatch(const FGameplayAttribute& Attribute, float MinValue, float MaxValue, FOnRangeEntered OnEntered, FSimpleDelegate OnRegenChanged = FSimpleDelegate());
+
+	void RemoveRangeWatch(int32 WatchId);
+
+	bool IsRangeWatchInside(int32 WatchId) const;
+
+	/** True while a watch calls back into Object */
+	bool HasRangeWatchBoundTo(const UObject* Object) const;
+
+	/**
+	 * Seconds until regen alone brings a resource attribute up to TargetValue. 0 when it is already there, -1 when regen
+	 * never gets there: no regen attribute, no positive rate, or TargetValue above the Max attribute
+	 */
+	float ForecastSecondsToReach(const FGameplayAttribute& Attribute, float TargetValue) const;
+
+	/** Max and Regen attributes of Health, Mana and Stamina. False for any other attribute */
+	static bool GetResourceAttributes(const FGameplayAttribute& Attribute, FGameplayAttribute& OutMaxAttribute, FGameplayAttribute& OutRegenAttribute);
+
+	/* ----- Range watches END ----- */
+
 	//ATRIBUTOS
 	UPROPERTY(BlueprintReadOnly, Category = "Health", ReplicatedUsing = OnRep_Health)
 	FGameplayAttributeData Health;
@@ -94,4 +213,63 @@ public:
 	UFUNCTION()
 	virtual void OnRep_StaminaRegen(const FGameplayAttributeData& OldStaminaRegen);
 
+protected:
+
+	/**
+	 * ACM.Attributes.FixedPoint of the server when the set was created. Replicated, so clients run the same math as
+	 * the server whatever their own setting is
+	 */
+	UPROPERTY(Replicated)
+	bool bFixedPoint;
+
+	struct FPendingMaxChange
+	{
+		float OldMaxValue;
+		float NewMaxValue;
+	};
+
+	/** Snaps Value to the fixed-point grid when the set uses fixed point */
+	float QuantizeValue(float Value) const;
+
+	/** Clamp to [0, MaxValue], on the fixed-point grid when the set uses fixed point */
+	float ClampResource(float Value, float MaxValue) const;
+
+	/** Clamps base and current value of a resource against the current value of its Max attribute */
+	void ClampResourceAttribute(const FGameplayAttribute& Attribute, FGameplayAttributeData& Resource, const FGameplayAttributeData& MaxAttribute);
+
+	void RescaleAttributeForMaxChange(const FGameplayAttribute& AffectedAttributeProperty, float OldMaxValue, float NewMaxValue);
+
+	/** Max changes seen while a deferred batch is evaluated, keyed by the attribute they rescale */
+	TMap<FGameplayAttribute, FPendingMaxChange> PendingMaxChanges;
+
+	bool bMaxAdjustSuppressed = false;
+
+	struct FRangeWatch
+	{
+		int32 Id = 0;
+		int32 AttributeIndex = INDEX_NONE;
+
+		/** GetAllAttributes index of the regen attribute, INDEX_NONE when there is none */
+		int32 RegenIndex = INDEX_NONE;
+
+		float MinValue = 0.0f;
+		float MaxValue = 0.0f;
+		bool bInside = false;
+
+		FOnRangeEntered OnEntered;
+		FSimpleDelegate OnRegenChanged;
+	};
+
+	void HandleWatchedAttributeChanged(const FOnAttributeChangeData& ChangeData);
+
+	/** Binds or unbinds the ASC change delegates to match the attributes the watches need */
+	void UpdateWatchBindings();
+
+	TArray<FRangeWatch> RangeWatches;
+
+	/** Change delegate handles on the owning ASC, by GetAllAttributes index */
+	TArray<FDelegateHandle> WatchDelegateHandles;
+
+	int32 NextRangeWatchId = 1;
+
 };
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GameplayEffectTypes.h"
+#include "ACM_AuraComponent.generated.h"
+
+class UGameplayEffect;
+
+/**
+ * Area buff/debuff around its owner. Targets inside the radius get EffectClass applied once when they enter
+ * and removed when they leave. Use an infinite duration effect. All auras of a world are evaluated together
+ * by UACM_AuraSubsystem on the server, this component only holds the configuration and the handles.
+ */
+UCLASS(ClassGroup = (GameplayAbility), meta = (BlueprintSpawnableComponent))
+class ARKDECM_API UACM_AuraComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_AuraComponent();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Aura")
+	float Radius;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Aura")
+	TSubclassOf<UGameplayEffect> EffectClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Aura")
+	float EffectLevel;
+
+	/** Whether the aura also affects the actor it is attached to */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Aura")
+	bool bAffectsOwner;
+
+	/** Number of targets currently inside the aura */
+	UFUNCTION(BlueprintCallable, Category = "Aura")
+	int32 GetNumTargetsInside() const { return Inside.Num(); }
+
+protected:
+
+	friend class UACM_AuraSubsystem;
+
+	struct FInsideTarget
+	{
+		int32 TargetIndex;
+		FActiveGameplayEffectHandle EffectHandle;
+	};
+
+	/** Targets inside the aura, sorted by target index so entering and leaving is a merge against the new query */
+	TArray<FInsideTarget> Inside;
+
+	/** Spec built once at registration and applied to every target that enters */
+	FGameplayEffectSpecHandle EffectSpec;
+
+};
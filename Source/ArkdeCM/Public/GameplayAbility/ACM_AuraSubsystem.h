@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "GameplayAbility/ACM_AuraComponent.h"
+#include "ACM_AuraSubsystem.generated.h"
+
+class UAbilitySystemComponent;
+
+/**
+ * Server side evaluation of every UACM_AuraComponent in the world, once per frame in a single batch.
+ * Targets live in a uniform grid that is only updated when a target crosses into another cell, and each aura
+ * only looks at the cells its radius touches. Effects are applied on enter and removed on exit, never reapplied.
+ *
+ * Applying or removing an effect can run game code that registers or unregisters auras and targets. Registrations take
+ * effect right away, unregistrations made while the subsystem is applying or removing effects wait until it is done.
+ */
+UCLASS()
+class ARKDECM_API UACM_AuraSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_AuraSubsystem();
+
+	virtual void Deinitialize() override;
+
+	/** Adds an ASC that auras can affect. Returns its target index */
+	int32 RegisterTarget(UAbilitySystemComponent* AbilitySystemComponent, AActor* Avatar);
+
+	void UnregisterTarget(UAbilitySystemComponent* AbilitySystemComponent);
+
+	void RegisterAura(UACM_AuraComponent* Aura);
+
+	void UnregisterAura(UACM_AuraComponent* Aura);
+
+	/** True if Handle was applied to AbilitySystemComponent by an aura it is inside of. Linear in the auras */
+	bool OwnsEffect(const UAbilitySystemComponent* AbilitySystemComponent, FActiveGameplayEffectHandle Handle) const;
+
+	/** Updates target cells, then enter/exit for every aura */
+	void ProcessAuras();
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+protected:
+
+	struct FTarget
+	{
+		TWeakObjectPtr<UAbilitySystemComponent> AbilitySystemComponent;
+		TWeakObjectPtr<AActor> Avatar;
+		FVector Location = FVector::ZeroVector;
+		FIntPoint Cell = FIntPoint::ZeroValue;
+		bool bActive = false;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	void AddToCell(int32 TargetIndex, const FIntPoint& Cell);
+
+	void RemoveFromCell(int32 TargetIndex, const FIntPoint& Cell);
+
+	void RemoveTarget(int32 TargetIndex);
+
+	void UpdateTargetCells();
+
+	void ProcessAura(UACM_AuraComponent* Aura);
+
+	void ApplyAuraEffect(UACM_AuraComponent* Aura, int32 TargetIndex, FActiveGameplayEffectHandle& OutHandle);
+
+	void RemoveAuraEffect(int32 TargetIndex, const FActiveGameplayEffectHandle& Handle);
+
+	/** Brackets code that applies or removes effects. The outermost End runs the unregistrations made in between */
+	void BeginEffectChanges();
+	void EndEffectChanges();
+
+protected:
+
+	/** Grid cell edge in world units. Larger than a typical aura radius so most queries touch 4 cells or fewer */
+	float CellSize;
+
+	TArray<FTarget> Targets;
+
+	TArray<int32> FreeTargetIndices;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	UPROPERTY(Transient)
+	TArray<UACM_AuraComponent*> Auras;
+
+	int32 EffectChangeDepth;
+
+	/** Unregistrations made while effects were being applied or removed */
+	UPROPERTY(Transient)
+	TArray<UACM_AuraComponent*> PendingAuraRemovals;
+
+	TArray<const UAbilitySystemComponent*> PendingTargetRemovals;
+
+	/** Scratch buffer for the targets found by one aura query, kept to avoid per-aura allocations */
+	TArray<int32> QueryResults;
+
+	/** Scratch buffer the new inside list of an aura is merged into */
+	TArray<UACM_AuraComponent::FInsideTarget> MergedInside;
+
+};
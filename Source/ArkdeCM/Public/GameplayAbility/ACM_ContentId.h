@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Stable 32 bit ids for gameplay content classes, a CRC of the class path.
+ * The same class gets the same id on every machine and in every build, so ids can be stored in compact records and
+ * resolved back on a client that has the class loaded.
+ */
+namespace ACM_ContentId
+{
+
+	/** 0 for no class */
+	ARKDECM_API uint32 FromClass(const UClass* Class);
+
+	/** Loaded class derived from BaseClass with the given id, null if none is loaded */
+	ARKDECM_API UClass* FindClass(uint32 ContentId, const UClass* BaseClass);
+
+}
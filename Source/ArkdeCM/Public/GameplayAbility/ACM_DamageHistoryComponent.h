@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ACM_DamageHistoryComponent.generated.h"
+
+class UGameplayAbility;
+class UGameplayEffect;
+
+/** One damage or heal as shown in the death recap */
+USTRUCT(BlueprintType)
+struct ARKDECM_API FACM_DeathRecapEntry
+{
+	GENERATED_BODY()
+
+	/** Seconds between this change and the death */
+	UPROPERTY(BlueprintReadOnly, Category = "Death Recap")
+	float TimeBeforeDeath = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Death Recap")
+	FString SourceName;
+
+	/** Null when the ability is not loaded on this machine */
+	UPROPERTY(BlueprintReadOnly, Category = "Death Recap")
+	TSubclassOf<UGameplayAbility> AbilityClass;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Death Recap")
+	TSubclassOf<UGameplayEffect> EffectClass;
+
+	/** Negative for damage, positive for heals */
+	UPROPERTY(BlueprintReadOnly, Category = "Death Recap")
+	float Amount = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Death Recap")
+	float ResultingHealth = 0.0f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FACM_OnDeathRecapReceived, const TArray<FACM_DeathRecapEntry>&, Entries);
+
+/**
+ * Server side history of the last Capacity health changes of a character, sent to the owning player as one
+ * compressed RPC when the character dies.
+ * Records live in a ring buffer allocated once at BeginPlay, so recording never allocates and the memory per
+ * character is fixed. It shows up in ACM.Footprint through GetResourceSizeEx and in the ArkdeCM memory stats.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class ARKDECM_API UACM_DamageHistoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_DamageHistoryComponent();
+
+	/** Records kept per character */
+	UPROPERTY(EditDefaultsOnly, Category = "Death Recap", meta = (ClampMin = "1", ClampMax = "256"))
+	int32 Capacity;
+
+	UPROPERTY(BlueprintAssignable, Category = "Death Recap")
+	FACM_OnDeathRecapReceived OnDeathRecapReceived;
+
+	/** Called by UACM_AttributeSet for every executed Health change on the server */
+	void RecordHealthChange(const struct FGameplayEffectModCallbackData& Data, float ResultingHealth);
+
+	/** Marks the character dead and sends the recap to its player. Only the first call per life does anything */
+	void HandleDeath();
+
+	/** Clears the history and the dead state for a new life. Called when Health rises above zero after a death */
+	void ResetHistory();
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+protected:
+
+	UFUNCTION(Client, Reliable)
+	void ClientReceiveDeathRecap(const TArray<uint8>& CompressedRecap, int32 UncompressedSize);
+
+	struct FRecord
+	{
+		float ServerTime;
+		float Amount;
+		float ResultingHealth;
+		uint32 AbilityId;
+		uint32 EffectId;
+		TWeakObjectPtr<AActor> Source;
+	};
+
+	void HandleHealthChanged(const struct FOnAttributeChangeData& Data);
+
+	/** Serializes the records oldest first, with source names resolved and times relative to now */
+	void WriteRecap(TArray<uint8>& OutBytes) const;
+
+protected:
+
+	TArray<FRecord> Records;
+
+	/** Slot the next record is written to */
+	int32 NextRecord;
+
+	int32 NumRecords;
+
+	bool bDead;
+
+	FDelegateHandle HealthChangedHandle;
+
+};
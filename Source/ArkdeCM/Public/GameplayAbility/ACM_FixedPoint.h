@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Deterministic fixed-point math for UACM_AttributeSet (ACM.Attributes.FixedPoint).
+ * Values are snapped to multiples of 1/256. Below 65536 such values are exact in a float, so sums of them (regen
+ * ticks, additive modifiers) are exact as well and do not depend on operation order. Rescales are done in integer
+ * math. Client and server therefore land on bit identical values, and replication has nothing to send when the
+ * quantized value did not change.
+ */
+namespace ACM_FixedPoint
+{
+
+	constexpr int32 FractionBits = 8;
+	constexpr int64 One = int64(1) << FractionBits;
+
+	/** Read by UACM_AttributeSet on the server when a set is created, clients follow the replicated value of the set */
+	ARKDECM_API bool IsEnabled();
+
+	FORCEINLINE int64 ToFixed(float Value)
+	{
+		// Scaling by a power of two and adding one half are exact in double, the floor makes ties round up everywhere
+		return static_cast<int64>(FMath::FloorToDouble(static_cast<double>(Value) * One + 0.5));
+	}
+
+	FORCEINLINE float FromFixed(int64 Value)
+	{
+		return static_cast<float>(static_cast<double>(Value) / One);
+	}
+
+	FORCEINLINE float Quantize(float Value)
+	{
+		return FromFixed(ToFixed(Value));
+	}
+
+	/** Integer division rounding half away from zero, Denominator must be positive */
+	FORCEINLINE int64 DivideRounded(int64 Numerator, int64 Denominator)
+	{
+		return Numerator >= 0 ? (Numerator + Denominator / 2) / Denominator : -((-Numerator + Denominator / 2) / Denominator);
+	}
+
+	/** Value * NewMax / OldMax, the proportional rescale used when a Max attribute changes */
+	FORCEINLINE float Rescale(float Value, float OldMaxValue, float NewMaxValue)
+	{
+
+		const int64 FixedOldMax = ToFixed(OldMaxValue);
+		if (FixedOldMax <= 0)
+		{
+			return Quantize(NewMaxValue);
+		}
+
+		return FromFixed(DivideRounded(ToFixed(Value) * ToFixed(NewMaxValue), FixedOldMax));
+
+	}
+
+	/** Rate per second over DeltaSeconds, clamped to MaxValue */
+	FORCEINLINE float Regen(float Value, float RatePerSecond, float DeltaSeconds, float MaxValue)
+	{
+
+		const int64 FixedGain = DivideRounded(ToFixed(RatePerSecond) * ToFixed(DeltaSeconds), One);
+		return FromFixed(FMath::Min(ToFixed(Value) + FixedGain, ToFixed(MaxValue)));
+
+	}
+
+}
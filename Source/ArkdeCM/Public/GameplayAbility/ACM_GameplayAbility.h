@@ -4,9 +4,25 @@
 
 #include "CoreMinimal.h"
 #include "Abilities/GameplayAbility.h"
+#include "GameplayAbility/ACM_LevelValues.h"
+#include "Tuning/ACM_TuningTable.h"
 #include "ArkdeCM/ArkdeCM.h"
 #include "ACM_GameplayAbility.generated.h"
 
+/** How an ability's activation relates to the other abilities active on the same ASC */
+UENUM(BlueprintType)
+enum class EACM_AbilityActivationGroup : uint8
+{
+	// Runs alongside anything else
+	Independent UMETA(DisplayName = "Independent"),
+	// Exclusive, cancelled when another exclusive ability activates
+	Exclusive_Replaceable UMETA(DisplayName = "Exclusive Replaceable"),
+	// Exclusive, blocks other exclusive abilities while active
+	Exclusive_Blocking UMETA(DisplayName = "Exclusive Blocking"),
+
+	MAX UMETA(Hidden)
+};
+
 /**
  * 
  */
@@ -29,4 +45,71 @@ public:
 
 	/* -------------Ability Input IDs End -------------- */
 
+	/* ----- Activation Group START ----- */
+
+	/** Tracked per ASC by UACM_AbilitySystemComponent, e.g. Sprint as Exclusive_Replaceable and casts as Exclusive_Blocking */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Gameplay Ability")
+	EACM_AbilityActivationGroup ActivationGroup;
+
+	virtual bool CanActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayTagContainer* SourceTags = nullptr, const FGameplayTagContainer* TargetTags = nullptr, OUT FGameplayTagContainer* OptionalRelevantTags = nullptr) const override;
+
+	/* ----- Activation Group END ----- */
+
+	/* ----- Level Magnitudes START ----- */
+
+	/** SetByCaller magnitudes by ability level, set on every effect spec this ability makes */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Gameplay Ability")
+	TMap<FGameplayTag, FScalableFloat> LevelMagnitudes;
+
+	/** LevelMagnitudes entry at Level, read from the per-class cache. 0 when the ability has no such entry */
+	UFUNCTION(BlueprintCallable, Category = "Gameplay Ability")
+	float GetLevelMagnitude(FGameplayTag MagnitudeTag, float Level) const;
+
+	/** Builds the level caches of this class and of its cost and cooldown effects, so the first activation does not */
+	void WarmLevelCaches() const;
+
+	virtual FGameplayEffectSpecHandle MakeOutgoingGameplayEffectSpec(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, TSubclassOf<UGameplayEffect> GameplayEffectClass, float Level = 1.f) const override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+protected:
+
+	struct FLevelCache
+	{
+		int32 CurveGeneration = INDEX_NONE;
+		TMap<FGameplayTag, FACM_LevelValues> Magnitudes;
+	};
+
+	/** Cache of the class, kept on the CDO so instanced abilities share it. Rebuilt when a curve table reloads */
+	const FLevelCache& GetLevelCache() const;
+
+	mutable FLevelCache LevelCache;
+
+	/* ----- Level Magnitudes END ----- */
+
+public:
+
+	/* ----- Tuning START ----- */
+
+	/**
+	 * Values of this ability class in the loaded FACM_TuningTable. A tuned Cooldown replaces the cooldown effect
+	 * duration. A tuned Cost is passed to the cost effect as SetByCaller Data.Cost, negated so an Additive modifier drains
+	 */
+	FACM_AbilityTuning GetTuning() const;
+
+	virtual bool CheckCost(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, OUT FGameplayTagContainer* OptionalRelevantTags = nullptr) const override;
+
+	virtual void ApplyCost(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo) const override;
+
+	virtual void ApplyCooldown(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo) const override;
+
+protected:
+
+	/** ACM_ContentId of the class, resolved on first use */
+	mutable uint32 TuningOwnerId = 0;
+
+	/* ----- Tuning END ----- */
+
 };
@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameplayEffect.h"
+#include "GameplayAbility/ACM_TagBits.h"
+#include "GameplayAbility/ACM_LevelValues.h"
+#include "Tuning/ACM_TuningTable.h"
 #include "ACM_GameplayEffect.generated.h"
 
 /**
@@ -13,5 +16,57 @@ UCLASS()
 class ARKDECM_API UACM_GameplayEffect : public UGameplayEffect
 {
 	GENERATED_BODY()
+
+public:
+
+	/** ApplicationTagRequirements and GrantedApplicationImmunityTags as FACM_TagIndex masks, built on first use */
+	struct FTagMasks
+	{
+		FACM_TagBits ApplicationRequireBits;
+		FACM_TagBits ApplicationIgnoreBits;
+		FACM_TagBits ImmunityRequireBits;
+		FACM_TagBits ImmunityIgnoreBits;
+
+		/** False when a tag could not be indexed, the container queries must be used instead */
+		bool bApplicationExact = false;
+		bool bImmunityExact = false;
+	};
+
+	const FTagMasks& GetTagMasks() const;
+
+	/** Values of this effect class in the loaded FACM_TuningTable, applied by UACM_AbilitySystemComponent::MakeOutgoingSpec */
+	FACM_EffectTuning GetTuning() const;
+
+	/** ScalableFloat duration at Level from the level cache. False for other duration types and uncached levels */
+	bool TryGetDurationAtLevel(float Level, float& OutDuration) const;
+
+	/** ScalableFloat magnitude of Modifiers[ModifierIndex] at Level from the level cache */
+	bool TryGetModifierMagnitudeAtLevel(int32 ModifierIndex, float Level, float& OutMagnitude) const;
+
+	/** Evaluates the duration and modifier magnitudes for every cached level, if that was not done yet */
+	void WarmLevelCache() const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+protected:
+
+	mutable FTagMasks TagMasks;
+
+	mutable bool bTagMasksBuilt = false;
+
+	struct FLevelCache
+	{
+		int32 CurveGeneration = INDEX_NONE;
+		FACM_LevelValues Duration;
+		TArray<FACM_LevelValues> ModifierMagnitudes;
+	};
+
+	/** Rebuilt when a curve table reloads or the effect is edited */
+	mutable FLevelCache LevelCache;
+
+	/** ACM_ContentId of the class, resolved on first use */
+	mutable uint32 TuningOwnerId = 0;
 	
 };
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+
+/**
+ * Gameplay tags ArkdeCM code refers to, added to the tag manager as native tags when the module starts.
+ * Public tags are character states every client may see. Their position in PublicTags is the bit they use in
+ * FACM_PublicTagState, so new entries are appended and the list stays within FACM_PublicTagState::MaxTags.
+ */
+struct ARKDECM_API FACM_GameplayTags
+{
+
+	static const FACM_GameplayTags& Get() { return GameplayTags; }
+
+	static void InitializeNativeTags();
+
+	/** Bit of a public tag, INDEX_NONE if the tag is not public */
+	int32 GetPublicTagIndex(const FGameplayTag& Tag) const;
+
+	FGameplayTag State_Stunned;
+	FGameplayTag State_Sprinting;
+	FGameplayTag State_Dead;
+	FGameplayTag State_Casting;
+
+	/** SetByCaller magnitudes filled from FACM_TuningTable */
+	FGameplayTag Data_Cost;
+	FGameplayTag Data_Magnitude;
+
+	TArray<FGameplayTag> PublicTags;
+
+private:
+
+	void AddTag(FGameplayTag& OutTag, const ANSICHAR* TagName, const ANSICHAR* TagComment);
+
+	void AddPublicTag(FGameplayTag& OutTag, const ANSICHAR* TagName, const ANSICHAR* TagComment);
+
+	static FACM_GameplayTags GameplayTags;
+
+};
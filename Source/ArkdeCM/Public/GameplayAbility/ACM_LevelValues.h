@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FScalableFloat;
+struct FGameplayEffectModifierMagnitude;
+
+/**
+ * A scalable float evaluated once for every level from 1 to MaxLevel, in a flat array indexed by level.
+ * Reading a level is an array access instead of a curve key search. Whole levels past MaxLevel and fractional
+ * levels are not cached, and callers evaluate the source for those.
+ */
+struct ARKDECM_API FACM_LevelValues
+{
+
+	static const int32 MaxLevel = 32;
+
+	/** Value at level L is Values[L - 1]. Empty when the source is not a static value */
+	TArray<float> Values;
+
+	void Build(const FScalableFloat& Source);
+
+	/** Only ScalableFloat magnitudes are static, other calculation types leave Values empty */
+	void Build(const FGameplayEffectModifierMagnitude& Source);
+
+	bool TryGet(float Level, float& OutValue) const;
+
+	/**
+	 * Curve tables bump the engine's cached curve id when they are reimported or edited. Caches store the id they were
+	 * built with and rebuild when it has moved on.
+	 */
+	static int32 GetCurveGeneration();
+
+};
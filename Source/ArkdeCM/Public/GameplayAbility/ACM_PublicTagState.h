@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ACM_PublicTagState.generated.h"
+
+/**
+ * Bit packed presence of the FACM_GameplayTags public tags on one character, loose tags included. It is the only
+ * way clients learn about public tags, the server also reads it for spectator snapshots and instant replays.
+ * Replicated with NetDeltaSerialize: the first send carries every bit, later sends only carry the index and the new
+ * value of the bits that differ from the state the connection last acknowledged.
+ */
+USTRUCT()
+struct ARKDECM_API FACM_PublicTagState
+{
+	GENERATED_BODY()
+
+	static constexpr int32 MaxTags = 32;
+
+	bool HasTag(int32 TagIndex) const { return (Bits & (1u << TagIndex)) != 0; }
+
+	void SetTag(int32 TagIndex, bool bValue) { Bits = bValue ? (Bits | (1u << TagIndex)) : (Bits & ~(1u << TagIndex)); }
+
+	uint32 GetBits() const { return Bits; }
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+private:
+
+	UPROPERTY()
+	uint32 Bits = 0;
+
+};
+
+template<>
+struct TStructOpsTypeTraits<FACM_PublicTagState> : public TStructOpsTypeTraitsBase2<FACM_PublicTagState>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
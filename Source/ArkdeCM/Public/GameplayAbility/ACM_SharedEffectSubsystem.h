@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayEffectTypes.h"
+#include "GameplayTagContainer.h"
+#include "ACM_SharedEffectSubsystem.generated.h"
+
+class UAbilitySystemComponent;
+class UGameplayEffect;
+
+/** Handle to a group effect owned by UACM_SharedEffectSubsystem */
+USTRUCT(BlueprintType)
+struct ARKDECM_API FACM_SharedEffectHandle
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Id = INDEX_NONE;
+
+	bool IsValid() const { return Id != INDEX_NONE; }
+};
+
+/**
+ * Party or team wide effects with one authoritative instance. The group holds the duration, the stack count and
+ * the magnitudes; every member ASC still carries its own active infinite entry of the effect class, applied from
+ * the group's single spec, whose SetByCaller magnitudes are driven by the group. There is a single expiry timer
+ * per group, and stack or magnitude changes as well as removal are one call that updates every member. The
+ * per-member entries are not shared: GAS aggregates and replicates active effects per ASC, so a group of N
+ * members still costs N active effects.
+ *
+ * The effect class must use the Infinite duration policy and read its magnitudes from SetByCaller tags.
+ * Members still aggregate the modifiers and replicate granted tags through their own ASC, so attribute values and
+ * tags look exactly like a regular effect to UACM_AttributeSet and to clients. A member whose entry was removed
+ * behind the group's back, e.g. by a cleanse or on death, stops being a member and can be added again.
+ */
+UCLASS()
+class ARKDECM_API UACM_SharedEffectSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Creates the group instance. A Duration of 0 or less never expires */
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	FACM_SharedEffectHandle CreateSharedEffect(TSubclassOf<UGameplayEffect> EffectClass, UAbilitySystemComponent* SourceComponent, float Level, float Duration, const TMap<FGameplayTag, float>& MagnitudesPerStack);
+
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	void RemoveSharedEffect(FACM_SharedEffectHandle Handle);
+
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	bool AddMember(FACM_SharedEffectHandle Handle, UAbilitySystemComponent* MemberComponent);
+
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	void RemoveMember(FACM_SharedEffectHandle Handle, UAbilitySystemComponent* MemberComponent);
+
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	void SetStackCount(FACM_SharedEffectHandle Handle, int32 StackCount);
+
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	void SetMagnitude(FACM_SharedEffectHandle Handle, FGameplayTag MagnitudeTag, float MagnitudePerStack);
+
+	/** Restarts the group's single timer */
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	void SetDuration(FACM_SharedEffectHandle Handle, float Duration);
+
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	float GetRemainingDuration(FACM_SharedEffectHandle Handle) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Shared Effects")
+	int32 GetNumMembers(FACM_SharedEffectHandle Handle) const;
+
+	/** True if Handle is a group's entry on AbilitySystemComponent. Linear in the members of all groups */
+	bool OwnsEffect(const UAbilitySystemComponent* AbilitySystemComponent, FActiveGameplayEffectHandle Handle) const;
+
+	virtual void Deinitialize() override;
+
+protected:
+
+	struct FMember
+	{
+		TWeakObjectPtr<UAbilitySystemComponent> AbilitySystemComponent;
+		FActiveGameplayEffectHandle EffectHandle;
+	};
+
+	struct FSharedEffect
+	{
+		int32 StackCount = 1;
+		TMap<FGameplayTag, float> MagnitudesPerStack;
+
+		/** Current per-member magnitudes, MagnitudesPerStack scaled by StackCount */
+		TMap<FGameplayTag, float> Magnitudes;
+
+		/** Applied to members as they join, built once when the group is created */
+		FGameplayEffectSpecHandle EffectSpec;
+
+		FTimerHandle ExpiryTimer;
+		TArray<FMember> Members;
+	};
+
+	void RefreshMagnitudes(FSharedEffect& SharedEffect);
+
+	/** True while the member ASC still carries the group's entry */
+	static bool IsMemberActive(const FMember& Member);
+
+	void RemoveFromMember(const FMember& Member);
+
+protected:
+
+	TMap<int32, FSharedEffect> SharedEffects;
+
+	int32 NextId = 0;
+
+};
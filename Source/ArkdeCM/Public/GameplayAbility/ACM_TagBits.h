@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+
+/** Fixed size bitset over FACM_TagIndex, one bit per indexed tag */
+struct ARKDECM_API FACM_TagBits
+{
+
+	static constexpr int32 NumWords = 2;
+	static constexpr int32 MaxBits = NumWords * 64;
+
+	uint64 Words[NumWords] = {};
+
+	FORCEINLINE void SetBit(int32 BitIndex, bool bValue)
+	{
+		const uint64 Mask = uint64(1) << (BitIndex & 63);
+		Words[BitIndex >> 6] = bValue ? (Words[BitIndex >> 6] | Mask) : (Words[BitIndex >> 6] & ~Mask);
+	}
+
+	FORCEINLINE bool HasBit(int32 BitIndex) const
+	{
+		return (Words[BitIndex >> 6] & (uint64(1) << (BitIndex & 63))) != 0;
+	}
+
+	FORCEINLINE bool HasAll(const FACM_TagBits& Other) const
+	{
+		return (Words[0] & Other.Words[0]) == Other.Words[0] && (Words[1] & Other.Words[1]) == Other.Words[1];
+	}
+
+	FORCEINLINE bool HasAny(const FACM_TagBits& Other) const
+	{
+		return ((Words[0] & Other.Words[0]) | (Words[1] & Other.Words[1])) != 0;
+	}
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return (Words[0] | Words[1]) == 0;
+	}
+
+	FORCEINLINE FACM_TagBits& operator|=(const FACM_TagBits& Other)
+	{
+		Words[0] |= Other.Words[0];
+		Words[1] |= Other.Words[1];
+		return *this;
+	}
+
+	FORCEINLINE void Reset()
+	{
+		Words[0] = 0;
+		Words[1] = 0;
+	}
+
+	/** Calls Func with the index of every set bit */
+	template<typename FuncType>
+	void ForEachSetBit(FuncType Func) const
+	{
+		for (int32 WordIndex = 0; WordIndex < NumWords; WordIndex++)
+		{
+			uint64 Word = Words[WordIndex];
+			while (Word != 0)
+			{
+				const int32 BitIndex = static_cast<int32>(FMath::CountTrailingZeros64(Word));
+				Func(WordIndex * 64 + BitIndex);
+				Word &= Word - 1;
+			}
+		}
+	}
+
+};
+
+/**
+ * Assigns bit indices to the gameplay tags effect requirements are written against, in the order they are first seen.
+ * Indices are never reassigned, and the generation changes whenever a tag is added so cached bitsets know to rebuild.
+ * Tag containers only map to bits when every tag in them got an index; callers fall back to container queries
+ * otherwise, so the bitsets always give the same answer as the containers.
+ */
+class ARKDECM_API FACM_TagIndex
+{
+
+public:
+
+	/** Returns INDEX_NONE once every bit is taken */
+	static int32 FindOrAddTag(const FGameplayTag& Tag);
+
+	static const FGameplayTag& GetTag(int32 BitIndex);
+
+	/** Builds the mask of a requirement container. Returns false if a tag could not be indexed */
+	static bool MakeRequirementBits(const FGameplayTagContainer& Tags, FACM_TagBits& OutBits);
+
+	/** Bits of every indexed tag that Tag matches, the tag itself and its indexed parents */
+	static const FACM_TagBits& GetMatchingBits(const FGameplayTag& Tag);
+
+	/** Bits set for an owned tag container, matching FGameplayTagContainer::HasTag on each indexed tag */
+	static FACM_TagBits MakeOwnedBits(const FGameplayTagContainer& OwnedTags);
+
+	static uint32 GetGeneration();
+
+};
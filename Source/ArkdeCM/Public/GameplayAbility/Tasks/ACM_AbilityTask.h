@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Abilities/Tasks/AbilityTask.h"
+#include "ACM_AbilityTask.generated.h"
+
+class UACM_AbilitySystemComponent;
+
+/**
+ * Ability task that goes back to a per-ASC pool when it ends, instead of being left for garbage collection.
+ * Pooled types are created through NewPooledAbilityTask, which hands out a finished task of the same class from the
+ * owning UACM_AbilitySystemComponent when one is free.
+ *
+ * Reset contract: an OnDestroy override removes every binding the task made on other objects before calling Super,
+ * which checks that with HasTargetBindings in debug builds. Once OnDestroy has run, ResetForReuse must put every
+ * member back to its constructor value and unbind every delegate the task owns. Timers bound to the task and the
+ * UAbilityTask wait state are reset by the base class. Tasks only go back into use on a later frame, so code that is still unwinding from the
+ * end of a task never touches its next use.
+ *
+ * Every use of a task has its own pool generation. Callbacks a task binds carry the generation they were bound in
+ * and do nothing, broadcasts included, once the task has ended. Code that has to keep a task beyond its end keeps a
+ * TACM_PooledTaskPtr, which returns null from then on instead of aliasing the next use.
+ */
+UCLASS(Abstract)
+class ARKDECM_API UACM_AbilityTask : public UAbilityTask
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Same as NewAbilityTask, but reuses a pooled task of the same class when the owning ASC has one */
+	template<class T>
+	static T* NewPooledAbilityTask(UGameplayAbility* ThisAbility, FName InstanceName = FName())
+	{
+		return CastChecked<T>(AcquireTask(T::StaticClass(), ThisAbility, InstanceName));
+	}
+
+	/** Frame the task last went back to its pool */
+	uint64 GetReleasedFrame() const { return ReleasedFrame; }
+
+	/** Changes every time the task ends */
+	uint32 GetPoolGeneration() const { return PoolGeneration; }
+
+	/** False once the use Generation was taken from has ended */
+	bool IsCurrentUse(uint32 Generation) const { return Generation == PoolGeneration && !IsPendingKill(); }
+
+protected:
+
+	static UACM_AbilityTask* AcquireTask(UClass* TaskClass, UGameplayAbility* ThisAbility, FName InstanceName);
+
+	virtual void OnDestroy(bool bInOwnerFinished) override;
+
+	/** See the reset contract above. Overrides call Super last */
+	virtual void ResetForReuse();
+
+	/**
+	 * True while the task is still bound to another object. Asked on the target itself, before Ability and
+	 * AbilitySystemComponent are cleared. Checked in debug builds
+	 */
+	virtual bool HasTargetBindings() const;
+
+	/** True when a delegate of this task is still bound. Checked in debug builds after ResetForReuse */
+	bool HasBoundDelegates() const;
+
+protected:
+
+	/** ASC the task returns to when it ends */
+	TWeakObjectPtr<UACM_AbilitySystemComponent> PoolOwner;
+
+	uint64 ReleasedFrame = 0;
+
+	uint32 PoolGeneration = 0;
+
+};
+
+/** Weak pointer to one use of a pooled task. Get returns null once that use ended, even when the object was reused */
+template<class T>
+class TACM_PooledTaskPtr
+{
+
+public:
+
+	TACM_PooledTaskPtr() = default;
+
+	TACM_PooledTaskPtr(T* InTask)
+		: Task(InTask)
+		, Generation(InTask != nullptr ? InTask->GetPoolGeneration() : 0)
+	{
+	}
+
+	T* Get() const
+	{
+		T* Pointer = Task.Get();
+		return Pointer != nullptr && Pointer->IsCurrentUse(Generation) ? Pointer : nullptr;
+	}
+
+private:
+
+	TWeakObjectPtr<T> Task;
+
+	uint32 Generation = 0;
+
+};
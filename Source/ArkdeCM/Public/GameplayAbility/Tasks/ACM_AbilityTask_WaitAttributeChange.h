@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+#include "GameplayAbility/Tasks/ACM_AbilityTask.h"
+#include "ACM_AbilityTask_WaitAttributeChange.generated.h"
+
+struct FOnAttributeChangeData;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FACM_WaitAttributeChangeDelegate, float, NewValue, float, OldValue);
+
+/** Pooled, reduced UAbilityTask_WaitAttributeChange: fires on any change of the attribute, without tag or value filters */
+UCLASS()
+class ARKDECM_API UACM_AbilityTask_WaitAttributeChange : public UACM_AbilityTask
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintAssignable)
+	FACM_WaitAttributeChangeDelegate OnChange;
+
+	/** The task is pooled, do not keep a reference to it once it finished */
+	UFUNCTION(BlueprintCallable, Category = "Ability|Tasks", meta = (DisplayName = "Wait Attribute Change (Pooled)", HidePin = "OwningAbility", DefaultToSelf = "OwningAbility", BlueprintInternalUseOnly = "TRUE"))
+	static UACM_AbilityTask_WaitAttributeChange* WaitAttributeChange(UGameplayAbility* OwningAbility, FGameplayAttribute Attribute, bool bTriggerOnce = true);
+
+	virtual void Activate() override;
+
+protected:
+
+	virtual void OnDestroy(bool bInOwnerFinished) override;
+
+	virtual void ResetForReuse() override;
+
+	virtual bool HasTargetBindings() const override;
+
+	void OnAttributeChange(const FOnAttributeChangeData& CallbackData, uint32 Generation);
+
+protected:
+
+	FGameplayAttribute Attribute;
+
+	bool bTriggerOnce = true;
+
+	FDelegateHandle OnAttributeChangeDelegateHandle;
+
+};
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+#include "GameplayAbility/Tasks/ACM_AbilityTask.h"
+#include "ACM_AbilityTask_WaitAttributeRange.generated.h"
+
+class UACM_AttributeSet;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FACM_WaitAttributeRangeDelegate, float, Value);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FACM_AttributeRangeForecastDelegate, float, SecondsUntilInRange);
+
+/**
+ * Waits until an attribute of a UACM_AttributeSet is within [MinValue, MaxValue], e.g. "Mana >= cost". The task holds a
+ * range watch on the set and is only woken when a change enters the range, never for changes that stay outside it.
+ *
+ * With bUseRegenForecast, OnForecast reports when the regen rate of a resource attribute below the range reaches
+ * MinValue, for UI such as a cooldown bar. It is reported when the wait starts and again when the regen rate changes.
+ * The forecast never ends the wait: regen is applied as effects, so entry is always seen through a change.
+ */
+UCLASS()
+class ARKDECM_API UACM_AbilityTask_WaitAttributeRange : public UACM_AbilityTask
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintAssignable)
+	FACM_WaitAttributeRangeDelegate OnEntered;
+
+	/** Seconds until regen brings the attribute into range, -1 when it will not */
+	UPROPERTY(BlueprintAssignable)
+	FACM_AttributeRangeForecastDelegate OnForecast;
+
+	/**
+	 * Fires OnEntered right away when the attribute already is in range, unless bOnlyTriggerOnEnter.
+	 * The task is pooled, do not keep a reference to it once it finished
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Ability|Tasks", meta = (DisplayName = "Wait Attribute Range (Pooled)", HidePin = "OwningAbility", DefaultToSelf = "OwningAbility", BlueprintInternalUseOnly = "TRUE"))
+	static UACM_AbilityTask_WaitAttributeRange* WaitAttributeRange(UGameplayAbility* OwningAbility, FGameplayAttribute Attribute, float MinValue, float MaxValue = 1000000000.0f, bool bTriggerOnce = true, bool bOnlyTriggerOnEnter = false, bool bUseRegenForecast = true);
+
+	virtual void Activate() override;
+
+protected:
+
+	virtual void OnDestroy(bool bInOwnerFinished) override;
+
+	virtual void ResetForReuse() override;
+
+	virtual bool HasTargetBindings() const override;
+
+	UACM_AttributeSet* FindAttributeSet() const;
+
+	void HandleRangeEntered(float Value, uint32 Generation);
+
+	/** Reports the forecast from the current value and regen rate */
+	void BroadcastForecast(uint32 Generation);
+
+protected:
+
+	FGameplayAttribute Attribute;
+
+	float MinValue = 0.0f;
+
+	float MaxValue = 0.0f;
+
+	bool bTriggerOnce = true;
+
+	bool bOnlyTriggerOnEnter = false;
+
+	bool bUseRegenForecast = true;
+
+	TWeakObjectPtr<UACM_AttributeSet> WatchedSet;
+
+	int32 WatchId = 0;
+
+};
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayAbility/Tasks/ACM_AbilityTask.h"
+#include "ACM_AbilityTask_WaitDelay.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FACM_WaitDelayDelegate);
+
+/** Pooled UAbilityTask_WaitDelay */
+UCLASS()
+class ARKDECM_API UACM_AbilityTask_WaitDelay : public UACM_AbilityTask
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintAssignable)
+	FACM_WaitDelayDelegate OnFinish;
+
+	/** Waits Time seconds. The task is pooled, do not keep a reference to it once it finished */
+	UFUNCTION(BlueprintCallable, Category = "Ability|Tasks", meta = (DisplayName = "Wait Delay (Pooled)", HidePin = "OwningAbility", DefaultToSelf = "OwningAbility", BlueprintInternalUseOnly = "TRUE"))
+	static UACM_AbilityTask_WaitDelay* WaitDelay(UGameplayAbility* OwningAbility, float Time);
+
+	virtual void Activate() override;
+
+	virtual FString GetDebugString() const override;
+
+protected:
+
+	virtual void ResetForReuse() override;
+
+	void OnTimeFinish(uint32 Generation);
+
+protected:
+
+	float Time = 0.0f;
+
+	float TimeStarted = 0.0f;
+
+};
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayAbility/Tasks/ACM_AbilityTask.h"
+#include "ACM_AbilityTask_WaitInputRelease.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FACM_InputReleaseDelegate, float, TimeHeld);
+
+/** Pooled UAbilityTask_WaitInputRelease */
+UCLASS()
+class ARKDECM_API UACM_AbilityTask_WaitInputRelease : public UACM_AbilityTask
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(BlueprintAssignable)
+	FACM_InputReleaseDelegate OnRelease;
+
+	/**
+	 * Waits until the input of the ability is released. With bTestAlreadyReleased, fires right away when it already is.
+	 * The task is pooled, do not keep a reference to it once it finished
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Ability|Tasks", meta = (DisplayName = "Wait Input Release (Pooled)", HidePin = "OwningAbility", DefaultToSelf = "OwningAbility", BlueprintInternalUseOnly = "TRUE"))
+	static UACM_AbilityTask_WaitInputRelease* WaitInputRelease(UGameplayAbility* OwningAbility, bool bTestAlreadyReleased = false);
+
+	virtual void Activate() override;
+
+protected:
+
+	/** Unbinds from the ASC while the spec handle and prediction key are still those of this use */
+	virtual void OnDestroy(bool bInOwnerFinished) override;
+
+	virtual void ResetForReuse() override;
+
+	virtual bool HasTargetBindings() const override;
+
+	void OnReleaseCallback(uint32 Generation);
+
+	void RemoveReleaseBinding();
+
+protected:
+
+	float StartTime = 0.0f;
+
+	bool bTestInitialState = false;
+
+	FDelegateHandle DelegateHandle;
+
+};
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MatchHost/ACM_MatchHostTypes.h"
+#include "ACM_MatchHostCommandlet.generated.h"
+
+/**
+ * Local match host. Launches a fixed number of ArkdeCM dedicated servers, pins each one to its own cores,
+ * watches their status reports, places incoming matches on the least loaded idle server and recycles
+ * servers that finished, died or stopped reporting.
+ *
+ * Usage: -run=ACM_MatchHost [-Servers=4] [-BasePort=7777] [-FirstCore=0] [-CoresPerServer=1]
+ *        [-Map=/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap] [-ServerExe=<path>] [-MaxFrameMs=40] [-Duration=0]
+ */
+UCLASS()
+class ARKDECM_API UACM_MatchHostCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_MatchHostCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+
+	struct FManagedServer
+	{
+		int32 Port = 0;
+		int32 FirstCore = 0;
+		FProcHandle ProcessHandle;
+		uint32 ProcessId = 0;
+		double LaunchTime = 0.0;
+		bool bHasStatus = false;
+		FACM_ServerStatus Status;
+		FString PendingMatchId;
+
+		/** Request sent to the server, put back into the inbox when the server does not start it */
+		FACM_MatchRequest PendingRequest;
+		FString PendingRequestFile;
+		double PendingSince = 0.0;
+
+		/** Launches in a row that ended before the server reported, each doubles the wait before the next one */
+		int32 FailedLaunches = 0;
+		double NextLaunchTime = 0.0;
+		bool bAwaitingLaunch = false;
+
+		/** Set when the pending match timed out, the server is recycled */
+		bool bAssignmentTimedOut = false;
+	};
+
+	bool LaunchServer(FManagedServer& Server);
+
+	void StopServer(FManagedServer& Server);
+
+	void RefreshServer(FManagedServer& Server);
+
+	/** Flags a server for recycling when it did not start its pending match within AssignmentTimeout */
+	void CheckPendingMatch(FManagedServer& Server);
+
+	/** Puts the pending match of a server back into the inbox */
+	void RequeuePendingMatch(FManagedServer& Server);
+
+	/** Stops the server and relaunches it, right away or once the backoff of its failed launches has passed */
+	void RecycleServer(FManagedServer& Server);
+
+	bool NeedsRecycle(FManagedServer& Server) const;
+
+	void DispatchMatches();
+
+	FManagedServer* FindServerForMatch();
+
+	float ScoreServer(const FManagedServer& Server) const;
+
+protected:
+
+	TArray<FManagedServer> Servers;
+
+	FString ServerExecutable;
+
+	/** True when no packaged server was given and servers run through this editor binary with the project file */
+	bool bLaunchThroughEditor;
+
+	FString DefaultMap;
+
+	int32 CoresPerServer;
+
+	/** Servers averaging a slower frame than this are not given new matches */
+	float MaxFrameMs;
+
+	/** Seconds without a status report before a server is considered hung */
+	float HeartbeatTimeout;
+
+	/** Seconds a freshly launched server gets before its first report is required */
+	float StartupTimeout;
+
+	/** Seconds a server gets to report the match it was assigned */
+	float AssignmentTimeout;
+
+	/** Longest wait between relaunches of a server that keeps failing */
+	float MaxLaunchBackoff;
+
+};
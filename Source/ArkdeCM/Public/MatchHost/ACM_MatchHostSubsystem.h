@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "MatchHost/ACM_MatchHostTypes.h"
+#include "ACM_MatchHostSubsystem.generated.h"
+
+/**
+ * Server side of the local match host. Only exists on dedicated servers launched with -ACMHostDir=.
+ * Reports players and frame time to the host and picks up match assignments written for this port.
+ */
+UCLASS()
+class ARKDECM_API UACM_MatchHostSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_MatchHostSubsystem();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Ends the current match so the host can recycle this process */
+	UFUNCTION(BlueprintCallable, Category = "Match Host")
+	void FinishMatch();
+
+	EACM_ServerState GetState() const { return State; }
+	const FString& GetMatchId() const { return MatchId; }
+
+protected:
+
+	bool HandleTick(float DeltaTime);
+
+	void PollAssignment();
+
+	/** AssignedSeconds is the FPlatformTime at which the host placed the match */
+	void StartMatch(const FACM_MatchRequest& Request, double AssignedSeconds);
+
+	void UpdateMatchState(int32 NumPlayers);
+
+	void WriteStatus(int32 NumPlayers);
+
+	int32 GetNumPlayers() const;
+
+protected:
+
+	/** Seconds between two status reports */
+	float ReportInterval;
+
+	/** A match nobody joined within this many seconds is considered finished */
+	float MatchJoinTimeout;
+
+	int32 Port;
+
+	EACM_ServerState State;
+
+	FString MatchId;
+
+	int32 MatchesServed;
+
+	bool bMatchHadPlayers;
+
+	float TimeInMatch;
+
+	float TimeSinceReport;
+
+	float FrameTimeAccumulator;
+
+	int32 FrameCount;
+
+	float AverageFrameMs;
+
+	FDelegateHandle TickHandle;
+
+};
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJsonObject;
+
+/** Lifecycle state a match server reports to the local match host */
+enum class EACM_ServerState : uint8
+{
+	Starting,
+	Idle,
+	InMatch,
+	Finished
+};
+
+/**
+ * Load and lifecycle report a server writes periodically into the host control directory.
+ * The host uses it both as a heartbeat and as the input for match placement.
+ */
+struct ARKDECM_API FACM_ServerStatus
+{
+	uint32 ProcessId = 0;
+	int32 Port = 0;
+	EACM_ServerState State = EACM_ServerState::Starting;
+	FString MatchId;
+	int32 NumPlayers = 0;
+	float AverageFrameMs = 0.0f;
+	int32 MatchesServed = 0;
+	FDateTime Timestamp;
+
+	TSharedRef<FJsonObject> ToJson() const;
+	bool FromJson(const TSharedPtr<FJsonObject>& JsonObject);
+};
+
+/** Match pushed by the matchmaker into the host inbox, and forwarded as-is to the chosen server */
+struct ARKDECM_API FACM_MatchRequest
+{
+	FString MatchId;
+	FString MapName;
+	int32 MaxPlayers = 0;
+
+	TSharedRef<FJsonObject> ToJson() const;
+	bool FromJson(const TSharedPtr<FJsonObject>& JsonObject);
+};
+
+/**
+ * File layout shared by the match host, the matchmaker stand-in and the servers.
+ * Everything lives under one control directory (-ACMHostDir=, defaults to Saved/MatchHost):
+ *   Inbox/<MatchId>.json       match requests waiting for placement
+ *   Servers/<Port>.status.json heartbeat written by each server
+ *   Servers/<Port>.assign.json match assignment, consumed by the server
+ */
+namespace ACM_MatchHost
+{
+	ARKDECM_API FString GetControlDirectory();
+	ARKDECM_API FString GetInboxDirectory();
+	ARKDECM_API FString GetStatusFilename(int32 Port);
+	ARKDECM_API FString GetAssignmentFilename(int32 Port);
+
+	/** Writes through a temporary file and a rename so readers never see a partial document */
+	ARKDECM_API bool WriteJsonFile(const FString& Filename, const TSharedRef<FJsonObject>& JsonObject);
+	ARKDECM_API TSharedPtr<FJsonObject> ReadJsonFile(const FString& Filename);
+
+	ARKDECM_API const TCHAR* LexToString(EACM_ServerState State);
+	ARKDECM_API EACM_ServerState ParseServerState(const FString& StateString);
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ACM_MatchmakerCommandlet.generated.h"
+
+/**
+ * Stand-in matchmaker for local testing. Pushes match requests into the match host inbox at a fixed rate.
+ *
+ * Usage: -run=ACM_Matchmaker [-Matches=10] [-Interval=5] [-Map=/Game/ThirdPersonCPP/Maps/ThirdPersonExampleMap] [-MaxPlayers=8]
+ */
+UCLASS()
+class ARKDECM_API UACM_MatchmakerCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_MatchmakerCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+};
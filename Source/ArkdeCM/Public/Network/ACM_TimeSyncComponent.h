@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ACM_TimeSyncComponent.generated.h"
+
+/** Quality of the server time estimate of one client */
+USTRUCT(BlueprintType)
+struct ARKDECM_API FACM_TimeSyncStats
+{
+	GENERATED_BODY()
+
+	/** Round trip of the latest answered ping, in seconds */
+	UPROPERTY(BlueprintReadOnly, Category = "Time Sync")
+	float LastRoundTrip = 0.0f;
+
+	/** Smallest round trip in the sample window, the sample the estimate is built on */
+	UPROPERTY(BlueprintReadOnly, Category = "Time Sync")
+	float MinRoundTrip = 0.0f;
+
+	/** Largest minus smallest round trip in the sample window */
+	UPROPERTY(BlueprintReadOnly, Category = "Time Sync")
+	float RoundTripSpread = 0.0f;
+
+	/** Distance between the smoothed estimate and the best sample, still being slewed out */
+	UPROPERTY(BlueprintReadOnly, Category = "Time Sync")
+	float EstimateError = 0.0f;
+
+	/** Worst case error of the best sample from path asymmetry, half its round trip */
+	UPROPERTY(BlueprintReadOnly, Category = "Time Sync")
+	float ErrorBound = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Time Sync")
+	int32 NumSamples = 0;
+};
+
+/**
+ * Server clock estimate on the owning client of a player controller, added to every player by AArkdeCMGameMode.
+ *
+ * The server clock is the platform clock of the server process, so it has sub-frame precision and is not paused or
+ * dilated with the world. The client pings the server, a burst at first and then every ACM.TimeSync.Interval seconds.
+ * Each ping carries a one byte sequence and each answer that sequence and the server clock, about 5 bytes per second
+ * of payload per client. Of the last samples, the one with the smallest round trip gives the clock offset. The
+ * estimate slews toward it instead of jumping, and never goes backward.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class ARKDECM_API UACM_TimeSyncComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_TimeSyncComponent();
+
+	/** Server clock, exact on the server and estimated on clients. 0 on a client that has no sample yet */
+	static double GetServerTime(const UObject* WorldContextObject);
+
+	/** Exact server clock, only meaningful on the server */
+	static double GetServerClock();
+
+	/** Smoothed, monotonic estimate of the server clock on the owning client, the exact clock on the server */
+	double GetServerTimeEstimate() const;
+
+	/** Server time as float for Blueprint timestamps */
+	UFUNCTION(BlueprintCallable, Category = "Time Sync")
+	float GetServerTimeSeconds() const { return static_cast<float>(GetServerTimeEstimate()); }
+
+	UFUNCTION(BlueprintCallable, Category = "Time Sync")
+	bool IsSynchronized() const { return GetOwnerRole() == ROLE_Authority || Stats.NumSamples > 0; }
+
+	UFUNCTION(BlueprintCallable, Category = "Time Sync")
+	FACM_TimeSyncStats GetStats() const { return Stats; }
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+protected:
+
+	UFUNCTION(Server, Unreliable)
+	void ServerRequestTime(uint8 Sequence);
+
+	UFUNCTION(Client, Unreliable)
+	void ClientReceiveTime(uint8 Sequence, double ServerTime);
+
+	void SendPing();
+
+	void AddSample(double RoundTrip, double Offset);
+
+protected:
+
+	static const int32 MaxPendingPings = 8;
+	static const int32 SampleWindow = 8;
+
+	struct FSample
+	{
+		double RoundTrip = 0.0;
+		double Offset = 0.0;
+	};
+
+	/** Local send time of the last pings, by sequence modulo MaxPendingPings */
+	double PendingSendTimes[MaxPendingPings];
+	uint8 PendingSequences[MaxPendingPings];
+
+	FSample Samples[SampleWindow];
+
+	int32 NextSample;
+
+	uint8 NextSequence;
+
+	/** Server clock minus local clock, from the best sample */
+	double TargetOffset;
+
+	/** Offset the estimate currently uses, slewed toward TargetOffset as the estimate is read */
+	mutable double SmoothedOffset;
+
+	mutable double LastSlewTime;
+
+	mutable double LastEstimate;
+
+	mutable FACM_TimeSyncStats Stats;
+
+	FTimerHandle PingTimerHandle;
+
+	int32 NumBurstPings;
+
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+#include "GameplayEffect.h"
+#include "Persistence/ACM_PlayerSnapshot.h"
+#include "ACM_CheckpointSubsystem.generated.h"
+
+class AArkdeCMGameMode;
+
+/**
+ * Crash recovery for dedicated servers. Every ACM.Checkpoint.Interval seconds the GAS state and score of each player
+ * are copied into the back half of a double buffer. The game thread does nothing more than that: a background
+ * task serializes the front half and appends it as one CRC checked record to Saved/Checkpoints. A checkpoint is
+ * skipped if the previous one is still being written. When the file grows past ACM.Checkpoint.MaxFileMB it
+ * is rotated to .old.
+ *
+ * A server started with -ACMResumeCheckpoint[=File] loads the newest intact record, ignoring a torn tail from the
+ * crash, and hands its snapshots to the game mode. Each returning player gets their state back when their pawn spawns.
+ */
+UCLASS()
+class ARKDECM_API UACM_CheckpointSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	static FString GetCheckpointFilename(const FString& MatchId);
+
+	/** Loads the latest checkpoint named on the command line into the game mode. Returns false without one */
+	bool ResumeFromCommandLine(AArkdeCMGameMode* GameMode);
+
+	bool ResumeFromFile(const FString& Filename, AArkdeCMGameMode* GameMode);
+
+	/** Score a resumed player had in the checkpoint, removed once read */
+	bool ConsumeResumedScore(const FString& PlayerKey, float& OutScore);
+
+	/** Copies the current state into the back buffer and hands it to the writer, unless a write is still running */
+	void Checkpoint();
+
+	/** Game thread cost and writer totals, for ACM.Checkpoint.Stats */
+	void LogStats() const;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	struct FPlayerCheckpoint
+	{
+		FString PlayerKey;
+		float Score = 0.0f;
+		FACM_PlayerSnapshot Snapshot;
+	};
+
+protected:
+
+	struct FCheckpointBuffer
+	{
+		uint32 Sequence = 0;
+		float MatchTime = 0.0f;
+
+		/** Only the first NumPlayers entries are used, the rest keep their allocations for the next checkpoint */
+		TArray<FPlayerCheckpoint> Players;
+		int32 NumPlayers = 0;
+	};
+
+	/** Writer side, runs on the background task */
+	void WriteCheckpoint(FCheckpointBuffer& Buffer);
+
+	bool IsWriting() const { return PendingWrite.IsValid() && !PendingWrite.IsReady(); }
+
+protected:
+
+	FCheckpointBuffer Buffers[2];
+
+	/** Buffer the game thread fills next, the other one belongs to the writer while PendingWrite runs */
+	int32 BackBufferIndex = 0;
+
+	TFuture<void> PendingWrite;
+
+	FString Filename;
+
+	/** Only touched by the writer */
+	TUniquePtr<FArchive> FileWriter;
+
+	uint32 NextSequence = 1;
+
+	float TimeSinceCheckpoint = 0.0f;
+
+	TMap<FString, float> ResumedScores;
+
+	/* Stats */
+
+	int32 NumCheckpoints = 0;
+
+	int32 NumSkipped = 0;
+
+	double TotalCaptureSeconds = 0.0;
+
+	double MaxCaptureSeconds = 0.0;
+
+	TAtomic<int64> BytesWritten { 0 };
+
+	TAtomic<int64> WriteMicroseconds { 0 };
+
+};
+
+/** Infinite +100 MaxHealth. A class rather than a transient effect, snapshots store effects by class path. Used by ACM.Checkpoint.VerifyRoundTrip */
+UCLASS(NotBlueprintable, HideDropdown)
+class ARKDECM_API UACM_CheckpointCheckEffect : public UGameplayEffect
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_CheckpointCheckEffect();
+
+};
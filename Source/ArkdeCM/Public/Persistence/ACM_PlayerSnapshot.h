@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAbilitySystemComponent;
+
+/**
+ * Versioned binary snapshot of a player's GAS state: attribute base values, granted abilities and active effects with
+ * their remaining duration, which also covers cooldowns. Classes and SetByCaller tags are stored once in a string
+ * table and referenced by index, so a snapshot stays valid in another server process.
+ *
+ * Restore replaces the abilities and effects of an ASC in one batch. Done right after the pawn spawns, the restored
+ * state goes out with the pawn's initial bunch instead of through the regular grant paths.
+ *
+ * Effects owned by UACM_SharedEffectSubsystem groups or UACM_AuraSubsystem auras are neither saved nor removed, the
+ * subsystems apply and remove them. Restored effects keep their instigator: the saved actors while they still exist,
+ * otherwise the current pawn of the instigating player, looked up by the same key as the pending player snapshots.
+ */
+struct ARKDECM_API FACM_PlayerSnapshot
+{
+
+	/** Bump whenever the layout or the UACM_AttributeSet attribute list changes. Version 2 added effect instigators, version 1 snapshots still load */
+	static const uint32 CurrentVersion = 2;
+
+	struct FAbility
+	{
+		int32 ClassIndex = INDEX_NONE;
+		int32 Level = 1;
+		int32 InputId = INDEX_NONE;
+	};
+
+	struct FSetByCaller
+	{
+		int32 TagIndex = INDEX_NONE;
+		float Magnitude = 0.0f;
+	};
+
+	struct FEffect
+	{
+		int32 ClassIndex = INDEX_NONE;
+		float Level = 1.0f;
+		int32 StackCount = 1;
+
+		/** Negative for infinite effects */
+		float RemainingDuration = -1.0f;
+
+		TArray<FSetByCaller> SetByCallerMagnitudes;
+
+		/** Player key of the instigator, INDEX_NONE when no player instigated the effect */
+		int32 InstigatorIndex = INDEX_NONE;
+
+		/** Not serialized, only a restore in the same world can use them */
+		TWeakObjectPtr<AActor> Instigator;
+		TWeakObjectPtr<AActor> EffectCauser;
+	};
+
+	uint32 Version = CurrentVersion;
+
+	/** Class paths and tag names referenced by the entries below */
+	TArray<FString> Strings;
+
+	/** UACM_AttributeSet::GetAllAttributes order */
+	TArray<float> AttributeBaseValues;
+
+	TArray<FAbility> Abilities;
+
+	TArray<FEffect> Effects;
+
+	bool IsEmpty() const { return AttributeBaseValues.Num() == 0 && Abilities.Num() == 0 && Effects.Num() == 0; }
+
+	void Reset();
+
+	/** Captures the state of an ASC, replacing the content of this snapshot */
+	void Save(const UAbilitySystemComponent* AbilitySystemComponent);
+
+	/** Authority only. Returns false if nothing could be restored */
+	bool Restore(UAbilitySystemComponent* AbilitySystemComponent) const;
+
+	void Serialize(FArchive& Ar);
+
+	void ToBytes(TArray<uint8>& OutBytes);
+
+	/** Returns false and resets the snapshot on malformed or newer data */
+	bool FromBytes(const TArray<uint8>& Bytes);
+
+protected:
+
+	/** Every index points into Strings */
+	bool HasValidIndices() const;
+
+};
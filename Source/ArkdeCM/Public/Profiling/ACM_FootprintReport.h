@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+/**
+ * Object and memory footprint of one character: the actor, everything outered to it (components, ASC,
+ * attribute set, instanced abilities) and its active effects.
+ *
+ * ACM.Footprint [ActorName] [ReportFile] logs the breakdown and writes it as JSON (defaults to
+ * Saved/Profiling/ACM_Footprint.json). With no character in the world, one is spawned from the default pawn
+ * class for the measurement, so it also runs on an empty headless server through -ExecCmds.
+ *
+ * ACM.Footprint.Check measures a freshly spawned default pawn against ACM.Footprint.MaxKB and
+ * ACM.Footprint.MaxObjects and reports an error when either is exceeded, for CI to catch regressions.
+ */
+struct ARKDECM_API FACM_FootprintReport
+{
+
+	struct FClassEntry
+	{
+		int32 NumObjects = 0;
+
+		/** Exclusive bytes, measured the same way as "obj list" */
+		int64 Bytes = 0;
+
+		/** Bytes of replicated properties, kept once per connection as the replication shadow state */
+		int64 ShadowBytes = 0;
+	};
+
+	TMap<FName, FClassEntry> Classes;
+
+	int32 NumObjects = 0;
+
+	int64 TotalBytes = 0;
+
+	int64 TotalShadowBytes = 0;
+
+	int32 NumActiveEffects = 0;
+
+	/** Part of the ASC's bytes above, not counted in TotalBytes a second time */
+	int64 ActiveEffectBytes = 0;
+
+	static FACM_FootprintReport Build(AActor* Character);
+
+	void Log(const FString& CharacterName) const;
+
+	bool WriteJson(const FString& Filename, const FString& CharacterName) const;
+
+};
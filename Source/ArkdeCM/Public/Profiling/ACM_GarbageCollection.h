@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Keeps the persistent gameplay classes out of the per-pass GC reachability walk.
+ * Blueprint ability and effect classes load after the disregard-for-GC pool closes. With gc.BlueprintClusteringEnabled,
+ * each one becomes the root of its own cluster (class, CDO and everything they own) which GC then visits as a single
+ * object. Without it they are left alone, like every other blueprint class.
+ *
+ * ACM.GC.Measure [NumCharacters=100] spawns that many characters and times full collections with them alive.
+ */
+namespace ACM_GarbageCollection
+{
+	/** Clusters a blueprint UACM_GameplayAbility or UACM_GameplayEffect class when it can be a cluster root. Safe to call repeatedly */
+	ARKDECM_API void ClusterGameplayClass(UClass* GameplayClass);
+}
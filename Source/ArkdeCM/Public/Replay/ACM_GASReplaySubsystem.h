@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "GameplayEffectTypes.h"
+#include "ACM_GASReplaySubsystem.generated.h"
+
+class UAbilitySystemComponent;
+class UDemoNetDriver;
+class UGameplayEffect;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FACM_OnReplayEffectEvent, AActor*, Avatar, TSubclassOf<UGameplayEffect>, EffectClass, int32, StackCount, bool, bStarted);
+
+/**
+ * Compact GAS stream for match replays, enabled with ACM.Replay.CompactGAS (read only, set it from an ini or the
+ * command line).
+ *
+ * The UACM_AttributeSet attributes and the ASC active effect container are then skipped by the replay connection.
+ * While recording, this subsystem samples every attribute at ACM.Replay.GASRate on the fixed grid of
+ * ACM.Replay.GASPrecision and writes only the values that changed, plus one start or stop event per effect instead of
+ * container diffs. The stream is cut into chunks of ACM.Replay.GASChunkSeconds that each begin with a full
+ * keyframe, so scrubbing never needs earlier chunks. Chunks are stored as zlib compressed replay events
+ * next to the regular stream.
+ *
+ * On playback the chunks are fetched once and merged with the demo time: attribute values are written into the
+ * replayed attribute sets as recorded and effect events are broadcast through OnReplayEffectEvent. A stack change is
+ * broadcast as a start with the new stack count.
+ *
+ * To compare against the regular stream, record the same session once with and once without ACM.Replay.CompactGAS.
+ * ACM.Replay.GASCompare compares the two replay files and ACM.Replay.GASStats, run while each one plays back, logs
+ * its playback cost. Both project their numbers to a 30 minute session.
+ */
+UCLASS()
+class ARKDECM_API UACM_GASReplaySubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	static bool IsCompactStreamEnabled();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	void RecordEffectStarted(UAbilitySystemComponent* AbilitySystemComponent, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle);
+
+	void RecordEffectStopped(UAbilitySystemComponent* AbilitySystemComponent, const FActiveGameplayEffect& Effect);
+
+	void RecordEffectStackChanged(UAbilitySystemComponent* AbilitySystemComponent, FActiveGameplayEffectHandle Handle, int32 NewStackCount);
+
+	/** Effects active on Avatar at the current playback time */
+	UFUNCTION(BlueprintCallable, Category = "Replay")
+	void GetReplayActiveEffects(const AActor* Avatar, TArray<TSubclassOf<UGameplayEffect>>& OutEffectClasses) const;
+
+	UPROPERTY(BlueprintAssignable, Category = "Replay")
+	FACM_OnReplayEffectEvent OnReplayEffectEvent;
+
+	/** Recording totals, for ACM.Replay.GASStats */
+	int64 GetRecordedBytes() const { return RecordedBytes; }
+	int32 GetRecordedChunks() const { return RecordedChunks; }
+	double GetRecordingSeconds() const { return RecordingSeconds; }
+
+	/** Playback totals, for ACM.Replay.GASStats. DemoDispatchSeconds is the replay driver's whole receive cost, with or without the compact stream */
+	double GetPlaybackSeconds() const { return PlaybackSeconds; }
+	double GetDemoDispatchSeconds() const { return DemoDispatchSeconds; }
+	double GetPlayedSeconds() const { return PlayedSeconds; }
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	struct FEffectState
+	{
+		uint32 EffectId = 0;
+		int32 StackCount = 0;
+	};
+
+	/** Quantized attributes and active effects of one replicated actor, keyed by its replay NetGUID */
+	struct FActorState
+	{
+		TArray<int32> Values;
+		TMap<uint32, FEffectState> Effects;
+		bool bDirty = false;
+	};
+
+protected:
+
+	struct FChunk
+	{
+		uint32 StartMs = 0;
+		TArray<uint8> Payload;
+	};
+
+	UDemoNetDriver* GetDemoNetDriver() const;
+
+	/* ----- Recording START ----- */
+
+	void SampleAttributes(UDemoNetDriver* DemoNetDriver);
+
+	void BeginChunk(UDemoNetDriver* DemoNetDriver);
+
+	void FlushChunk(UDemoNetDriver* DemoNetDriver);
+
+	/** Time and type of the next record */
+	void WriteRecordHeader(UDemoNetDriver* DemoNetDriver, uint32 RecordType);
+
+	/* ----- Recording END ----- */
+
+	/* ----- Playback START ----- */
+
+	void RequestChunks(UDemoNetDriver* DemoNetDriver);
+
+	void AddChunk(const TArray<uint8>& EventData);
+
+	/** Advances the playback state to TimeMs, restarting from a keyframe when needed */
+	void UpdatePlayback(UDemoNetDriver* DemoNetDriver, uint32 TimeMs);
+
+	void ApplyPlaybackState(UDemoNetDriver* DemoNetDriver);
+
+	/** Times the net dispatch at the start of each frame, which is where the demo driver reads and applies the regular stream */
+	void HandleWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	void HandleWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	/* ----- Playback END ----- */
+
+protected:
+
+	TMap<uint32, FActorState> ActorStates;
+
+	/* Recording */
+
+	TArray<uint8> ChunkBuffer;
+
+	uint32 ChunkStartMs = 0;
+
+	uint32 LastRecordMs = 0;
+
+	bool bChunkOpen = false;
+
+	float TimeSinceSample = 0.0f;
+
+	int64 RecordedBytes = 0;
+
+	int32 RecordedChunks = 0;
+
+	double RecordingSeconds = 0.0;
+
+	/* Playback */
+
+	bool bChunksRequested = false;
+
+	/** Fetched chunks sorted by start time */
+	TArray<FChunk> Chunks;
+
+	int32 PlaybackChunk = INDEX_NONE;
+
+	int32 PlaybackPosition = 0;
+
+	/** Demo time the state was last advanced to */
+	uint32 PlaybackTimeMs = 0;
+
+	/** Time of the last record applied */
+	uint32 PlaybackRecordMs = 0;
+
+	float PlaybackPrecision = 1.0f;
+
+	int32 PlaybackNumAttributes = 0;
+
+	double PlaybackSeconds = 0.0;
+
+	double DemoDispatchSeconds = 0.0;
+
+	double PlayedSeconds = 0.0;
+
+	double DispatchStartSeconds = 0.0;
+
+	FDelegateHandle TickStartHandle;
+
+	FDelegateHandle PreActorTickHandle;
+
+};
@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ACM_InstantReplaySubsystem.generated.h"
+
+class UGameplayAbility;
+
+/** One character in a decoded replay frame */
+USTRUCT(BlueprintType)
+struct ARKDECM_API FACM_ReplayCharacterFrame
+{
+	GENERATED_BODY()
+
+	/** Server side id, only meaningful to follow the same character across frames of one clip */
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	int32 CharacterId = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	FVector Location = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	float Yaw = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	float HealthPercent = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	float ManaPercent = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	float StaminaPercent = 0.0f;
+
+	/** FACM_GameplayTags public tag bits */
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	int32 PublicTagBits = 0;
+};
+
+USTRUCT(BlueprintType)
+struct ARKDECM_API FACM_ReplayAbilityEvent
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	int32 CharacterId = 0;
+
+	/** Null when the ability is not loaded on this machine */
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	TSubclassOf<UGameplayAbility> AbilityClass;
+};
+
+USTRUCT(BlueprintType)
+struct ARKDECM_API FACM_ReplayFrame
+{
+	GENERATED_BODY()
+
+	/** Seconds since the start of the clip */
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	float Time = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	TArray<FACM_ReplayCharacterFrame> Characters;
+
+	/** Abilities activated since the previous frame */
+	UPROPERTY(BlueprintReadOnly, Category = "Replay")
+	TArray<FACM_ReplayAbilityEvent> AbilityEvents;
+};
+
+/**
+ * Server side ring buffer of compact world snapshots for kill-cams and highlights, without a replay recorder.
+ *
+ * At ACM.Replay.Rate every visible AArkdeCMCharacter is sampled: quantized transform, public tags and resource
+ * percentages, plus the abilities activated since the last frame. A frame is stored column by column (all ids,
+ * then all X, ...), each value delta encoded as a varint against the same character in the previous frame, with a
+ * keyframe every ACM.Replay.KeyframeInterval seconds. Frames go into a byte ring of ACM.Replay.MemoryKB, the oldest
+ * ones are dropped up to the next keyframe when it is full, so memory never exceeds the cap.
+ * ExtractClip packs a time window, starting at a keyframe, into one zlib compressed blob that DecodeClip turns back
+ * into frames on the client.
+ */
+UCLASS()
+class ARKDECM_API UACM_InstantReplaySubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	void RecordAbilityActivation(const AActor* Avatar, const UGameplayAbility* Ability);
+
+	/** Packs the last Seconds of recording, at most what is buffered. Returns false if nothing is buffered */
+	bool ExtractClip(float Seconds, TArray<uint8>& OutClip) const;
+
+	static bool DecodeClip(const TArray<uint8>& Clip, TArray<FACM_ReplayFrame>& OutFrames);
+
+	int32 GetBufferedBytes() const { return RingUsed; }
+
+	float GetBufferedSeconds() const;
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	// End of FTickableGameObject interface
+
+	/** Quantized character state as stored in a frame */
+	struct FSample
+	{
+		int32 CharacterId;
+		int32 Location[3];
+		int32 Yaw;
+		int32 Health;
+		int32 Mana;
+		int32 Stamina;
+		uint32 PublicTagBits;
+	};
+
+	struct FAbilityEvent
+	{
+		int32 CharacterId;
+		uint32 AbilityId;
+	};
+
+protected:
+
+	struct FFrameInfo
+	{
+		float Time;
+		int32 Offset;
+		int32 Size;
+		bool bKeyframe;
+	};
+
+	void CaptureFrame();
+
+	void StoreFrame(const TArray<uint8>& FrameBytes, bool bKeyframe);
+
+	void DropOldestFrame();
+
+	void ReadFromRing(int32 Offset, int32 Size, uint8* OutBytes) const;
+
+	/** Buffered frame by age, 0 is the oldest */
+	const FFrameInfo& GetFrame(int32 FrameIndex) const;
+
+protected:
+
+	TArray<uint8> Ring;
+
+	/** Where the next frame is written */
+	int32 RingWrite = 0;
+
+	int32 RingUsed = 0;
+
+	/** Buffered frames as a ring starting at FirstFrameSlot, read through GetFrame. The oldest one is always a keyframe */
+	TArray<FFrameInfo> FrameRing;
+
+	int32 FirstFrameSlot = 0;
+
+	int32 NumBufferedFrames = 0;
+
+	/** Samples of the last stored frame, sorted by id, the base of the next delta */
+	TArray<FSample> PreviousSamples;
+
+	TArray<FSample> CurrentSamples;
+
+	TArray<FAbilityEvent> PendingAbilityEvents;
+
+	TArray<uint8> FrameScratch;
+
+	float TimeSinceCapture = 0.0f;
+
+	float TimeSinceKeyframe = 0.0f;
+
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * LEB128 varints shared by the replay streams. Signed values are zigzag encoded so small deltas of either sign stay
+ * one byte.
+ */
+namespace ACM_VarInt
+{
+
+	inline void WriteUInt(TArray<uint8>& Out, uint32 Value)
+	{
+
+		while (Value >= 0x80)
+		{
+			Out.Add(static_cast<uint8>(Value | 0x80));
+			Value >>= 7;
+		}
+
+		Out.Add(static_cast<uint8>(Value));
+
+	}
+
+	inline void WriteInt(TArray<uint8>& Out, int32 Value)
+	{
+		WriteUInt(Out, (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31));
+	}
+
+	/** Bounds checked reader, bError is set on truncated or overlong input and every later read returns 0 */
+	struct FReader
+	{
+
+		const uint8* Data;
+		int32 Num;
+		int32 Position = 0;
+		bool bError = false;
+
+		FReader(const uint8* InData, int32 InNum) : Data(InData), Num(InNum) {}
+
+		bool AtEnd() const { return bError || Position >= Num; }
+
+		uint32 ReadUInt()
+		{
+
+			uint32 Value = 0;
+			for (int32 Shift = 0; Shift <= 28 && !bError; Shift += 7)
+			{
+
+				if (Position >= Num)
+				{
+					break;
+				}
+
+				const uint8 Byte = Data[Position++];
+				Value |= static_cast<uint32>(Byte & 0x7F) << Shift;
+
+				if ((Byte & 0x80) == 0)
+				{
+					return Value;
+				}
+
+			}
+
+			bError = true;
+			return 0;
+
+		}
+
+		int32 ReadInt()
+		{
+			const uint32 Value = ReadUInt();
+			return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+		}
+
+	};
+
+}
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
+#include "ACM_SpectatorSnapshot.generated.h"
+
+/** What a spectator sees of one character */
+USTRUCT(BlueprintType)
+struct ARKDECM_API FACM_SpectatorCharacterState
+{
+	GENERATED_BODY()
+
+	/** Server side id, only meaningful to match the same character across snapshots */
+	UPROPERTY(BlueprintReadOnly, Category = "Spectator")
+	int32 CharacterId = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spectator")
+	FVector_NetQuantize Location;
+
+	/** Yaw compressed to 256 steps */
+	UPROPERTY()
+	uint8 PackedYaw = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Spectator")
+	uint8 HealthPercent = 0;
+
+	/** FACM_GameplayTags public tag bits */
+	UPROPERTY()
+	uint32 PublicTagBits = 0;
+
+	float GetYaw() const { return FRotator::DecompressAxisFromByte(PackedYaw); }
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FACM_OnSpectatorSnapshot, const TArray<FACM_SpectatorCharacterState>&, Characters);
+
+/**
+ * Replication channel for one spectator. Spectators do not get AArkdeCMCharacter or its ASC replicated at all; this
+ * actor, only relevant to its owner, sends them a few snapshots per second of the characters around their view
+ * point instead: position, yaw, health percentage and public state tags, nothing else.
+ * On the spectator's machine every character is shown as a local SpectatorProxyClass actor that is interpolated
+ * between snapshots.
+ */
+UCLASS()
+class ARKDECM_API AACM_SpectatorSnapshot : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AACM_SpectatorSnapshot();
+
+	/** Snapshots sent per second */
+	UPROPERTY(EditDefaultsOnly, Category = "Spectator", meta = (ClampMin = "0.5"))
+	float SnapshotRate;
+
+	/** Only characters this close to the spectator's view point are sent */
+	UPROPERTY(EditDefaultsOnly, Category = "Spectator")
+	float InterestRadius;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Spectator", meta = (ClampMin = "1"))
+	int32 MaxCharacters;
+
+	/** Local actor spawned on the spectator's machine for every character in the snapshot */
+	UPROPERTY(EditDefaultsOnly, Category = "Spectator")
+	TSubclassOf<AActor> SpectatorProxyClass;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Spectator")
+	float ProxyInterpolationSpeed;
+
+	UPROPERTY(BlueprintAssignable, Category = "Spectator")
+	FACM_OnSpectatorSnapshot OnSnapshotReceived;
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+
+	void CaptureSnapshot();
+
+	void InterpolateProxies(float DeltaSeconds);
+
+	UFUNCTION()
+	void OnRep_Characters();
+
+	UPROPERTY(ReplicatedUsing = OnRep_Characters)
+	TArray<FACM_SpectatorCharacterState> Characters;
+
+	/** Spectator side proxies by CharacterId */
+	UPROPERTY(Transient)
+	TMap<int32, AActor*> Proxies;
+
+};
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "ACM_PrewarmSubsystem.generated.h"
+
+/**
+ * Pre-warm mode for servers launched with -ACMPrewarm. Builds the GAS global data as soon as the game instance starts
+ * and loads every ArkdeCM ability and effect class up front, so nothing on the match start path has to touch the disk.
+ * The game mode reads IsPrewarmMode() to fill its pawn pool and hold logins until a match is assigned.
+ */
+UCLASS()
+class ARKDECM_API UACM_PrewarmSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static bool IsPrewarmMode();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	const TArray<UClass*>& GetPrewarmedClasses() const { return PrewarmedClasses; }
+
+	/**
+	 * Builds the GAS global data once per process and records it as the AbilitySystemGlobals startup phase. Pre-warm
+	 * calls it first thing, every other startup calls it from the module once the engine is initialized
+	 */
+	static void InitAbilitySystemGlobals();
+
+protected:
+
+	void LoadGameplayClasses();
+
+	void ClusterGameplayClasses();
+
+protected:
+
+	/** Ability and effect classes loaded during pre-warm, kept alive for the lifetime of the process */
+	UPROPERTY(Transient)
+	TArray<UClass*> PrewarmedClasses;
+
+};
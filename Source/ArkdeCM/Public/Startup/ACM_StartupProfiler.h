@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Timings for the phases a server goes through before it can take players.
+ * Phases are collected from module load until the first player possesses a character, then written to the log
+ * and to a JSON report (-ACMStartupReport=<file>, defaults to Saved/Profiling/ACM_Startup.json) for CI to track.
+ */
+class ARKDECM_API FACM_StartupProfiler
+{
+
+public:
+
+	struct FPhase
+	{
+		FString Name;
+		double StartSeconds;
+		double DurationMs;
+	};
+
+	/** Records a finished phase with its duration and the time elapsed since process start */
+	static void RecordPhase(const TCHAR* PhaseName, double PhaseStartSeconds);
+
+	/** Records a point in time with no duration */
+	static void RecordMarker(const TCHAR* MarkerName);
+
+	/**
+	 * Opens a phase that ends somewhere else, e.g. across several callbacks. Only the first BeginPhase of a name
+	 * counts while the phase is open
+	 */
+	static void BeginPhase(const TCHAR* PhaseName);
+
+	/** Records the phase opened by BeginPhase. Does nothing when no phase of that name is open */
+	static void EndPhase(const TCHAR* PhaseName);
+
+	/** Records the final marker, then writes the report. Later phases are only logged */
+	static void Finish(const TCHAR* MarkerName);
+
+	static bool IsCollecting();
+
+	static const TArray<FPhase>& GetPhases();
+
+	static double GetSecondsSinceProcessStart();
+
+private:
+
+	static void WriteReport();
+
+};
+
+/** Records the enclosing scope as one startup phase */
+struct ARKDECM_API FACM_ScopedStartupPhase
+{
+
+	explicit FACM_ScopedStartupPhase(const TCHAR* InPhaseName);
+	~FACM_ScopedStartupPhase();
+
+private:
+
+	const TCHAR* PhaseName;
+	double StartSeconds;
+
+};
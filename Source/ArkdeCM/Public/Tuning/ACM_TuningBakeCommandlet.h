@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ACM_TuningBakeCommandlet.generated.h"
+
+/**
+ * Bakes a JSON tuning sheet into the binary FACM_TuningTable format. The sheet maps class paths to field values:
+ *
+ * { "/Game/Abilities/GA_Fireball.GA_Fireball_C": { "Cooldown": 4.0, "Cost": 30.0 },
+ *   "/Script/ArkdeCM.ACM_AttributeSet": { "MaxHealth": 250.0 } }
+ *
+ * Usage: -run=ACM_TuningBake -Source=Tuning.json [-Output=Content/Tuning/ACM_Tuning.acmt]
+ */
+UCLASS()
+class ARKDECM_API UACM_TuningBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UACM_TuningBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+};
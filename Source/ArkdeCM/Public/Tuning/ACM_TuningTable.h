@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FGameplayAttribute;
+
+/** One tuned value. Entries are sorted by owner, then field, so an owner's values are one contiguous range */
+struct FACM_TuningEntry
+{
+	/** ACM_ContentId of the ability, effect or attribute set class */
+	uint32 OwnerId;
+
+	/** ACM_TuningField::Id of the field name */
+	uint32 FieldId;
+
+	float Value;
+
+	uint32 Reserved;
+};
+
+static_assert(sizeof(FACM_TuningEntry) == 16, "FACM_TuningEntry is read straight from the mapped file");
+
+struct FACM_TuningHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 NumEntries;
+	uint32 Reserved;
+};
+
+namespace ACM_TuningField
+{
+
+	inline uint32 Id(const TCHAR* FieldName) { return FCrc::StrCrc32(FieldName); }
+
+	/** UACM_GameplayAbility, seconds. Overrides the cooldown effect duration */
+	extern ARKDECM_API const uint32 Cooldown;
+
+	/** UACM_GameplayAbility, passed to the cost effect as SetByCaller Data.Cost */
+	extern ARKDECM_API const uint32 Cost;
+
+	/** UACM_GameplayEffect, seconds, for HasDuration effects */
+	extern ARKDECM_API const uint32 Duration;
+
+	/** UACM_GameplayEffect, seconds between executions. Ignored on effects without a period */
+	extern ARKDECM_API const uint32 Period;
+
+	/** UACM_GameplayEffect, passed as SetByCaller Data.Magnitude */
+	extern ARKDECM_API const uint32 Magnitude;
+
+}
+
+/** The entries of one owner, pointing into the mapped table. Only valid until the next FACM_TuningTable::Load */
+struct ARKDECM_API FACM_TuningView
+{
+
+	const FACM_TuningEntry* Entries = nullptr;
+	int32 NumEntries = 0;
+
+	bool IsEmpty() const { return NumEntries == 0; }
+
+	bool TryGet(uint32 FieldId, float& OutValue) const;
+
+	float Get(uint32 FieldId, float DefaultValue) const
+	{
+		float Value = DefaultValue;
+		TryGet(FieldId, Value);
+		return Value;
+	}
+
+};
+
+struct FACM_AbilityTuning : FACM_TuningView
+{
+	bool TryGetCooldown(float& OutSeconds) const { return TryGet(ACM_TuningField::Cooldown, OutSeconds); }
+	bool TryGetCost(float& OutCost) const { return TryGet(ACM_TuningField::Cost, OutCost); }
+};
+
+struct FACM_EffectTuning : FACM_TuningView
+{
+	bool TryGetDuration(float& OutSeconds) const { return TryGet(ACM_TuningField::Duration, OutSeconds); }
+	bool TryGetPeriod(float& OutSeconds) const { return TryGet(ACM_TuningField::Period, OutSeconds); }
+	bool TryGetMagnitude(float& OutMagnitude) const { return TryGet(ACM_TuningField::Magnitude, OutMagnitude); }
+};
+
+/** Default values of UACM_AttributeSet attributes, the field is the attribute name */
+struct FACM_AttributeTuning : FACM_TuningView
+{
+	ARKDECM_API bool TryGetDefault(const FGameplayAttribute& Attribute, float& OutValue) const;
+};
+
+/**
+ * Baked balance values for abilities, effects and attributes, in a versioned binary file that is memory mapped and
+ * read in place. A lookup is a binary search over the owner ids followed by a short scan of that owner's fields;
+ * nothing is deserialized or copied.
+ *
+ * The file is Content/Tuning/ACM_Tuning.acmt unless -ACMTuning=File is given, and is built by the ACM_TuningBake
+ * commandlet. Load can be called again on a running server while no player is connected, e.g. between matches, to
+ * swap in a new file: it is mapped and validated before the old one is released, and no heap memory is allocated for
+ * the table unless the platform can not map files.
+ */
+class ARKDECM_API FACM_TuningTable
+{
+
+public:
+
+	static const uint32 Magic = 0x544D4341; // "ACMT"
+	static const uint32 CurrentVersion = 1;
+
+	static FString GetDefaultFilename();
+
+	/** Maps Filename and swaps it in. On failure the current table stays */
+	static bool Load(const FString& Filename);
+
+	static void Unload();
+
+	static bool IsLoaded();
+
+	/** Changes on every Load and Unload */
+	static uint32 GetGeneration();
+
+	static FACM_TuningView FindOwner(uint32 OwnerId);
+
+	/** FindOwner as one of the typed views, e.g. FindOwner<FACM_AbilityTuning>(OwnerId) */
+	template<typename TView>
+	static TView FindOwner(uint32 OwnerId)
+	{
+		TView View;
+		static_cast<FACM_TuningView&>(View) = FindOwner(OwnerId);
+		return View;
+	}
+
+	/**
+	 * Sorts the entries and writes a table file, for the bake commandlet. The file is written next to Filename and
+	 * moved over it. Where a mapped file can not be replaced, as on Windows, that move fails while another process
+	 * maps Filename: the new table is then left at Filename.tmp and false is returned
+	 */
+	static bool Write(const FString& Filename, TArray<FACM_TuningEntry>& Entries);
+
+};